@@ -1,9 +1,21 @@
 #pragma once
+#ifdef _WIN32
 #include "d3d9.h"
 #include "atlbase.h"
 #include "D3D9Macros.h"
 #include "avisynth.h"
 #include <windows.h>
+#else
+#include "Platform.h"
+#include "avisynth.h"
+
+// Same layout as in d3dx9shader.h; the defines are only compiled by the Direct3D engine.
+struct D3DXMACRO {
+	const char* Name;
+	const char* Definition;
+};
+typedef unsigned char byte;
+#endif
 
 enum ParamType {
 	None,
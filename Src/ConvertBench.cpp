@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+#include "ConvertShader.h"
+#include "HalfFloat.h"
+
+
+/*
+Standalone benchmark of the ConvertToShader/ConvertFromShader kernels.
+
+Every kernel registered in the four get_*_shader_* maps is found by asking for each tier and keeping only the kernels
+that didn't fall back to a lower tier. Each one runs single-threaded on a full frame (ConvertShader splits the same
+work into row bands over its thread pool), and its output is compared byte for byte with the _c kernel of the same
+format.
+
+Usage: ConvertBench [sd] [hd] [4k] [8k] [check]
+    By default all resolutions are measured. "check" only runs the cross-check, on a small odd-sized frame.
+*/
+
+
+extern bool has_sse2() noexcept;
+extern bool has_ssse3() noexcept;
+extern bool has_f16c() noexcept;
+extern bool has_avx2() noexcept;
+extern bool has_avx512() noexcept;
+
+
+// Padding after each row; the SIMD kernels may write up to a full vector past the width.
+const int BENCH_ROW_PADDING = 256;
+// Each kernel runs at least this many times and for at least this long.
+const int BENCH_MIN_RUNS = 3;
+const double BENCH_MIN_SECONDS = 0.25;
+
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+struct Direction {
+    const char* name;
+    convert_shader_t(*get)(int precision, int pix_type, bool stack16, arch_t& arch);
+    bool toShader;
+    bool planarShader;
+};
+
+static const Direction directions[] = {
+    { "to_packed", get_to_shader_packed, true, false },
+    { "to_planar", get_to_shader_planar, true, true },
+    { "from_packed", get_from_shader_packed, false, false },
+    { "from_planar", get_from_shader_planar, false, true },
+};
+
+static const char* arch_names[] = { "C", "SSE2", "SSSE3", "F16C", "AVX2", "AVX512" };
+
+
+static bool is_supported(arch_t arch) noexcept
+{
+    switch (arch) {
+    case USE_SSE2: return has_sse2();
+    case USE_SSSE3: return has_ssse3();
+    case USE_F16C: return has_f16c();
+    case USE_AVX2: return has_avx2();
+    case USE_AVX512: return has_avx512();
+    default: return true;
+    }
+}
+
+
+// A set of planes laid out like an AviSynth frame, with the Stack16 lsb planes in slots 3..5.
+class Planes {
+    std::vector<uint8_t> buffer;
+
+public:
+    uint8_t* ptr[6] = {};
+    int count = 0;
+    int rowBytes = 0;
+    int pitch = 0;
+    int height = 0;
+
+    Planes(int _count, bool stack16, int _rowBytes, int _height) :
+        count(_count), rowBytes(_rowBytes), height(_height)
+    {
+        pitch = (rowBytes + BENCH_ROW_PADDING + 63) & ~63;
+        const size_t planeSize = static_cast<size_t>(pitch) * height;
+        const int total = stack16 ? count * 2 : count;
+        buffer.resize(planeSize * total + 64);
+        uint8_t* base = buffer.data() + (64 - reinterpret_cast<uintptr_t>(buffer.data()) % 64) % 64;
+        for (int p = 0; p < total; ++p) {
+            ptr[p < count ? p : p - count + 3] = base + planeSize * p;
+        }
+    }
+
+    void Fill(uint8_t value)
+    {
+        std::fill(buffer.begin(), buffer.end(), value);
+    }
+
+    size_t Bytes() const
+    {
+        return static_cast<size_t>(rowBytes) * height * (ptr[3] ? count * 2 : count);
+    }
+};
+
+
+struct Kernel {
+    const Direction* dir;
+    int precision;
+    int pixType;
+    bool stack16;
+    arch_t arch;
+    convert_shader_t proc;
+    convert_shader_t reference;
+
+    std::string Name() const
+    {
+        const char* format = pixType == VideoInfo::CS_YV24 ? "yv24" : pixType == VideoInfo::CS_BGR24 ? "rgb24" : "rgb32";
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s %s p%d%s", dir->name, format, precision, stack16 ? " stack16" : "");
+        return buf;
+    }
+};
+
+
+static std::vector<Kernel> find_kernels()
+{
+    const int pixTypes[] = { VideoInfo::CS_YV24, VideoInfo::CS_BGR24, VideoInfo::CS_BGR32 };
+    std::vector<Kernel> list;
+
+    for (const Direction& dir : directions) {
+        for (int pixType : pixTypes) {
+            for (int precision = 1; precision <= 3; ++precision) {
+                for (int stack16 = 0; stack16 < 2; ++stack16) {
+                    convert_shader_t reference = nullptr;
+                    for (int a = NO_SIMD; a <= USE_AVX512; ++a) {
+                        arch_t arch = static_cast<arch_t>(a);
+                        convert_shader_t proc = dir.get(precision, pixType, stack16 != 0, arch);
+                        if (!proc || arch != a) {
+                            continue;
+                        }
+                        if (arch == NO_SIMD) {
+                            reference = proc;
+                        }
+                        list.push_back({ &dir, precision, pixType, stack16 != 0, arch, proc, reference });
+                    }
+                }
+            }
+        }
+    }
+    return list;
+}
+
+
+// The frames on both sides of the kernel, sized like ConvertShader does for this format.
+struct Frames {
+    Planes shader;
+    Planes avs;
+    Planes& src;
+    Planes& dst;
+
+    Frames(const Kernel& k, int width, int height) :
+        shader(k.dir->planarShader ? 3 : 1, false, width * (k.dir->planarShader ? 1 : 4) * (k.precision > 1 ? 2 : 1), height),
+        avs(k.pixType == VideoInfo::CS_YV24 ? 3 : 1, k.stack16,
+            width * (k.pixType == VideoInfo::CS_YV24 ? 1 : k.pixType == VideoInfo::CS_BGR24 ? 3 : 4), height),
+        src(k.dir->toShader ? avs : shader),
+        dst(k.dir->toShader ? shader : avs)
+    {
+    }
+};
+
+
+static void fill_source(const Kernel& k, Frames& f)
+{
+    std::mt19937 rng(k.precision * 7 + k.pixType);
+    Planes& src = f.src;
+    const bool halfFloat = !k.dir->toShader && k.precision == 3;
+    for (int p = 0; p < 6; ++p) {
+        if (!src.ptr[p]) {
+            continue;
+        }
+        for (int y = 0; y < src.height; ++y) {
+            uint8_t* row = src.ptr[p] + static_cast<size_t>(y) * src.pitch;
+            if (halfFloat) {
+                // Keep the samples in the 0-1 range written by the shaders.
+                for (int x = 0; x < src.rowBytes / 2; ++x) {
+                    reinterpret_cast<uint16_t*>(row)[x] = FloatToHalf((rng() & 0xFFFF) / 65535.0f);
+                }
+            } else {
+                for (int x = 0; x < src.rowBytes; ++x) {
+                    row[x] = static_cast<uint8_t>(rng());
+                }
+            }
+        }
+    }
+}
+
+
+// Same tables as ConvertShader for the half-float kernels below the F16C tier.
+static std::vector<uint16_t> make_lut(const Kernel& k, arch_t arch)
+{
+    std::vector<uint16_t> lut;
+    if (k.precision != 3 || arch >= USE_F16C) {
+        return lut;
+    }
+    if (k.dir->toShader) {
+        int maximum = k.stack16 ? 65536 : 256;
+        lut.resize(maximum);
+        for (int i = 0; i < maximum; ++i) {
+            lut[i] = FloatToHalf(i * 1.0f / (maximum - 1));
+        }
+    } else {
+        int maximum = k.stack16 ? 65535 : 255;
+        lut.resize(65536);
+        for (int i = 0; i < 65536; ++i) {
+            lut[i] = static_cast<uint16_t>(HalfToFloat(static_cast<uint16_t>(i)) * maximum + 0.5f);
+        }
+    }
+    return lut;
+}
+
+
+static void run(const Kernel& k, convert_shader_t proc, arch_t arch, Frames& f, int width, int height)
+{
+    std::vector<uint16_t> lut = make_lut(k, arch);
+    proc(f.dst.ptr, const_cast<const uint8_t**>(f.src.ptr), f.dst.pitch, f.src.pitch, width, height,
+        lut.empty() ? nullptr : lut.data());
+}
+
+
+// Runs the _c kernel twice over different fill patterns to find which bytes it writes, and compares those.
+static size_t cross_check(const Kernel& k, int width, int height)
+{
+    Frames f(k, width, height);
+    fill_source(k, f);
+
+    std::vector<std::vector<uint8_t>> ref[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        f.dst.Fill(pass ? 0xFF : 0x00);
+        run(k, k.reference, NO_SIMD, f, width, height);
+        for (int p = 0; p < 6; ++p) {
+            ref[pass].emplace_back();
+            if (f.dst.ptr[p]) {
+                ref[pass].back().assign(f.dst.ptr[p], f.dst.ptr[p] + static_cast<size_t>(f.dst.pitch) * height);
+            }
+        }
+    }
+
+    f.dst.Fill(0x55);
+    run(k, k.proc, k.arch, f, width, height);
+
+    size_t mismatches = 0;
+    for (int p = 0; p < 6; ++p) {
+        for (size_t i = 0; i < ref[0][p].size(); ++i) {
+            if (ref[0][p][i] == ref[1][p][i] && ref[0][p][i] != f.dst.ptr[p][i]) {
+                ++mismatches;
+            }
+        }
+    }
+    return mismatches;
+}
+
+
+static void benchmark(const Kernel& k, const Resolution& res)
+{
+    Frames f(k, res.width, res.height);
+    fill_source(k, f);
+    std::vector<uint16_t> lut = make_lut(k, k.arch);
+    void* b = lut.empty() ? nullptr : lut.data();
+
+    double best = 1e30;
+    uint64_t bestCycles = 0;
+    double elapsed = 0;
+    for (int i = 0; i < BENCH_MIN_RUNS || elapsed < BENCH_MIN_SECONDS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startCycles = __rdtsc();
+        k.proc(f.dst.ptr, const_cast<const uint8_t**>(f.src.ptr), f.dst.pitch, f.src.pitch, res.width, res.height, b);
+        uint64_t cycles = __rdtsc() - startCycles;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        elapsed += seconds;
+        if (seconds < best) {
+            best = seconds;
+            bestCycles = cycles;
+        }
+    }
+
+    const double pixels = static_cast<double>(res.width) * res.height;
+    const double bytes = static_cast<double>(f.src.Bytes() + f.dst.Bytes());
+    printf("%-28s %-7s %-4s %8.2f GB/s %8.3f cycles/pixel\n", k.Name().c_str(), arch_names[k.arch], res.name,
+        bytes / best / 1e9, bestCycles / pixels);
+}
+
+
+int main(int argc, char** argv)
+{
+    const Resolution resolutions[] = {
+        { "SD", 720, 480 },
+        { "HD", 1920, 1080 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    bool checkOnly = false;
+    std::vector<const Resolution*> selected;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::transform(arg.begin(), arg.end(), arg.begin(), [](char c) { return static_cast<char>(toupper(c)); });
+        if (arg == "CHECK") {
+            checkOnly = true;
+            continue;
+        }
+        auto it = std::find_if(std::begin(resolutions), std::end(resolutions),
+            [&](const Resolution& r) { return arg == r.name; });
+        if (it == std::end(resolutions)) {
+            fprintf(stderr, "Usage: %s [sd] [hd] [4k] [8k] [check]\n", argv[0]);
+            return 2;
+        }
+        selected.push_back(&*it);
+    }
+    if (selected.empty()) {
+        for (const Resolution& r : resolutions) {
+            selected.push_back(&r);
+        }
+    }
+
+    std::vector<Kernel> kernels = find_kernels();
+
+    // Cross-check on an odd size so that the scalar tail of each row is covered.
+    int failures = 0;
+    for (const Kernel& k : kernels) {
+        if (k.arch == NO_SIMD) {
+            continue;
+        }
+        if (!is_supported(k.arch)) {
+            printf("%-28s %-7s skipped, not supported by this CPU\n", k.Name().c_str(), arch_names[k.arch]);
+            continue;
+        }
+        if (!k.reference) {
+            printf("%-28s %-7s no C reference\n", k.Name().c_str(), arch_names[k.arch]);
+            continue;
+        }
+        size_t mismatches = cross_check(k, 333, 17);
+        if (mismatches) {
+            printf("%-28s %-7s MISMATCH: %zu bytes differ from C\n", k.Name().c_str(), arch_names[k.arch], mismatches);
+            ++failures;
+        }
+    }
+    printf("Cross-check: %d failure(s)\n\n", failures);
+
+    if (!checkOnly) {
+        for (const Resolution* res : selected) {
+            for (const Kernel& k : kernels) {
+                if (is_supported(k.arch)) {
+                    benchmark(k, *res);
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -1,13 +1,19 @@
-#include <DirectXPackedVector.h>
 #include "ConvertShader.h"
+#include "HalfFloat.h"
+
+
+// Rows are converted in bands of about this many bytes so that source and destination stay in the L2 cache.
+const int CONVERT_BAND_BYTES = 256 * 1024;
 
 
 extern bool has_sse2() noexcept;
 extern bool has_ssse3() noexcept;
 extern bool has_f16c() noexcept;
+extern bool has_avx2() noexcept;
+extern bool has_avx512() noexcept;
 
 
-static arch_t get_arch(int opt) noexcept
+arch_t get_arch(int opt) noexcept
 {
     if (opt == 0 || !has_sse2()) {
         return NO_SIMD;
@@ -15,14 +21,115 @@ static arch_t get_arch(int opt) noexcept
     if (opt == 1 || !has_ssse3()) {
         return USE_SSE2;
     }
-#if !defined(__AVX__)
-    return USE_SSSE3;
-#else
     if (opt == 2 || !has_f16c()) {
         return USE_SSSE3;
     }
-    return USE_F16C;
-#endif
+    if (opt == 3 || !has_avx2()) {
+        return USE_F16C;
+    }
+    if (opt == 4 || !has_avx512()) {
+        return USE_AVX2;
+    }
+    return USE_AVX512;
+}
+
+
+void make_to_shader_lut(std::vector<uint16_t>& lut, bool stack16)
+{
+    int maximum = stack16 ? 65536 : 256;
+    lut.resize(maximum);
+    for (int i = 0; i < maximum; ++i) {
+        lut[i] = FloatToHalf(i * 1.0f / (maximum - 1));
+    }
+}
+
+
+void make_from_shader_lut(std::vector<uint16_t>& lut, bool stack16)
+{
+    int maximum = stack16 ? 65535 : 255;
+    lut.resize(65536);
+    for (int i = 0; i < 65536; ++i) {
+        float t = HalfToFloat(static_cast<uint16_t>(i));
+        lut[i] = static_cast<uint16_t>(t * maximum + 0.5f);
+    }
+}
+
+
+void convert_rows(convert_shader_t proc, const uint8_t* const* srcBase, int spitch, bool srcFlipped,
+    uint8_t* const* dstBase, int dpitch, bool dstFlipped, int width, int height, int top, int bottom, size_t rowBytes,
+    void* lut, ThreadPool* threads)
+{
+    const int bandRows = static_cast<int>(std::max<size_t>(CONVERT_BAND_BYTES / rowBytes, 1));
+    const int bands = (bottom - top + bandRows - 1) / bandRows;
+
+    threads->ParallelFor(bands, 1, [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+            const int btop = top + i * bandRows;
+            const int bbottom = std::min(btop + bandRows, bottom);
+            const int srow = srcFlipped ? height - bbottom : btop;
+            const int drow = dstFlipped ? height - bbottom : btop;
+
+            const uint8_t* srcp[6];
+            uint8_t* dstp[6];
+            for (int p = 0; p < 3; ++p) {
+                srcp[p] = srcBase[p] ? srcBase[p] + static_cast<ptrdiff_t>(srow) * spitch : nullptr;
+                srcp[p + 3] = srcBase[p] ? srcBase[p] + static_cast<ptrdiff_t>(height + srow) * spitch : nullptr;
+                dstp[p] = dstBase[p] ? dstBase[p] + static_cast<ptrdiff_t>(drow) * dpitch : nullptr;
+                dstp[p + 3] = dstBase[p] ? dstBase[p] + static_cast<ptrdiff_t>(height + drow) * dpitch : nullptr;
+            }
+
+            proc(dstp, srcp, dpitch, spitch, width, bbottom - btop, lut);
+        }
+    });
+}
+
+
+ShaderPacker::ShaderPacker(const VideoInfo& src, int precision, bool _stack16, bool planar, arch_t arch) :
+    useLut(false), rgb(src.IsRGB()), stack16(_stack16), width(src.width), height(_stack16 ? src.height / 2 : src.height)
+{
+    proc = planar ? get_to_shader_planar(precision, src.pixel_type, stack16, arch)
+        : get_to_shader_packed(precision, src.pixel_type, stack16, arch);
+
+    if (precision == 3 && arch < USE_F16C) {
+        useLut = true;
+        make_to_shader_lut(lut, stack16);
+    }
+}
+
+
+void ShaderPacker::pack(const PVideoFrame& src, uint8_t* const* dstp, int dpitch, int top, int bottom, ThreadPool* threads) const
+{
+    const int spitch = src->GetPitch();
+    const uint8_t* srcBase[] = {
+        src->GetReadPtr(),
+        rgb ? nullptr : src->GetReadPtr(PLANAR_U),
+        rgb ? nullptr : src->GetReadPtr(PLANAR_V),
+    };
+
+    const size_t rowBytes = static_cast<size_t>(spitch) * (rgb ? 1 : 3) * (stack16 ? 2 : 1) + static_cast<size_t>(dpitch) * (dstp[1] ? 3 : 1);
+    void* b = useLut ? const_cast<uint16_t*>(lut.data()) : nullptr;
+    convert_rows(proc, srcBase, spitch, rgb, dstp, dpitch, false, width, height, top, bottom, rowBytes, b, threads);
+}
+
+
+ShaderUnpacker::ShaderUnpacker(int precision, bool _planar, int pixelType, bool _stack16, int textureWidth, int textureHeight, arch_t arch) :
+    useLut(false), rgb(pixelType != VideoInfo::CS_YV24), planar(_planar), stack16(_stack16), width(textureWidth), height(textureHeight)
+{
+    proc = planar ? get_from_shader_planar(precision, pixelType, stack16, arch)
+        : get_from_shader_packed(precision, pixelType, stack16, arch);
+
+    if (precision == 3 && arch < USE_F16C) {
+        useLut = true;
+        make_from_shader_lut(lut, stack16);
+    }
+}
+
+
+void ShaderUnpacker::unpack(const uint8_t* const* srcp, int spitch, uint8_t* const* dstp, int dpitch, int top, int bottom, ThreadPool* threads) const
+{
+    const size_t rowBytes = static_cast<size_t>(spitch) * (planar ? 3 : 1) + static_cast<size_t>(dpitch) * (rgb ? 1 : 3) * (stack16 ? 2 : 1);
+    void* b = useLut ? const_cast<uint16_t*>(lut.data()) : nullptr;
+    convert_rows(proc, srcp, spitch, false, dstp, dpitch, rgb, width, height, top, bottom, rowBytes, b, threads);
 }
 
 
@@ -31,6 +138,7 @@ void ConvertShader::constructToShader(int precision, bool stack16, bool planar,
     viSrc = vi;
 
     vi.pixel_type = planar ? VideoInfo::CS_YV24 : VideoInfo::CS_BGR32;
+    srcFlipped = viSrc.IsRGB();
 
     if (precision > 1) {    // Half-float frame has its width twice larger than normal
         vi.width *= 2;
@@ -43,25 +151,17 @@ void ConvertShader::constructToShader(int precision, bool stack16, bool planar,
     procWidth = viSrc.width;
     procHeight = vi.height;
 
-    floatBufferPitch = (vi.width * 4 * 4 + 63) & ~63; // must be mod64
-
     mainProc = planar ? get_to_shader_planar(precision, viSrc.pixel_type, stack16, arch)
         : get_to_shader_packed(precision, viSrc.pixel_type, stack16, arch);
 
-    if (precision == 3 && arch != USE_F16C) {
+    if (precision == 3 && arch < USE_F16C) {
         useLut = true;
-        int maximum = stack16 ? 65536 : 256;
-        lut.resize(maximum);
-        for (int i = 0; i < maximum; ++i) {
-            lut[i] = DirectX::PackedVector::XMConvertFloatToHalf(i * 1.0f / (maximum - 1));
-        }
+        make_to_shader_lut(lut, stack16);
     }
-
-
 }
 
 
-void ConvertShader::constructFromShader(int precision, bool stack16, std::string& format, arch_t arch)
+void ConvertShader::constructFromShader(int precision, bool stack16, const std::string& format, arch_t arch)
 {
     viSrc = vi;
 
@@ -73,6 +173,8 @@ void ConvertShader::constructFromShader(int precision, bool stack16, std::string
         vi.pixel_type = VideoInfo::CS_YV24;
     }
 
+    dstFlipped = vi.IsRGB();
+
     if (stack16) { // Stack16 frame has twice the height
         vi.height *= 2;
     }
@@ -83,28 +185,25 @@ void ConvertShader::constructFromShader(int precision, bool stack16, std::string
     procWidth = vi.width;
     procHeight = viSrc.height;
 
-    floatBufferPitch = (viSrc.width * 8 + 63) & ~63; // must be mod64
-
     mainProc = viSrc.IsRGB() ? get_from_shader_packed(precision, vi.pixel_type, stack16, arch)
         : get_from_shader_planar(precision, vi.pixel_type, stack16, arch);
 
-    if (precision == 3 && arch != USE_F16C) {
+    if (precision == 3 && arch < USE_F16C) {
         useLut = true;
-        int maximum = stack16 ? 65535 : 255;
-        lut.resize(65536);
-        for (int i = 0; i < 65536; ++i) {
-            float t = DirectX::PackedVector::XMConvertHalfToFloat(static_cast<uint16_t>(i));
-            lut[i] = static_cast<uint16_t>(t * maximum + 0.5f);
-        }
+        make_from_shader_lut(lut, stack16);
     }
 }
 
 
-ConvertShader::ConvertShader(PClip _child, int precision, bool stack16, std::string& format, bool planar, int opt, IScriptEnvironment* env) :
-    GenericVideoFilter(_child), isPlusMt(false), buff(nullptr), useLut(false)
+ConvertShader::ConvertShader(PClip _child, int precision, bool stack16, const std::string& format, bool planar, int opt, int _threads, IScriptEnvironment* env) :
+    GenericVideoFilter(_child), useLut(false), srcFlipped(false), dstFlipped(false)
 {
     name = format == "" ? "ConvertToShader" : "ConvertFromShader";
 
+    if (_threads < 0) {
+        env->ThrowError("%s: threads must be 0 or greater.", name.c_str());
+    }
+
     arch_t arch = get_arch(opt);
 
     if (name == "ConvertToShader") {
@@ -117,20 +216,8 @@ ConvertShader::ConvertShader(PClip _child, int precision, bool stack16, std::str
         env->ThrowError("%s: not implemented yet.", name.c_str());
     }
 
-    if (precision == 3 && !useLut) {
-        isPlusMt = env->FunctionExists("SetFilterMTMode");
-        if (!isPlusMt) { // if not avs+MT, allocate buffer at constructor.
-            buff = static_cast<float*>(_aligned_malloc(floatBufferPitch, 32));
-            if (!buff) {
-                env->ThrowError("%s: Failed to allocate temporal buffer.", name.c_str());
-            }
-        }
-    }
-}
-
-
-ConvertShader::~ConvertShader() {
-    _aligned_free(buff);
+    // Instances converting with all cores share one pool instead of each starting a thread per core.
+    threads = _threads > 0 ? std::make_shared<ThreadPool>(_threads) : ThreadPool::GetShared();
 }
 
 
@@ -139,31 +226,28 @@ PVideoFrame __stdcall ConvertShader::GetFrame(int n, IScriptEnvironment* env) {
 
     PVideoFrame dst = env->NewVideoFrame(vi, 32);
 
-    const uint8_t* srcp[] = {
+    const int spitch = src->GetPitch();
+    const int dpitch = dst->GetPitch();
+
+    const uint8_t* srcBase[] = {
         src->GetReadPtr(),
         viSrc.IsRGB() ? nullptr : src->GetReadPtr(PLANAR_U),
         viSrc.IsRGB() ? nullptr : src->GetReadPtr(PLANAR_V),
     };
 
-    uint8_t* dstp[] = {
+    uint8_t* dstBase[] = {
         dst->GetWritePtr(),
         vi.IsRGB() ? nullptr : dst->GetWritePtr(PLANAR_U),
         vi.IsRGB() ? nullptr : dst->GetWritePtr(PLANAR_V),
     };
 
-    void* b = useLut ? reinterpret_cast<void*>(lut.data()) : buff;
-    if (isPlusMt) { // if avs+MT, allocate buffer at every GetFrame() via buffer pool.
-        env->Allocate(floatBufferPitch, 32, AVS_POOLED_ALLOC);
-        if (!b) {
-            env->ThrowError("%s Failed to allocate temporal buffer.", name.c_str());
-        }
-    }
+    // Bytes touched per converted row, including the lsb rows of Stack16 frames.
+    const size_t rowBytes = static_cast<size_t>(spitch) * (viSrc.IsRGB() ? 1 : 3) * viSrc.height / procHeight
+        + static_cast<size_t>(dpitch) * (vi.IsRGB() ? 1 : 3) * vi.height / procHeight;
 
-    mainProc(dstp, srcp, dst->GetPitch(), src->GetPitch(), procWidth, procHeight, b);
+    void* b = useLut ? reinterpret_cast<void*>(lut.data()) : nullptr;
 
-    if (isPlusMt) {
-        env->Free(b);
-    }
+    convert_rows(mainProc, srcBase, spitch, srcFlipped, dstBase, dpitch, dstFlipped, procWidth, procHeight, 0, procHeight, rowBytes, b, threads.get());
 
     return dst;
 }
@@ -1,16 +1,20 @@
 #pragma once
 #include <cstdint>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <emmintrin.h>
 
-#ifndef WIN32_LEAN_AND_MEAN
+#if defined(_WIN32) && !defined(WIN32_LEAN_AND_MEAN)
 #define WIN32_LEAN_AND_MEAN
 #define VC_EXTRALEAN
 #define NOMINMAX
 #include <windows.h>
 #endif
+#include "Platform.h"
 #include "avisynth.h"
+#include "ThreadPool.h"
 
 #pragma warning(disable: 4556)
 
@@ -20,12 +24,18 @@ enum arch_t {
     USE_SSE2,
     USE_SSSE3,
     USE_F16C,
+    USE_AVX2,
+    USE_AVX512,
 };
 
 
+// srcp/dstp hold the Y, U, V (or packed) planes followed by their Stack16 lsb planes, and height is the number of rows
+// to convert. RGB frames are stored bottom-up, so the kernels start from their last row in memory.
 using convert_shader_t = void(__stdcall*)(
     uint8_t** dstp, const uint8_t** srcp, const int dpitch, const int spitch, const int width, const int height, void*);
 
+using convert_shader_map_t = std::map<std::tuple<int, int, bool, arch_t>, convert_shader_t>;
+
 
 
 class ConvertShader : public GenericVideoFilter {
@@ -33,19 +43,18 @@ class ConvertShader : public GenericVideoFilter {
     VideoInfo viSrc;
     int procWidth;
     int procHeight;
-    int floatBufferPitch;
-    float* buff;
-    bool isPlusMt;
     std::vector<uint16_t> lut;
     bool useLut;
+    bool srcFlipped;
+    bool dstFlipped;
+    std::shared_ptr<ThreadPool> threads;
 
     void constructToShader(int precision, bool stack16, bool planar, arch_t arch);
-    void constructFromShader(int precision, bool stack16, std::string& format, arch_t arch);
+    void constructFromShader(int precision, bool stack16, const std::string& format, arch_t arch);
     convert_shader_t mainProc;
 
 public:
-    ConvertShader(PClip _child, int _precision, bool stack16, std::string& format, bool planar, int opt, IScriptEnvironment* env);
-    ~ConvertShader();
+    ConvertShader(PClip _child, int _precision, bool stack16, const std::string& format, bool planar, int opt, int _threads, IScriptEnvironment* env);
     PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
     int __stdcall SetCacheHints(int cachehints, int frame_range);
 };
@@ -57,6 +66,85 @@ convert_shader_t get_from_shader_packed(int precision, int pix_type, bool stack1
 convert_shader_t get_from_shader_planar(int precision, int pix_type, bool stack16, arch_t& arch);
 
 
+// Returns the highest tier allowed by opt (see the opt parameter of ConvertToShader) and supported by the CPU.
+arch_t get_arch(int opt) noexcept;
+
+// Fills the table converting 8-bit, or 16-bit with Stack16, samples to half-floats for kernels without F16C.
+void make_to_shader_lut(std::vector<uint16_t>& lut, bool stack16);
+
+// Fills the table converting half-floats to 8-bit, or 16-bit with Stack16, samples for kernels without F16C.
+void make_from_shader_lut(std::vector<uint16_t>& lut, bool stack16);
+
+// Runs a kernel on rows [top, bottom) of frames of height rows, in bands that stay in the L2 cache. srcBase and
+// dstBase hold the Y, U and V planes, or only the first one for RGB; Stack16 lsb rows follow the height rows of
+// their plane. rowBytes is the memory read and written per row. Flipped frames are stored bottom-up.
+void convert_rows(convert_shader_t proc, const uint8_t* const* srcBase, int spitch, bool srcFlipped,
+    uint8_t* const* dstBase, int dpitch, bool dstFlipped, int width, int height, int top, int bottom, size_t rowBytes,
+    void* lut, ThreadPool* threads);
+
+
+// Packs frames of a clip in its source format the way ConvertToShader does, but into memory provided by the caller
+// instead of a new frame. ExecuteShader uses it to pack the clips it converts itself into the buffers of its textures.
+class ShaderPacker {
+    convert_shader_t proc;
+    std::vector<uint16_t> lut;
+    bool useLut;
+    bool rgb;
+    bool stack16;
+    int width;
+    int height;
+
+public:
+    ShaderPacker(const VideoInfo& src, int precision, bool stack16, bool planar, arch_t arch);
+    // Whether a kernel packs this format; ConvertToShader throws "not implemented yet" otherwise.
+    bool valid() const { return proc != nullptr; }
+    // Size of the texture, which is the size of ConvertToShader's output with its width in texels.
+    int texture_width() const { return width; }
+    int texture_height() const { return height; }
+    // Packs rows [top, bottom) of the texture. dstp holds 3 planes for planar textures, otherwise a single one.
+    void pack(const PVideoFrame& src, uint8_t* const* dstp, int dpitch, int top, int bottom, ThreadPool* threads) const;
+};
+
+
+// Unpacks textures read back from the engines the way ConvertFromShader does, from memory provided by the caller.
+// ExecuteShader uses it to write its result in OutputFormat.
+class ShaderUnpacker {
+    convert_shader_t proc;
+    std::vector<uint16_t> lut;
+    bool useLut;
+    bool rgb;
+    bool planar;
+    bool stack16;
+    int width;
+    int height;
+
+public:
+    ShaderUnpacker(int precision, bool planar, int pixelType, bool stack16, int textureWidth, int textureHeight, arch_t arch);
+    // Whether a kernel unpacks into this format; ConvertFromShader throws "not implemented yet" otherwise.
+    bool valid() const { return proc != nullptr; }
+    // Size of the output frame, which is twice the texture height with Stack16.
+    int frame_width() const { return width; }
+    int frame_height() const { return stack16 ? height * 2 : height; }
+    // Unpacks rows [top, bottom) of the texture. srcp holds 3 planes for planar textures, otherwise a single one,
+    // and dstp the planes of the output frame.
+    void unpack(const uint8_t* const* srcp, int spitch, uint8_t* const* dstp, int dpitch, int top, int bottom, ThreadPool* threads) const;
+};
+
+
+// Returns the kernel of the highest tier up to arch, and lowers arch to that tier.
+static inline convert_shader_t
+find_convert_shader(const convert_shader_map_t& func, int precision, int pix_type, bool stack16, arch_t& arch)
+{
+    for (;;) {
+        auto it = func.find(std::make_tuple(precision, pix_type, stack16, arch));
+        if (it != func.end() || arch == NO_SIMD) {
+            return it != func.end() ? it->second : nullptr;
+        }
+        arch = static_cast<arch_t>(arch - 1);
+    }
+}
+
+
 static __forceinline __m128i loadl(const uint8_t* p)
 {
     return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
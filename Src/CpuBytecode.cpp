@@ -0,0 +1,330 @@
+// Decoder of pixel shader bytecode for the CPU interpreter (see CpuBytecode.h).
+//
+// The token format is the one of d3d9types.h: a version token, then instructions made of an opcode token followed by
+// their destination, predicate and source parameter tokens, and an end token. Comments hold the constant table and
+// are skipped. Declarations are resolved here so that the interpreter only sees arithmetic and flow control.
+
+#include "CpuBytecode.h"
+#include "CpuInterpreter.h"
+#include <cstring>
+
+extern bool has_avx2() noexcept;
+extern bool has_avx512() noexcept;
+
+cpu_interpreter_t get_cpu_interpreter_avx2();
+cpu_interpreter_t get_cpu_interpreter_avx512();
+
+// Register types (D3DSPR_*)
+enum {
+	RegTemp = 0, RegInput = 1, RegConst = 2, RegTexture = 3, RegConstInt = 7, RegColorOut = 8, RegDepthOut = 9,
+	RegSampler = 10, RegConstBool = 14, RegLoop = 15, RegMisc = 17, RegLabel = 18, RegPredicate = 19
+};
+
+// Declaration usages (D3DDECLUSAGE_*)
+enum {
+	UsageTexCoord = 5, UsageColor = 10
+};
+
+static inline int RegisterType(uint32_t token) {
+	return ((token >> 28) & 7) | ((token >> 8) & 0x18);
+}
+
+// Opcodes that have a destination parameter. texkill names its register like a destination.
+static bool HasDestination(int opcode) {
+	switch (opcode) {
+	case OpNop: case OpCall: case OpCallNz: case OpLoop: case OpRet: case OpEndLoop: case OpLabel: case OpRep:
+	case OpEndRep: case OpIf: case OpIfC: case OpElse: case OpEndIf: case OpBreak: case OpBreakC: case OpBreakP:
+		return false;
+	default:
+		return true;
+	}
+}
+
+static bool IsSupported(int opcode) {
+	switch (opcode) {
+	case OpNop: case OpMov: case OpAdd: case OpSub: case OpMad: case OpMul: case OpRcp: case OpRsq: case OpDp3:
+	case OpDp4: case OpMin: case OpMax: case OpSlt: case OpSge: case OpExp: case OpLog: case OpLrp: case OpFrc:
+	case OpM4x4: case OpM4x3: case OpM3x4: case OpM3x3: case OpM3x2: case OpCall: case OpCallNz: case OpLoop:
+	case OpRet: case OpEndLoop: case OpLabel: case OpPow: case OpCrs: case OpAbs: case OpNrm: case OpSinCos:
+	case OpRep: case OpEndRep: case OpIf: case OpIfC: case OpElse: case OpEndIf: case OpBreak: case OpBreakC:
+	case OpTexKill: case OpTex: case OpExpP: case OpLogP: case OpCnd: case OpCmp: case OpDp2Add: case OpTexLdd:
+	case OpSetP: case OpTexLdl: case OpBreakP:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Maps a register to its file of the decoded program. Returns false for registers a pixel shader can't use.
+static bool DecodeRegister(uint32_t token, CpuOperand& op) {
+	int Number = token & 0x7FF;
+	op.Index = (uint16_t)Number;
+	switch (RegisterType(token)) {
+	case RegTemp:
+		op.File = CpuFile::Temp;
+		return Number < CPU_TEMP_REGISTERS;
+	case RegInput:
+		op.File = CpuFile::Input;
+		return Number < 10;
+	case RegTexture:
+		op.File = CpuFile::Input;
+		op.Index = (uint16_t)(10 + Number);
+		return Number < 10;
+	case RegConst:
+		op.File = CpuFile::Const;
+		return Number < CPU_SHADER_CONSTANTS;
+	case RegConstInt:
+		op.File = CpuFile::ConstInt;
+		return Number < CPU_INT_CONSTANTS;
+	case RegConstBool:
+		op.File = CpuFile::ConstBool;
+		return Number < CPU_BOOL_CONSTANTS;
+	case RegSampler:
+		op.File = CpuFile::Sampler;
+		return Number < 16;
+	case RegColorOut:
+		op.File = CpuFile::ColorOut;
+		return Number < 4;
+	case RegDepthOut:
+		op.File = CpuFile::DepthOut;
+		return Number == 0;
+	case RegLoop:
+		op.File = CpuFile::Loop;
+		return Number == 0;
+	case RegMisc:
+		op.File = CpuFile::Misc;	// vPos or vFace
+		return Number < 2;
+	case RegLabel:
+		op.File = CpuFile::Label;
+		return true;
+	case RegPredicate:
+		op.File = CpuFile::Predicate;
+		return Number == 0;
+	default:
+		return false;
+	}
+}
+
+static bool DecodeDestination(uint32_t token, CpuOperand& op) {
+	op.Swizzle = (uint8_t)((token >> 16) & 0xF);
+	op.Modifier = (uint8_t)((token >> 20) & 0xF);
+	op.Relative = false;
+	// Partial precision and centroid don't change the results here; other modifiers belong to ps_1_x.
+	return DecodeRegister(token, op) && (op.Modifier & ~0x7) == 0;
+}
+
+// Reads a source parameter and its relative address token if it has one.
+static bool DecodeSource(const uint32_t*& p, const uint32_t* end, int major, CpuOperand& op) {
+	uint32_t Token = *p++;
+	op.Swizzle = (uint8_t)((Token >> 16) & 0xFF);
+	op.Modifier = (uint8_t)((Token >> 24) & 0xF);
+	op.Relative = (Token & (1 << 13)) != 0;
+	if (op.Modifier == ModDz || op.Modifier == ModDw)
+		return false;
+	if (!DecodeRegister(Token, op))
+		return false;
+	if (op.Relative) {
+		// Only aL can address constant and input registers, in ps_3_0.
+		if (major < 3 || p >= end || RegisterType(*p++) != RegLoop)
+			return false;
+		if (op.File != CpuFile::Const && op.File != CpuFile::Input)
+			return false;
+	}
+	return true;
+}
+
+// Expands m4x4, m4x3, m3x4, m3x3 and m3x2 into one dot product per written component.
+static void ExpandMatrix(const CpuInstruction& ins, std::vector<CpuInstruction>& code) {
+	int Rows = ins.Opcode == OpM4x4 || ins.Opcode == OpM3x4 ? 4 : ins.Opcode == OpM3x2 ? 2 : 3;
+	int Opcode = ins.Opcode == OpM4x4 || ins.Opcode == OpM4x3 ? OpDp4 : OpDp3;
+	for (int i = 0; i < Rows; i++) {
+		if (!(ins.Dst.Swizzle & (1 << i)))
+			continue;
+		CpuInstruction Row = ins;
+		Row.Opcode = (uint16_t)Opcode;
+		Row.Dst.Swizzle = (uint8_t)(1 << i);
+		Row.Src[1].Index = (uint16_t)(ins.Src[1].Index + i);
+		code.push_back(Row);
+	}
+}
+
+bool DecodeCpuBytecode(const uint32_t* code, size_t bytes, CpuProgram& program) {
+	if (!code || bytes < 8)
+		return false;
+	const uint32_t* p = code;
+	const uint32_t* End = code + bytes / 4;
+
+	// Pixel shader 2.0 or 3.0
+	uint32_t Version = *p++;
+	int Major = (Version >> 8) & 0xFF;
+	if ((Version & 0xFFFF0000) != 0xFFFF0000 || Major < 2 || Major > 3)
+		return false;
+
+	program.Code.clear();
+	program.Labels.clear();
+	memset(program.Constants, 0, sizeof(program.Constants));
+	memset(program.ConstantDefined, 0, sizeof(program.ConstantDefined));
+	memset(program.IntConstants, 0, sizeof(program.IntConstants));
+	memset(program.IntConstantDefined, 0, sizeof(program.IntConstantDefined));
+	memset(program.BoolConstants, 0, sizeof(program.BoolConstants));
+	memset(program.BoolConstantDefined, 0, sizeof(program.BoolConstantDefined));
+	for (int i = 0; i < CPU_INPUT_REGISTERS; i++) {
+		program.Inputs[i] = CpuInput::Zero;
+	}
+	if (Major == 2) {
+		// Color registers of ps_2_0 are always the diffuse and specular colors; t# are the texture coordinates.
+		program.Inputs[0] = CpuInput::Color0;
+		program.Inputs[10] = CpuInput::TexCoord0;
+		for (int i = 11; i < 20; i++) {
+			program.Inputs[i] = CpuInput::TexCoord;
+		}
+	}
+
+	std::vector<int> Blocks;	// Open if, else, rep and loop instructions
+	while (p < End) {
+		uint32_t Token = *p++;
+		int Opcode = Token & 0xFFFF;
+		if (Opcode == OpEnd)
+			break;
+		if (Opcode == 0xFFFE) {
+			// Comment
+			p += (Token >> 16) & 0x7FFF;
+			continue;
+		}
+
+		int Length = (Token >> 24) & 0xF;
+		const uint32_t* Next = p + Length;
+		if (Next > End)
+			return false;
+
+		if (Opcode == OpDcl) {
+			if (Length != 2)
+				return false;
+			uint32_t Usage = p[0];
+			CpuOperand Reg;
+			if (!DecodeDestination(p[1], Reg))
+				return false;
+			if (Reg.File == CpuFile::Sampler) {
+				// Only 2D textures exist in the engine.
+				uint32_t Type = (Usage >> 27) & 0xF;
+				if (Type != 0 && Type != 2)
+					return false;
+			}
+			else if (Reg.File == CpuFile::Input && Major == 3) {
+				int Kind = Usage & 0x1F;
+				int UsageIndex = (Usage >> 16) & 0xF;
+				program.Inputs[Reg.Index] =
+					Kind == UsageTexCoord ? (UsageIndex == 0 ? CpuInput::TexCoord0 : CpuInput::TexCoord) :
+					Kind == UsageColor && UsageIndex == 0 ? CpuInput::Color0 : CpuInput::Zero;
+			}
+			p = Next;
+			continue;
+		}
+		if (Opcode == OpDef || Opcode == OpDefI || Opcode == OpDefB) {
+			CpuOperand Reg;
+			if (Length < 2 || !DecodeDestination(p[0], Reg))
+				return false;
+			if (Opcode == OpDef && Reg.File == CpuFile::Const && Length == 5) {
+				memcpy(program.Constants[Reg.Index], p + 1, sizeof(float) * 4);
+				program.ConstantDefined[Reg.Index] = true;
+			}
+			else if (Opcode == OpDefI && Reg.File == CpuFile::ConstInt && Length == 5) {
+				memcpy(program.IntConstants[Reg.Index], p + 1, sizeof(int) * 4);
+				program.IntConstantDefined[Reg.Index] = true;
+			}
+			else if (Opcode == OpDefB && Reg.File == CpuFile::ConstBool && Length == 2) {
+				program.BoolConstants[Reg.Index] = p[1] != 0;
+				program.BoolConstantDefined[Reg.Index] = true;
+			}
+			else
+				return false;
+			p = Next;
+			continue;
+		}
+		if (!IsSupported(Opcode))
+			return false;
+
+		CpuInstruction Ins = { };
+		Ins.Opcode = (uint16_t)Opcode;
+		Ins.Control = (uint8_t)((Token >> 16) & 0xFF);
+		Ins.Predicated = (Token & (1 << 28)) != 0;
+		Ins.Jump = -1;
+		if (HasDestination(Opcode)) {
+			if (p >= Next || !DecodeDestination(*p++, Ins.Dst))
+				return false;
+			if (Ins.Dst.File == CpuFile::DepthOut)
+				Ins.Dst.Swizzle = 0;	// Depth isn't used without a depth buffer
+		}
+		if (Ins.Predicated) {
+			if (p >= Next || !DecodeSource(p, Next, Major, Ins.Predicate) || Ins.Predicate.File != CpuFile::Predicate)
+				return false;
+		}
+		while (p < Next) {
+			if (Ins.SourceCount == 4 || !DecodeSource(p, Next, Major, Ins.Src[Ins.SourceCount]))
+				return false;
+			Ins.SourceCount++;
+		}
+
+		// Check the operands the interpreter relies on.
+		int Pc = (int)program.Code.size();
+		switch (Opcode) {
+		case OpTex: case OpTexLdl: case OpTexLdd:
+			if (Ins.SourceCount < 2 || Ins.Src[1].File != CpuFile::Sampler)
+				return false;
+			break;
+		case OpM4x4: case OpM4x3: case OpM3x4: case OpM3x3: case OpM3x2:
+			if (Ins.SourceCount != 2 || Ins.Src[1].File != CpuFile::Const || Ins.Src[1].Relative)
+				return false;
+			ExpandMatrix(Ins, program.Code);
+			continue;
+		case OpIf: case OpIfC: case OpRep: case OpLoop:
+			Blocks.push_back(Pc);
+			break;
+		case OpElse:
+			if (Blocks.empty() || (program.Code[Blocks.back()].Opcode != OpIf && program.Code[Blocks.back()].Opcode != OpIfC))
+				return false;
+			program.Code[Blocks.back()].Jump = Pc;
+			Blocks.back() = Pc;
+			break;
+		case OpEndIf:
+			if (Blocks.empty())
+				return false;
+			program.Code[Blocks.back()].Jump = Pc;
+			Blocks.pop_back();
+			break;
+		case OpEndRep: case OpEndLoop:
+			if (Blocks.empty() || program.Code[Blocks.back()].Opcode != (Opcode == OpEndRep ? OpRep : OpLoop))
+				return false;
+			program.Code[Blocks.back()].Jump = Pc;
+			Ins.Jump = Blocks.back();
+			Blocks.pop_back();
+			break;
+		case OpLabel:
+			if (Ins.SourceCount != 1 || Ins.Src[0].File != CpuFile::Label)
+				return false;
+			if (program.Labels.size() <= Ins.Src[0].Index)
+				program.Labels.resize(Ins.Src[0].Index + 1, -1);
+			program.Labels[Ins.Src[0].Index] = Pc;
+			break;
+		case OpCall: case OpCallNz:
+			if (Ins.Src[0].File != CpuFile::Label)
+				return false;
+			break;
+		}
+		program.Code.push_back(Ins);
+	}
+	if (!Blocks.empty())
+		return false;
+
+	// Resolve subroutine calls.
+	for (auto& Ins : program.Code) {
+		if (Ins.Opcode == OpCall || Ins.Opcode == OpCallNz) {
+			if (Ins.Src[0].Index >= program.Labels.size() || program.Labels[Ins.Src[0].Index] < 0)
+				return false;
+			Ins.Jump = program.Labels[Ins.Src[0].Index];
+		}
+	}
+
+	program.Run = has_avx512() ? get_cpu_interpreter_avx512() : has_avx2() ? get_cpu_interpreter_avx2() : &RunCpuProgram<8>;
+	return true;
+}
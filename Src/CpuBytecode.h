@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "CpuShaders.h"
+
+/* Decoder and interpreter of compiled pixel shaders, used by the CPU engine for shaders without a native port in
+   CpuShaders.cpp: custom .cso files and HLSL compiled at run time. ps_2_0, ps_2_x and ps_3_0 bytecode is supported;
+   screen-space gradients (dsx, dsy) and ps_1_x shaders are not. Textures have no mipmaps and use point sampling,
+   so texldb, texldd and texldl read the same texel as texld.
+
+   The interpreter runs the program on 8 or 16 horizontal pixels at a time, one per lane. Each instruction is decoded
+   once for all the lanes and its arithmetic runs as a loop over them, which the compiler turns into AVX2 or AVX-512
+   instructions. Branches and loops with per-pixel conditions keep a mask of the lanes that take them. */
+
+const int CPU_TEMP_REGISTERS = 32;
+const int CPU_INPUT_REGISTERS = 20;	// v0-v9, then t0-t9 of ps_2_0
+const int CPU_INT_CONSTANTS = 16;
+const int CPU_BOOL_CONSTANTS = 16;
+
+// Register files of the decoded program.
+enum class CpuFile : uint8_t {
+	Temp, Input, Const, ConstInt, ConstBool, Sampler, ColorOut, DepthOut, Loop, Predicate, Misc, Label
+};
+
+// What the rasterizer feeds to an input register. The engine draws a single quad with one set of texture coordinates.
+enum class CpuInput : uint8_t {
+	Zero,		// Not written by the vertex stage
+	TexCoord0,	// (u, v, 0, 1)
+	TexCoord,	// Other texture coordinates: (0, 0, 0, 1)
+	Color0		// Diffuse color without vertex colors: (1, 1, 1, 1)
+};
+
+// Instruction opcodes (D3DSIO_*). Matrix instructions are expanded into dp3 and dp4 when decoding.
+enum CpuOpcode {
+	OpNop = 0, OpMov, OpAdd, OpSub, OpMad, OpMul, OpRcp, OpRsq, OpDp3, OpDp4, OpMin, OpMax, OpSlt, OpSge, OpExp, OpLog,
+	OpLit, OpDst, OpLrp, OpFrc, OpM4x4, OpM4x3, OpM3x4, OpM3x3, OpM3x2, OpCall, OpCallNz, OpLoop, OpRet, OpEndLoop,
+	OpLabel, OpDcl, OpPow, OpCrs, OpSgn, OpAbs, OpNrm, OpSinCos, OpRep, OpEndRep, OpIf, OpIfC, OpElse, OpEndIf,
+	OpBreak, OpBreakC, OpMova, OpDefB, OpDefI,
+	OpTexKill = 65, OpTex = 66,
+	OpExpP = 78, OpLogP, OpCnd, OpDef,
+	OpCmp = 88, OpBem, OpDp2Add, OpDsx, OpDsy, OpTexLdd, OpSetP, OpTexLdl, OpBreakP,
+	OpEnd = 0xFFFF
+};
+
+// Source modifiers (D3DSPSM_*).
+enum CpuSourceModifier {
+	ModNone, ModNeg, ModBias, ModBiasNeg, ModSign, ModSignNeg, ModComp, ModX2, ModX2Neg, ModDz, ModDw, ModAbs, ModAbsNeg, ModNot
+};
+
+const int CPU_SATURATE = 1;			// D3DSPDM_SATURATE
+const int CPU_TEXLD_PROJECT = 1;	// D3DSI_TEXLD_PROJECT
+const int CPU_TEXLD_BIAS = 2;		// D3DSI_TEXLD_BIAS
+
+// Comparisons of ifc, breakc and setp.
+enum CpuCompare {
+	CompareGT = 1, CompareEQ, CompareGE, CompareLT, CompareNE, CompareLE
+};
+
+struct CpuOperand {
+	CpuFile File;
+	uint8_t Swizzle;	// 2 bits per component for sources; write mask for destinations
+	uint8_t Modifier;	// D3DSPSM_* for sources; D3DSPDM_* for destinations
+	bool Relative;		// Index is relative to aL
+	uint16_t Index;
+};
+
+struct CpuInstruction {
+	uint16_t Opcode;	// D3DSIO_*
+	uint8_t Control;	// Comparison or texld variant
+	uint8_t SourceCount;
+	bool Predicated;
+	CpuOperand Predicate;
+	CpuOperand Dst;
+	CpuOperand Src[4];
+	int Jump;			// if: else or endif; else: endif; rep/loop: end of the loop; endrep/endloop: start of the loop
+};
+
+struct CpuProgram;
+
+// Renders rows [top, bottom) like cpu_shader_t.
+using cpu_interpreter_t = void(*)(const CpuProgram& program, const CpuShaderArgs& args, float* dst, int dstPitch, int top, int bottom);
+
+struct CpuProgram {
+	std::vector<CpuInstruction> Code;
+	std::vector<int> Labels;			// Instruction of each label, or -1
+	float Constants[CPU_SHADER_CONSTANTS][4];	// def values
+	bool ConstantDefined[CPU_SHADER_CONSTANTS];
+	int IntConstants[CPU_INT_CONSTANTS][4];		// defi values
+	bool IntConstantDefined[CPU_INT_CONSTANTS];
+	bool BoolConstants[CPU_BOOL_CONSTANTS];		// defb values
+	bool BoolConstantDefined[CPU_BOOL_CONSTANTS];
+	CpuInput Inputs[CPU_INPUT_REGISTERS];
+	cpu_interpreter_t Run;
+};
+
+// Decodes shader bytecode. Returns false if it isn't a pixel shader or uses unsupported features.
+bool DecodeCpuBytecode(const uint32_t* code, size_t bytes, CpuProgram& program);
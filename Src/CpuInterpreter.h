@@ -0,0 +1,629 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include "CpuBytecode.h"
+
+/* Interpreter of a decoded pixel shader, compiled once for each instruction set by CpuBytecode.cpp,
+   cpu_interpreter_avx2.cpp and cpu_interpreter_avx512.cpp. It lives in an anonymous namespace so that
+   each translation unit keeps its own copy.
+
+   Registers hold each component of the N pixels of a group next to each other, so that every instruction
+   becomes a loop over N floats. Uniform registers (constants, aL) are broadcast when read. Flow control
+   on constants is taken by the whole group; per-pixel conditions (if p0, ifc, breakc, breakp, callnz p0)
+   narrow the execution mask, and writes only reach the lanes it holds. */
+
+namespace {
+
+template <int N>
+struct CpuLanes {
+	alignas(64) float v[4][N];
+};
+
+// Components of a source operand after swizzle and modifier.
+struct SourceLanes {
+	const float* c[4];
+};
+
+template <int N>
+class CpuInterpreter {
+public:
+	using Mask = uint32_t;
+	static const Mask AllLanes = (Mask)((1ull << N) - 1);
+
+	CpuInterpreter(const CpuProgram& program, const CpuShaderArgs& args) :
+		Program(program), Args(args) {
+		memcpy(Constants, args.Constants, sizeof(Constants));
+		for (int i = 0; i < CPU_SHADER_CONSTANTS; i++) {
+			if (program.ConstantDefined[i])
+				memcpy(Constants[i], program.Constants[i], sizeof(Constants[i]));
+		}
+		for (int i = 0; i < CPU_INT_CONSTANTS; i++) {
+			for (int j = 0; j < 4; j++) {
+				IntConstants[i][j] = program.IntConstantDefined[i] ? program.IntConstants[i][j] : args.IntConstants ? args.IntConstants[i][j] : 0;
+			}
+		}
+		for (int i = 0; i < CPU_BOOL_CONSTANTS; i++) {
+			BoolConstants[i] = program.BoolConstantDefined[i] ? program.BoolConstants[i] : args.BoolConstants ? args.BoolConstants[i] : false;
+		}
+
+		memset(Temp, 0, sizeof(Temp));
+		memset(Output, 0, sizeof(Output));
+		memset(&Predicate, 0, sizeof(Predicate));
+		memset(&Zero, 0, sizeof(Zero));
+		for (int r = 0; r < CPU_INPUT_REGISTERS; r++) {
+			CpuInput Kind = program.Inputs[r];
+			for (int i = 0; i < N; i++) {
+				Input[r].v[0][i] = Kind == CpuInput::Color0 ? 1.0f : 0.0f;
+				Input[r].v[1][i] = Kind == CpuInput::Color0 ? 1.0f : 0.0f;
+				Input[r].v[2][i] = Kind == CpuInput::Color0 ? 1.0f : 0.0f;
+				Input[r].v[3][i] = Kind == CpuInput::Zero ? 0.0f : 1.0f;
+			}
+		}
+		for (int i = 0; i < N; i++) {
+			Misc[1].v[0][i] = 1.0f;	// vFace: the quad is front-facing
+		}
+		NoSampler.Texture = nullptr;
+		NoSampler.Wrap = false;
+		Stack.reserve(16);
+	}
+
+	// Renders the pixels [x, x + count) of row y.
+	void Render(float* dst, int x, int y, int count) {
+		const float U = 1.0f / Args.Width;
+		const float V = (y + 0.5f) * (1.0f / Args.Height);
+		for (int r = 0; r < CPU_INPUT_REGISTERS; r++) {
+			if (Program.Inputs[r] == CpuInput::TexCoord0) {
+				for (int i = 0; i < N; i++) {
+					Input[r].v[0][i] = (x + i + 0.5f) * U;
+					Input[r].v[1][i] = V;
+				}
+			}
+		}
+		for (int i = 0; i < N; i++) {
+			Misc[0].v[0][i] = (float)(x + i);	// vPos
+			Misc[0].v[1][i] = (float)y;
+		}
+
+		const Mask Valid = count >= N ? AllLanes : (Mask)((1u << count) - 1);
+		Exec = Valid;
+		Killed = 0;
+		LoopCounter = 0;
+		Execute();
+
+		const Mask Written = Valid & ~Killed;
+		for (int i = 0; i < count; i++) {
+			if (Written & (1u << i)) {
+				for (int c = 0; c < 4; c++) {
+					dst[i * 4 + c] = Output[0].v[c][i];
+				}
+			}
+		}
+	}
+
+private:
+	enum FrameKind { FrameIf, FrameLoop, FrameCall };
+
+	struct Frame {
+		FrameKind Kind;
+		Mask Saved;		// Execution mask when the block started
+		Mask Taken;		// if: lanes that took the if branch; loops: lanes that left with break
+		int Count;		// Iterations left
+		int Step;		// Increment of aL
+		int PreviousLoop;	// aL of the enclosing loop
+		int Return;
+	};
+
+	const CpuProgram& Program;
+	const CpuShaderArgs& Args;
+	float Constants[CPU_SHADER_CONSTANTS][4];
+	int IntConstants[CPU_INT_CONSTANTS][4];
+	bool BoolConstants[CPU_BOOL_CONSTANTS];
+	CpuSampler NoSampler;
+
+	CpuLanes<N> Temp[CPU_TEMP_REGISTERS];
+	CpuLanes<N> Input[CPU_INPUT_REGISTERS];
+	CpuLanes<N> Output[4];
+	CpuLanes<N> Predicate;
+	CpuLanes<N> Misc[2];
+	CpuLanes<N> Zero;
+	CpuLanes<N> Source[4];
+	CpuLanes<N> Result;
+	Mask Exec;
+	Mask Killed;
+	int LoopCounter;	// aL
+	std::vector<Frame> Stack;
+
+	static inline float Saturate(float x) {
+		return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;	// NaN gives 0 like on the GPU
+	}
+
+	static inline float Modify(float x, int modifier) {
+		switch (modifier) {
+		case ModNeg: return -x;
+		case ModBias: return x - 0.5f;
+		case ModBiasNeg: return 0.5f - x;
+		case ModSign: return 2.0f * x - 1.0f;
+		case ModSignNeg: return 1.0f - 2.0f * x;
+		case ModComp: return 1.0f - x;
+		case ModX2: return 2.0f * x;
+		case ModX2Neg: return -2.0f * x;
+		case ModAbs: return std::fabs(x);
+		case ModAbsNeg: return -std::fabs(x);
+		case ModNot: return x != 0.0f ? 0.0f : 1.0f;
+		default: return x;
+		}
+	}
+
+	static inline bool Test(int compare, float a, float b) {
+		switch (compare) {
+		case CompareGT: return a > b;
+		case CompareEQ: return a == b;
+		case CompareGE: return a >= b;
+		case CompareLT: return a < b;
+		case CompareNE: return a != b;
+		case CompareLE: return a <= b;
+		default: return false;
+		}
+	}
+
+	// Destinations are Result or scratch registers, never a source.
+	template <typename F>
+	static inline void Map(float* __restrict d, const float* a, F f) {
+		for (int i = 0; i < N; i++) {
+			d[i] = f(a[i]);
+		}
+	}
+
+	template <typename F>
+	static inline void Map(float* __restrict d, const float* a, const float* b, F f) {
+		for (int i = 0; i < N; i++) {
+			d[i] = f(a[i], b[i]);
+		}
+	}
+
+	template <typename F>
+	static inline void Map(float* __restrict d, const float* a, const float* b, const float* c, F f) {
+		for (int i = 0; i < N; i++) {
+			d[i] = f(a[i], b[i], c[i]);
+		}
+	}
+
+	// Applies a function to the first component and replicates the result.
+	template <typename F>
+	static inline void Scalar(CpuLanes<N>& r, const SourceLanes& a, F f) {
+		Map(r.v[0], a.c[0], f);
+		for (int c = 1; c < 4; c++) {
+			memcpy(r.v[c], r.v[0], sizeof(r.v[0]));
+		}
+	}
+
+	// Returns the registers of a per-pixel operand, or nullptr for uniform ones.
+	CpuLanes<N>* Lanes(CpuFile file, int index) {
+		switch (file) {
+		case CpuFile::Temp: return &Temp[index];
+		case CpuFile::Input: return index >= 0 && index < CPU_INPUT_REGISTERS ? &Input[index] : &Zero;
+		case CpuFile::ColorOut: return &Output[index];
+		case CpuFile::Predicate: return &Predicate;
+		case CpuFile::Misc: return &Misc[index];
+		default: return nullptr;
+		}
+	}
+
+	// Reads the 4 components of a uniform operand before swizzle.
+	void Uniform(CpuFile file, int index, float* value) {
+		switch (file) {
+		case CpuFile::Const:
+			if (index >= 0 && index < CPU_SHADER_CONSTANTS)
+				memcpy(value, Constants[index], sizeof(float) * 4);
+			else
+				memset(value, 0, sizeof(float) * 4);
+			break;
+		case CpuFile::ConstInt:
+			for (int c = 0; c < 4; c++) {
+				value[c] = (float)IntConstants[index][c];
+			}
+			break;
+		case CpuFile::ConstBool:
+			value[0] = value[1] = value[2] = value[3] = BoolConstants[index] ? 1.0f : 0.0f;
+			break;
+		case CpuFile::Loop:
+			value[0] = value[1] = value[2] = value[3] = (float)LoopCounter;
+			break;
+		default:
+			memset(value, 0, sizeof(float) * 4);
+			break;
+		}
+	}
+
+	// Returns the components of a source operand. Swizzles only select rows of the register; modifiers and
+	// uniform values are written to scratch.
+	SourceLanes Fetch(const CpuOperand& op, CpuLanes<N>& scratch) {
+		SourceLanes Out;
+		int Index = op.Index + (op.Relative ? LoopCounter : 0);
+		const CpuLanes<N>* Reg = Lanes(op.File, Index);
+		if (!Reg) {
+			float Value[4];
+			Uniform(op.File, Index, Value);
+			for (int c = 0; c < 4; c++) {
+				float x = Modify(Value[(op.Swizzle >> (c * 2)) & 3], op.Modifier);
+				for (int i = 0; i < N; i++) {
+					scratch.v[c][i] = x;
+				}
+				Out.c[c] = scratch.v[c];
+			}
+			return Out;
+		}
+
+		for (int c = 0; c < 4; c++) {
+			const float* s = Reg->v[(op.Swizzle >> (c * 2)) & 3];
+			float* d = scratch.v[c];
+			Out.c[c] = d;
+			switch (op.Modifier) {
+			case ModNone: Out.c[c] = s; break;
+			case ModNeg: Map(d, s, [](float x) { return -x; }); break;
+			case ModBias: Map(d, s, [](float x) { return x - 0.5f; }); break;
+			case ModBiasNeg: Map(d, s, [](float x) { return 0.5f - x; }); break;
+			case ModSign: Map(d, s, [](float x) { return 2.0f * x - 1.0f; }); break;
+			case ModSignNeg: Map(d, s, [](float x) { return 1.0f - 2.0f * x; }); break;
+			case ModComp: Map(d, s, [](float x) { return 1.0f - x; }); break;
+			case ModX2: Map(d, s, [](float x) { return 2.0f * x; }); break;
+			case ModX2Neg: Map(d, s, [](float x) { return -2.0f * x; }); break;
+			case ModAbs: Map(d, s, [](float x) { return std::fabs(x); }); break;
+			case ModAbsNeg: Map(d, s, [](float x) { return -std::fabs(x); }); break;
+			default: Map(d, s, [](float x) { return x != 0.0f ? 0.0f : 1.0f; }); break;
+			}
+		}
+		return Out;
+	}
+
+	// Lanes where a component of p0 is set.
+	Mask PredicateMask(const CpuOperand& op, int component) {
+		const float* p = Predicate.v[(op.Swizzle >> (component * 2)) & 3];
+		Mask m = 0;
+		for (int i = 0; i < N; i++) {
+			m |= (Mask)(p[i] != 0.0f) << i;
+		}
+		return op.Modifier == ModNot ? ~m & AllLanes : m;
+	}
+
+	// Condition of if, callnz and breakp: a bool constant or a component of p0.
+	Mask Condition(const CpuOperand& op) {
+		if (op.File == CpuFile::Predicate)
+			return PredicateMask(op, 0);
+		bool Value = op.File == CpuFile::ConstBool && BoolConstants[op.Index];
+		return Value != (op.Modifier == ModNot) ? AllLanes : 0;
+	}
+
+	Mask Compare(const CpuInstruction& ins) {
+		const float* a = Fetch(ins.Src[0], Source[0]).c[0];
+		const float* b = Fetch(ins.Src[1], Source[1]).c[0];
+		Mask m = 0;
+		for (int i = 0; i < N; i++) {
+			m |= (Mask)Test(ins.Control, a[i], b[i]) << i;
+		}
+		return m;
+	}
+
+	// Lanes that left the innermost loop with break.
+	Mask Broken() {
+		for (size_t i = Stack.size(); i-- > 0; ) {
+			if (Stack[i].Kind == FrameLoop)
+				return Stack[i].Taken;
+			if (Stack[i].Kind == FrameCall)
+				break;
+		}
+		return 0;
+	}
+
+	Frame* InnermostLoop() {
+		for (size_t i = Stack.size(); i-- > 0; ) {
+			if (Stack[i].Kind == FrameLoop)
+				return &Stack[i];
+		}
+		return nullptr;
+	}
+
+	void Store(const CpuInstruction& ins, CpuLanes<N>& r) {
+		const CpuOperand& d = ins.Dst;
+		CpuLanes<N>* Reg = Lanes(d.File, d.Index);
+		if (!Reg)
+			return;
+		for (int c = 0; c < 4; c++) {
+			if (!(d.Swizzle & (1 << c)))
+				continue;
+			Mask m = Exec;
+			if (ins.Predicated)
+				m &= PredicateMask(ins.Predicate, c);
+			if (!m)
+				continue;
+			float* s = r.v[c];
+			if (d.Modifier & CPU_SATURATE) {
+				for (int i = 0; i < N; i++) {
+					s[i] = Saturate(s[i]);
+				}
+			}
+			float* o = Reg->v[c];
+			if (m == AllLanes)
+				memcpy(o, s, sizeof(float) * N);
+			else {
+				for (int i = 0; i < N; i++) {
+					if (m & (1u << i))
+						o[i] = s[i];
+				}
+			}
+		}
+	}
+
+	void Sample(const CpuInstruction& ins, const SourceLanes& coord, CpuLanes<N>& r) {
+		const CpuOperand& s = ins.Src[1];
+		const CpuSampler& Sampler = s.Index < 9 ? Args.Samplers[s.Index] : NoSampler;
+		const bool Project = ins.Opcode == OpTex && (ins.Control & 3) == CPU_TEXLD_PROJECT;
+		CpuLanes<N>& Texel = Source[2];
+		for (int i = 0; i < N; i++) {
+			float u = coord.c[0][i];
+			float v = coord.c[1][i];
+			if (Project) {
+				u /= coord.c[3][i];
+				v /= coord.c[3][i];
+			}
+			Float4 t = Sampler.Sample(u, v);
+			Texel.v[0][i] = t.x;
+			Texel.v[1][i] = t.y;
+			Texel.v[2][i] = t.z;
+			Texel.v[3][i] = t.w;
+		}
+		// The sampler swizzle selects the texel components.
+		for (int c = 0; c < 4; c++) {
+			memcpy(r.v[c], Texel.v[(s.Swizzle >> (c * 2)) & 3], sizeof(float) * N);
+		}
+	}
+
+	void Arithmetic(const CpuInstruction& ins) {
+		SourceLanes S[4];
+		CpuLanes<N>& R = Result;
+		for (int k = 0; k < ins.SourceCount; k++) {
+			if (ins.Src[k].File != CpuFile::Sampler && !(k >= 2 && ins.Opcode == OpTexLdd))
+				S[k] = Fetch(ins.Src[k], Source[k]);
+		}
+
+		switch (ins.Opcode) {
+		case OpMov:
+			for (int c = 0; c < 4; c++) memcpy(R.v[c], S[0].c[c], sizeof(float) * N);
+			break;
+		case OpAdd:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a + b; });
+			break;
+		case OpSub:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a - b; });
+			break;
+		case OpMul:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a * b; });
+			break;
+		case OpMad:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], S[2].c[c], [](float a, float b, float d) { return a * b + d; });
+			break;
+		case OpLrp:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], S[2].c[c], [](float a, float b, float d) { return a * (b - d) + d; });
+			break;
+		case OpMin:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a < b ? a : b; });
+			break;
+		case OpMax:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a >= b ? a : b; });
+			break;
+		case OpSlt:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a < b ? 1.0f : 0.0f; });
+			break;
+		case OpSge:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], [](float a, float b) { return a >= b ? 1.0f : 0.0f; });
+			break;
+		case OpCmp:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], S[2].c[c], [](float a, float b, float d) { return a >= 0.0f ? b : d; });
+			break;
+		case OpCnd:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], S[1].c[c], S[2].c[c], [](float a, float b, float d) { return a > 0.5f ? b : d; });
+			break;
+		case OpFrc:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], [](float a) { return a - std::floor(a); });
+			break;
+		case OpAbs:
+			for (int c = 0; c < 4; c++) Map(R.v[c], S[0].c[c], [](float a) { return std::fabs(a); });
+			break;
+		case OpSetP:
+			for (int c = 0; c < 4; c++) {
+				for (int i = 0; i < N; i++) {
+					R.v[c][i] = Test(ins.Control, S[0].c[c][i], S[1].c[c][i]) ? 1.0f : 0.0f;
+				}
+			}
+			break;
+		case OpRcp:
+			Scalar(R, S[0], [](float a) { return 1.0f / a; });
+			break;
+		case OpRsq:
+			Scalar(R, S[0], [](float a) { return 1.0f / std::sqrt(std::fabs(a)); });
+			break;
+		case OpExp: case OpExpP:
+			Scalar(R, S[0], [](float a) { return std::exp2(a); });
+			break;
+		case OpLog: case OpLogP:
+			Scalar(R, S[0], [](float a) { return std::log2(std::fabs(a)); });
+			break;
+		case OpPow:
+			Map(R.v[0], S[0].c[0], S[1].c[0], [](float a, float b) { return std::pow(std::fabs(a), b); });
+			for (int c = 1; c < 4; c++) memcpy(R.v[c], R.v[0], sizeof(R.v[0]));
+			break;
+		case OpDp3:
+			for (int i = 0; i < N; i++) {
+				R.v[0][i] = S[0].c[0][i] * S[1].c[0][i] + S[0].c[1][i] * S[1].c[1][i] + S[0].c[2][i] * S[1].c[2][i];
+			}
+			for (int c = 1; c < 4; c++) memcpy(R.v[c], R.v[0], sizeof(R.v[0]));
+			break;
+		case OpDp4:
+			for (int i = 0; i < N; i++) {
+				R.v[0][i] = S[0].c[0][i] * S[1].c[0][i] + S[0].c[1][i] * S[1].c[1][i] + S[0].c[2][i] * S[1].c[2][i] + S[0].c[3][i] * S[1].c[3][i];
+			}
+			for (int c = 1; c < 4; c++) memcpy(R.v[c], R.v[0], sizeof(R.v[0]));
+			break;
+		case OpDp2Add:
+			for (int i = 0; i < N; i++) {
+				R.v[0][i] = S[0].c[0][i] * S[1].c[0][i] + S[0].c[1][i] * S[1].c[1][i] + S[2].c[0][i];
+			}
+			for (int c = 1; c < 4; c++) memcpy(R.v[c], R.v[0], sizeof(R.v[0]));
+			break;
+		case OpCrs:
+			for (int i = 0; i < N; i++) {
+				R.v[0][i] = S[0].c[1][i] * S[1].c[2][i] - S[0].c[2][i] * S[1].c[1][i];
+				R.v[1][i] = S[0].c[2][i] * S[1].c[0][i] - S[0].c[0][i] * S[1].c[2][i];
+				R.v[2][i] = S[0].c[0][i] * S[1].c[1][i] - S[0].c[1][i] * S[1].c[0][i];
+				R.v[3][i] = 0.0f;
+			}
+			break;
+		case OpNrm:
+			for (int i = 0; i < N; i++) {
+				float f = 1.0f / std::sqrt(S[0].c[0][i] * S[0].c[0][i] + S[0].c[1][i] * S[0].c[1][i] + S[0].c[2][i] * S[0].c[2][i]);
+				R.v[0][i] = S[0].c[0][i] * f;
+				R.v[1][i] = S[0].c[1][i] * f;
+				R.v[2][i] = S[0].c[2][i] * f;
+				R.v[3][i] = S[0].c[3][i] * f;
+			}
+			break;
+		case OpSinCos:
+			// Writes (cos, sin) of the replicated source.
+			for (int i = 0; i < N; i++) {
+				R.v[0][i] = std::cos(S[0].c[0][i]);
+				R.v[1][i] = std::sin(S[0].c[0][i]);
+			}
+			break;
+		case OpTex: case OpTexLdl: case OpTexLdd:
+			Sample(ins, S[0], R);
+			break;
+		default:
+			return;
+		}
+		Store(ins, R);
+	}
+
+	void Execute() {
+		const CpuInstruction* Code = Program.Code.data();
+		const int Size = (int)Program.Code.size();
+		Stack.clear();
+		int pc = 0;
+		while (pc < Size) {
+			const CpuInstruction& Ins = Code[pc];
+			switch (Ins.Opcode) {
+			case OpIf: case OpIfC: {
+				Mask Cond = Ins.Opcode == OpIf ? Condition(Ins.Src[0]) : Compare(Ins);
+				Stack.push_back(Frame{ FrameIf, Exec, Exec & Cond, 0, 0, 0, 0 });
+				Exec &= Cond;
+				if (!Exec) {
+					// Go to else or endif
+					pc = Ins.Jump;
+					continue;
+				}
+				break;
+			}
+			case OpElse: {
+				Frame& f = Stack.back();
+				Exec = f.Saved & ~f.Taken & ~Broken();
+				if (!Exec) {
+					pc = Ins.Jump;
+					continue;
+				}
+				break;
+			}
+			case OpEndIf: {
+				Mask Saved = Stack.back().Saved;
+				Stack.pop_back();
+				Exec = Saved & ~Broken();
+				break;
+			}
+			case OpRep: case OpLoop: {
+				const int* Counter = IntConstants[(Ins.Opcode == OpRep ? Ins.Src[0] : Ins.Src[1]).Index];
+				int Count = Counter[0] < 255 ? Counter[0] : 255;
+				if (Count <= 0 || !Exec) {
+					pc = Ins.Jump + 1;
+					continue;
+				}
+				Stack.push_back(Frame{ FrameLoop, Exec, 0, Count, Ins.Opcode == OpLoop ? Counter[2] : 0, LoopCounter, 0 });
+				if (Ins.Opcode == OpLoop)
+					LoopCounter = Counter[1];
+				break;
+			}
+			case OpEndRep: case OpEndLoop: {
+				Frame& f = Stack.back();
+				LoopCounter += f.Step;
+				Exec = f.Saved & ~f.Taken;
+				if (--f.Count > 0 && Exec) {
+					pc = Ins.Jump + 1;
+					continue;
+				}
+				Exec = f.Saved;
+				LoopCounter = f.PreviousLoop;
+				Stack.pop_back();
+				break;
+			}
+			case OpBreak: case OpBreakC: case OpBreakP: {
+				Frame* Loop = InnermostLoop();
+				if (Loop) {
+					Mask Leaving = Exec & (Ins.Opcode == OpBreak ? AllLanes : Ins.Opcode == OpBreakC ? Compare(Ins) : Condition(Ins.Src[0]));
+					Loop->Taken |= Leaving;
+					Exec &= ~Leaving;
+				}
+				break;
+			}
+			case OpCall: case OpCallNz: {
+				Mask Cond = Ins.Opcode == OpCall ? AllLanes : Condition(Ins.Src[1]);
+				if (!(Exec & Cond))
+					break;
+				Stack.push_back(Frame{ FrameCall, Exec, 0, 0, 0, 0, pc + 1 });
+				Exec &= Cond;
+				pc = Ins.Jump + 1;
+				continue;
+			}
+			case OpRet: case OpLabel:
+				// The main program ends with ret when it has subroutines.
+				if (Stack.empty() || Stack.back().Kind != FrameCall)
+					return;
+				Exec = Stack.back().Saved;
+				pc = Stack.back().Return;
+				Stack.pop_back();
+				continue;
+			case OpTexKill: {
+				const CpuLanes<N>* Reg = Lanes(Ins.Dst.File, Ins.Dst.Index);
+				Mask Kill = 0;
+				for (int c = 0; c < 4 && Reg; c++) {
+					if (Ins.Dst.Swizzle & (1 << c)) {
+						for (int i = 0; i < N; i++) {
+							Kill |= (Mask)(Reg->v[c][i] < 0.0f) << i;
+						}
+					}
+				}
+				if (Ins.Predicated)
+					Kill &= PredicateMask(Ins.Predicate, 0);
+				Killed |= Exec & Kill;
+				break;
+			}
+			case OpNop:
+				break;
+			default:
+				if (Exec)
+					Arithmetic(Ins);
+				break;
+			}
+			pc++;
+		}
+	}
+};
+
+template <int N>
+void RunCpuProgram(const CpuProgram& program, const CpuShaderArgs& args, float* dst, int dstPitch, int top, int bottom) {
+	CpuInterpreter<N> Interpreter(program, args);
+	for (int y = top; y < bottom; y++) {
+		float* Row = dst + (size_t)(y - top) * dstPitch;
+		for (int x = 0; x < args.Width; x += N) {
+			Interpreter.Render(Row + x * 4, x, y, args.Width - x < N ? args.Width - x : N);
+		}
+	}
+}
+
+}
@@ -0,0 +1,91 @@
+#include <malloc.h>
+#include <algorithm>
+#include "CpuMemoryPool.h"
+
+CpuMemoryPool::CpuMemoryPool() {
+}
+
+CpuMemoryPool::~CpuMemoryPool() {
+	for (auto const item : m_Pool) {
+		_aligned_free(item->Data);
+		delete item;
+	}
+	m_Pool.clear();
+}
+
+HRESULT CpuMemoryPool::Allocate(int width, int height, int channels, int precision, CpuTexture** texture) {
+	return Allocate(width, height, channels, precision, false, texture);
+}
+
+HRESULT CpuMemoryPool::AllocateView(int width, int height, int channels, int precision, CpuTexture** texture) {
+	return Allocate(width, height, channels, precision, true, texture);
+}
+
+HRESULT CpuMemoryPool::Allocate(int width, int height, int channels, int precision, bool view, CpuTexture** texture) {
+	// Take an available texture from the free list. Precision is matched too so that textures bound to a frame plan keep theirs.
+	std::vector<CpuTexture*>& Free = m_Free[GetKey(width, height, channels, precision, view)];
+	if (!Free.empty()) {
+		CpuTexture* item = Free.back();
+		Free.pop_back();
+		MarkInUse(item);
+		m_Stats.Hits++;
+		*texture = item;
+		return S_OK;
+	}
+
+	// If not found, create it. Rows are aligned to 64 bytes.
+	CpuTexture* NewObj = new CpuTexture();
+	NewObj->Available = true;
+	NewObj->Width = width;
+	NewObj->Height = height;
+	NewObj->Channels = channels;
+	NewObj->Precision = precision;
+	if (!view) {
+		NewObj->Pitch = (width * channels + 15) & ~15;
+		NewObj->Data = (float*)_aligned_malloc(sizeof(float) * NewObj->Pitch * height, 64);
+		if (!NewObj->Data) {
+			delete NewObj;
+			return E_OUTOFMEMORY;
+		}
+	}
+
+	// Add to memory pool.
+	m_Pool.push_back(NewObj);
+	m_Stats.Misses++;
+	m_Stats.BytesResident += sizeof(float) * NewObj->Pitch * height;
+	MarkInUse(NewObj);
+
+	*texture = NewObj;
+	return S_OK;
+}
+
+void CpuMemoryPool::MarkInUse(CpuTexture* texture) {
+	texture->Available = false;
+	m_Stats.BytesInUse += sizeof(float) * texture->Pitch * texture->Height;
+	m_Stats.PeakSum = std::max(m_Stats.PeakSum, m_Stats.BytesInUse);
+}
+
+HRESULT CpuMemoryPool::Release(CpuTexture* texture) {
+	if (!texture)
+		return S_OK;
+
+	if (!texture->Available) {
+		texture->Available = true;
+		m_Stats.BytesInUse -= sizeof(float) * texture->Pitch * texture->Height;
+		m_Free[GetKey(texture)].push_back(texture);
+	}
+	return S_OK;
+}
+
+// Marks a released texture as used again, for memory that stays bound to a frame plan.
+HRESULT CpuMemoryPool::Reserve(CpuTexture* texture) {
+	if (!texture)
+		return S_OK;
+
+	if (texture->Available) {
+		std::vector<CpuTexture*>& Free = m_Free[GetKey(texture)];
+		Free.erase(std::remove(Free.begin(), Free.end(), texture), Free.end());
+		MarkInUse(texture);
+	}
+	return S_OK;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "D3D9Macros.h"
+#include "CpuTexture.h"
+#include "MemoryPoolStats.h"
+#include <vector>
+#include <unordered_map>
+
+/* Creates CPU engine textures on-demand and store them in a pool for re-use.
+   Available textures are kept in a free list per size and format, so both allocating and releasing are O(1).
+   The pool doesn't lock: each engine owns its pool and only uses it while reserved by EngineScheduler. */
+
+class CpuMemoryPool {
+public:
+	CpuMemoryPool();
+	~CpuMemoryPool();
+	HRESULT Allocate(int width, int height, int channels, int precision, CpuTexture** texture);
+	// Creates a view of AviSynth frames, which holds no memory; see CpuTexture.
+	HRESULT AllocateView(int width, int height, int channels, int precision, CpuTexture** texture);
+	HRESULT Release(CpuTexture* texture);
+	HRESULT Reserve(CpuTexture* texture);
+	const MemoryPoolStats& GetStats() const { return m_Stats; }
+private:
+	// Width, height, channels, precision and whether it is a view packed into a single key.
+	static uint64_t GetKey(int width, int height, int channels, int precision, bool view) {
+		return ((uint64_t)width << 32) | ((uint64_t)height << 8) | ((uint64_t)view << 7) | ((uint64_t)channels << 4) | (uint64_t)precision;
+	}
+	static uint64_t GetKey(const CpuTexture* texture) {
+		return GetKey(texture->Width, texture->Height, texture->Channels, texture->Precision, texture->Data == nullptr);
+	}
+
+	HRESULT Allocate(int width, int height, int channels, int precision, bool view, CpuTexture** texture);
+
+	void MarkInUse(CpuTexture* texture);
+	std::vector<CpuTexture*> m_Pool;
+	std::unordered_map<uint64_t, std::vector<CpuTexture*>> m_Free;
+	MemoryPoolStats m_Stats = {};
+};
@@ -0,0 +1,727 @@
+// Software implementation of the command chain.
+//
+// Each command runs the native port of its shader (see CpuShaders.cpp) over the rows of the output texture.
+// Shaders without a port, like custom .cso files or HLSL files, are decoded and run by the bytecode interpreter
+// (see CpuBytecode.cpp). Samplers use point filtering with clamp addressing like the GPU engine, and rendered
+// texels are rounded to the format of the output texture before the next command reads them.
+//
+// Commands are recorded and run together when the result is read back. Each one is split into bands of rows,
+// and a band starts as soon as the bands of earlier commands it reads are done (see Flush), so threads don't
+// wait for the slowest band at the end of every command.
+//
+// The last pass doesn't keep its result: each band is rendered into a small per-thread buffer and written straight
+// into the output frame by the readback (see RenderToFrame). PlanarOut doesn't need the OutputY/OutputU/OutputV
+// passes: the planes are taken directly from the RGBA texels of the last pass.
+//
+// When ExecuteShader processes frames in tiles, SetRowRange restricts each pass and transfer to the rows of the
+// tile. Textures keep their full size so that the shaders see the same coordinates.
+
+#include "CpuRenderImpl.h"
+#include "HalfFloat.h"
+#include "ShaderCache.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Minimum amount of rows processed by each thread.
+const int CPU_MIN_BAND = 8;
+
+static inline float Saturate(float x) {
+	return x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x;
+}
+
+// Rounds a value the way it would be stored in a texture of specified precision.
+static inline float RoundToPrecision(float x, int precision) {
+	if (precision <= 1)
+		return std::floor(Saturate(x) * 255.0f + 0.5f) * (1.0f / 255.0f);
+	else if (precision == 2)
+		return std::floor(Saturate(x) * 65535.0f + 0.5f) * (1.0f / 65535.0f);
+	else
+		return HalfToFloat(FloatToHalf(x));
+}
+
+static inline byte ToByte(float x) {
+	return (byte)(Saturate(x) * 255.0f + 0.5f);
+}
+
+static inline uint16_t ToWord(float x) {
+	return (uint16_t)(Saturate(x) * 65535.0f + 0.5f);
+}
+
+// Writes a row of RGBA texels as D3DFMT_A8R8G8B8, D3DFMT_A16B16G16R16 or D3DFMT_A16B16G16R16F.
+static void WriteRow(const float* in, int width, byte* out, int outputPrecision) {
+	if (outputPrecision == 1) {
+		for (int x = 0; x < width; x++) {
+			out[0] = ToByte(in[2]);
+			out[1] = ToByte(in[1]);
+			out[2] = ToByte(in[0]);
+			out[3] = ToByte(in[3]);
+			in += 4;
+			out += 4;
+		}
+	}
+	else if (outputPrecision == 2) {
+		uint16_t* Out16 = (uint16_t*)out;
+		for (int x = 0; x < width * 4; x++) {
+			Out16[x] = ToWord(in[x]);
+		}
+	}
+	else {
+		uint16_t* Out16 = (uint16_t*)out;
+		for (int x = 0; x < width * 4; x++) {
+			Out16[x] = FloatToHalf(in[x]);
+		}
+	}
+}
+
+// Writes one channel of a row as a D3DFMT_L8, D3DFMT_L16 or D3DFMT_R16F plane. in points to the channel of the first texel.
+static void WritePlaneRow(const float* in, int channels, int width, byte* out, int outputPrecision) {
+	uint16_t* Out16 = (uint16_t*)out;
+	for (int x = 0; x < width; x++) {
+		float Value = in[x * channels];
+		if (outputPrecision <= 1)
+			out[x] = ToByte(Value);
+		else if (outputPrecision == 2)
+			Out16[x] = ToWord(Value);
+		else
+			Out16[x] = FloatToHalf(Value);
+	}
+}
+
+CpuRenderImpl::CpuRenderImpl() {
+}
+
+CpuRenderImpl::~CpuRenderImpl() {
+	for (int i = 0; i < 80; i++) {
+		delete m_Programs[i];
+	}
+	if (m_DitherMatrix) {
+		ReleaseTextureMemory(m_DitherMatrix);
+		delete m_DitherMatrix;
+	}
+	if (m_Pool)
+		delete m_Pool;
+}
+
+HRESULT CpuRenderImpl::Initialize(int clipPrecision[9], int precision, int outputPrecision, bool planarOut, ThreadPool* threads, IScriptEnvironment* /*env*/) {
+	m_PlanarOut = planarOut;
+	m_Precision = precision;
+	for (int i = 0; i < 9; i++) {
+		m_ClipPrecision[i] = clipPrecision[i];
+	}
+	m_OutputPrecision = outputPrecision;
+	m_Threads = threads;
+	ResetSamplerState();
+
+	m_Pool = new CpuMemoryPool();
+
+	m_DitherMatrix = new InputTexture();
+	HR(CreateTexture(-1, DITHER_MATRIX_SIZE, DITHER_MATRIX_SIZE, true, false, false, 1, m_DitherMatrix));
+	HR(CopyDitherMatrixToSurface(this, m_DitherMatrix));
+	return S_OK;
+}
+
+void CpuRenderImpl::SetRowRange(int top, int bottom) {
+	m_RowTop = top;
+	m_RowBottom = bottom;
+}
+
+// Gets the rows selected with SetRowRange, within a texture of specified height.
+void CpuRenderImpl::GetRowRange(int height, int* top, int* bottom) {
+	*top = std::min(m_RowTop, height);
+	*bottom = m_RowBottom < 0 ? height : std::min(m_RowBottom, height);
+}
+
+// Runs func on bands of the rows selected with SetRowRange, within a texture of specified height.
+void CpuRenderImpl::ForEachBand(int height, const std::function<void(int, int)>& func) {
+	int Top, Bottom;
+	GetRowRange(height, &Top, &Bottom);
+	m_Threads->ParallelFor(Bottom - Top, CPU_MIN_BAND, [&](int top, int bottom) {
+		func(Top + top, Top + bottom);
+	});
+}
+
+HRESULT CpuRenderImpl::ResetSamplerState() {
+	for (int i = 0; i < 9; i++) {
+		m_Wrap[i] = false;
+	}
+	return S_OK;
+}
+
+// Input textures take the precision of their clip. Textures not coming from a clip use shaderPrecision.
+int CpuRenderImpl::GetInputPrecision(int clipIndex, int shaderPrecision) {
+	return clipIndex >= 1 && clipIndex <= maxClips ? m_ClipPrecision[clipIndex - 1] : shaderPrecision;
+}
+
+HRESULT CpuRenderImpl::CreateTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) {
+	HRESULT hr = AllocateTextureMemory(clipIndex, width, height, isInput, isPlanar, isLast, shaderPrecision, outTexture);
+	if (FAILED(hr))
+		ReleaseTextureMemory(outTexture);
+	return hr;
+}
+
+HRESULT CpuRenderImpl::AllocateTextureMemory(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) {
+	outTexture->Pool = nullptr;
+	outTexture->ClipIndex = clipIndex;
+	outTexture->Width = width;
+	outTexture->Height = height;
+
+	// Input clips are read in place from their frames; other inputs like the dither matrix hold their texels.
+	bool IsView = isInput && clipIndex >= 1 && clipIndex <= maxClips;
+	auto Allocate = [this, IsView](int width, int height, int channels, int precision, CpuTexture** texture) {
+		return IsView ? m_Pool->AllocateView(width, height, channels, precision, texture) : m_Pool->Allocate(width, height, channels, precision, texture);
+	};
+
+	int Precision;
+	if (isPlanar) {
+		Precision = isInput ? GetInputPrecision(clipIndex, shaderPrecision) : shaderPrecision > -1 ? shaderPrecision : m_Precision;
+		HR(Allocate(width, height, 1, Precision, &outTexture->BufferY));
+		HR(Allocate(width, height, 1, Precision, &outTexture->BufferU));
+		HR(Allocate(width, height, 1, Precision, &outTexture->BufferV));
+	}
+	else if (isLast) {
+		// The last pass writes into the output frame, so its texture is a view. With PlanarOut, the 3 planes are taken from its RGBA texels.
+		HR(m_Pool->AllocateView(width, height, 4, m_OutputPrecision, &outTexture->Buffer));
+	}
+	else {
+		Precision = isInput ? GetInputPrecision(clipIndex, shaderPrecision) : shaderPrecision > -1 ? shaderPrecision : m_Precision;
+		// Y8 clips are held as a single channel; render targets are always RGBA.
+		HR(Allocate(width, height, isInput && Precision == 0 ? 1 : 4, Precision, &outTexture->Buffer));
+	}
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::ReleaseTextureMemory(InputTexture* texture) {
+	HR(m_Pool->Release(texture->Buffer));
+	HR(m_Pool->Release(texture->BufferY));
+	HR(m_Pool->Release(texture->BufferU));
+	HR(m_Pool->Release(texture->BufferV));
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::ReserveTextureMemory(InputTexture* texture) {
+	HR(m_Pool->Reserve(texture->Buffer));
+	HR(m_Pool->Reserve(texture->BufferY));
+	HR(m_Pool->Reserve(texture->BufferU));
+	HR(m_Pool->Reserve(texture->BufferV));
+	return S_OK;
+}
+
+// Replaces the texture having the same ClipIndex. This is done after rendering as the previous texture may be an input of the command.
+HRESULT CpuRenderImpl::ReplaceTexture(std::vector<InputTexture*>* textureList, InputTexture* item) {
+	InputTexture* Previous = FindTexture(textureList, item->ClipIndex);
+	if (Previous)
+		HR(DiscardTexture(textureList, Previous));
+	textureList->push_back(item);
+	return S_OK;
+}
+
+void CpuRenderImpl::Quantize(CpuTexture* texture, int top, int bottom) {
+	const int Precision = texture->Precision;
+	const int RowSize = texture->Width * texture->Channels;
+	for (int y = top; y < bottom; y++) {
+		float* Row = texture->Data + (size_t)y * texture->Pitch;
+		if (Precision == 0 && texture->Channels == 4) {
+			// D3DFMT_L8 render target: only the red channel is kept.
+			for (int x = 0; x < RowSize; x += 4) {
+				float L = RoundToPrecision(Row[x], 0);
+				Row[x] = L;
+				Row[x + 1] = L;
+				Row[x + 2] = L;
+				Row[x + 3] = 1.0f;
+			}
+		}
+		else {
+			for (int x = 0; x < RowSize; x++) {
+				Row[x] = RoundToPrecision(Row[x], Precision);
+			}
+		}
+	}
+}
+
+HRESULT CpuRenderImpl::ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut) {
+	const int Index = cmd->CommandIndex + planeOut;
+	if (!m_Shaders[Index] && !m_Programs[Index])
+		return E_FAIL;
+
+	// The pass runs later, so it keeps its own copy of the constants.
+	std::unique_ptr<CpuPass> Pass(new CpuPass());
+	Pass->Shader = m_Shaders[Index];
+	Pass->Program = m_Programs[Index];
+	Pass->HasFootprint = m_HasFootprint[Index];
+	Pass->Footprint = m_Footprints[Index];
+	memcpy(Pass->Constants, m_Constants, sizeof(m_Constants));
+	memcpy(Pass->IntConstants, m_IntConstants, sizeof(m_IntConstants));
+	memcpy(Pass->BoolConstants, m_BoolConstants, sizeof(m_BoolConstants));
+
+	CpuShaderArgs& Args = Pass->Args;
+	Args.Constants = Pass->Constants;
+	Args.IntConstants = Pass->IntConstants;
+	Args.BoolConstants = Pass->BoolConstants;
+	Args.Width = width;
+	Args.Height = height;
+
+	// Set input clips.
+	InputTexture* Input;
+	for (int i = 0; i < 9; i++) {
+		Args.Samplers[i].Wrap = m_Wrap[i];
+		if (cmd->ClipIndex[i] > 0) {
+			Input = FindTexture(textureList, cmd->ClipIndex[i]);
+			if (Input && (Input->Buffer || Input->BufferY)) {
+				if (!Input->BufferY) {
+					Args.Samplers[i].Texture = Input->Buffer;
+				}
+				else {
+					// Copy planar data to the 3 sampler spots starting at specified clip index.
+					Args.Samplers[i].Texture = Input->BufferY;
+					if (i + 1 < 9)
+						Args.Samplers[i + 1].Texture = Input->BufferU;
+					if (i + 2 < 9)
+						Args.Samplers[i + 2].Texture = Input->BufferV;
+				}
+			}
+			else
+				return E_INVALIDARG;
+		}
+	}
+
+	InputTexture* Dst;
+	HR(AcquireTexture(cmd->OutputIndex, width, height, false, false, isLast, cmd->Precision, &Dst));
+	Pass->Targets[0] = Dst->Buffer;
+	Pass->TargetCount = 1;
+	GetRowRange(height, &Pass->Top, &Pass->Bottom);
+	RecordPass(std::move(Pass));
+
+	HR(ReplaceTexture(textureList, Dst));
+	return S_OK;
+}
+
+// Converts between formats like D3DXLoadSurfaceFromSurface.
+void CpuRenderImpl::CopyRows(const CpuTexture* from, CpuTexture* to, int top, int bottom) {
+	CpuSampler Reader = { from, false };
+	for (int y = top; y < bottom; y++) {
+		float* Out = to->Data + (size_t)y * to->Pitch;
+		for (int x = 0; x < to->Width; x++) {
+			Float4 c = Reader.Fetch(x, y);
+			Out[0] = c.x;
+			if (to->Channels == 4) {
+				Out[1] = c.y;
+				Out[2] = c.z;
+				Out[3] = c.w;
+			}
+			Out += to->Channels;
+		}
+	}
+	Quantize(to, top, bottom);
+}
+
+HRESULT CpuRenderImpl::CopyBuffer(std::vector<InputTexture*>* textureList, InputTexture* src, CommandStruct* cmd) {
+	bool IsPlanar = src->BufferY != nullptr;
+	InputTexture* Dst;
+	HR(AcquireTexture(cmd->OutputIndex, src->Width, src->Height, false, IsPlanar, false, IsPlanar ? src->BufferY->Precision : cmd->Precision, &Dst));
+
+	std::unique_ptr<CpuPass> Pass(new CpuPass());
+	if (!IsPlanar) {
+		Pass->CopySources[0] = src->Buffer;
+		Pass->Targets[0] = Dst->Buffer;
+		Pass->TargetCount = 1;
+	}
+	else {
+		Pass->CopySources[0] = src->BufferY;
+		Pass->CopySources[1] = src->BufferU;
+		Pass->CopySources[2] = src->BufferV;
+		Pass->Targets[0] = Dst->BufferY;
+		Pass->Targets[1] = Dst->BufferU;
+		Pass->Targets[2] = Dst->BufferV;
+		Pass->TargetCount = 3;
+	}
+	GetRowRange(src->Height, &Pass->Top, &Pass->Bottom);
+	RecordPass(std::move(Pass));
+
+	HR(ReplaceTexture(textureList, Dst));
+	return S_OK;
+}
+
+// Queues a pass for the next Flush. Passes reading a view that isn't bound to a frame yet, like those of the dry-run
+// recording the frame plan, have nothing to read and are skipped.
+void CpuRenderImpl::RecordPass(std::unique_ptr<CpuPass> pass) {
+	auto IsUnbound = [](const CpuTexture* texture) { return texture && !texture->Data && !texture->Frame; };
+	for (int i = 0; i < 9; i++) {
+		if (IsUnbound(pass->Args.Samplers[i].Texture))
+			return;
+	}
+	for (int i = 0; i < 3; i++) {
+		if (IsUnbound(pass->CopySources[i]))
+			return;
+	}
+	m_Passes.push_back(std::move(pass));
+}
+
+void CpuRenderImpl::RunPass(const CpuPass* pass, int top, int bottom) {
+	if (pass->CopySources[0]) {
+		for (int i = 0; i < pass->TargetCount; i++) {
+			CopyRows(pass->CopySources[i], pass->Targets[i], top, bottom);
+		}
+	}
+	else {
+		CpuTexture* Target = pass->Targets[0];
+		if (!Target->Data) {
+			// The last texture only has somewhere to go during the readback; the dry-run has no output frame.
+			if (Target == m_Output.Texture)
+				RenderToFrame(pass, top, bottom);
+			return;
+		}
+		float* Dst = Target->Data + (size_t)top * Target->Pitch;
+		if (pass->Shader)
+			pass->Shader(pass->Args, Dst, Target->Pitch, top, bottom);
+		else
+			pass->Program->Run(*pass->Program, pass->Args, Dst, Target->Pitch, top, bottom);
+		Quantize(Target, top, bottom);
+	}
+}
+
+// Rows of the last pass rendered at once by each thread before being written into the output frame.
+static thread_local std::vector<float> t_OutputRows;
+
+// Renders rows of the last pass a few at a time into a buffer that stays in the cache, and writes them into the output frame.
+void CpuRenderImpl::RenderToFrame(const CpuPass* pass, int top, int bottom) {
+	const CpuTexture* Target = pass->Targets[0];
+	const int Pitch = Target->Width * 4;
+	t_OutputRows.resize((size_t)Pitch * CPU_MIN_BAND);
+	CpuTexture Rows = { false, Target->Width, CPU_MIN_BAND, 4, Pitch, Target->Precision, t_OutputRows.data(), nullptr, 0 };
+
+	for (int y = top; y < bottom; y += CPU_MIN_BAND) {
+		const int Count = std::min(CPU_MIN_BAND, bottom - y);
+		if (pass->Shader)
+			pass->Shader(pass->Args, Rows.Data, Pitch, y, y + Count);
+		else
+			pass->Program->Run(*pass->Program, pass->Args, Rows.Data, Pitch, y, y + Count);
+		// Writing the frame rounds values like Quantize, except for D3DFMT_L8 which also replaces the other channels.
+		if (Target->Precision == 0)
+			Quantize(&Rows, 0, Count);
+
+		for (int i = 0; i < Count; i++) {
+			const float* In = Rows.Data + (size_t)i * Pitch;
+			const size_t Offset = (size_t)(y + i) * m_Output.Pitch;
+			if (m_Output.Planes[1]) {
+				for (int c = 0; c < 3; c++) {
+					WritePlaneRow(In + c, 4, Target->Width, m_Output.Planes[c] + Offset, m_Output.Precision);
+				}
+			}
+			else if (m_Output.Precision == 0)
+				WritePlaneRow(In, 4, Target->Width, m_Output.Planes[0] + Offset, 0);
+			else
+				WriteRow(In, Target->Width, m_Output.Planes[0] + Offset, m_Output.Precision);
+		}
+	}
+}
+
+// Runs the pending passes while the last texture is bound to the output frame, so that the last pass writes into it.
+HRESULT CpuRenderImpl::FlushToFrame(const CpuTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) {
+	m_Output = CpuOutput{ src, { dstY, dstU, dstV }, dstPitch, outputPrecision };
+	HRESULT hr = Flush();
+	m_Output = CpuOutput{};
+	return hr;
+}
+
+// Runs the recorded passes as a graph of bands of rows. A band waits for the bands of earlier passes writing the
+// rows it reads, found from the footprint of its shader. As textures reuse the memory of released ones, it also
+// waits for earlier bands reading or writing the rows it writes.
+HRESULT CpuRenderImpl::Flush() {
+	if (m_Passes.empty())
+		return S_OK;
+
+	struct Access {
+		const CpuTexture* Texture;
+		int Top, Bottom;
+		int Task;
+	};
+	struct TextureAccess {
+		std::vector<Access> Writers, Readers;
+	};
+	std::unordered_map<const CpuTexture*, TextureAccess> Textures;
+	std::vector<GraphTask> Tasks;
+	std::vector<int> Dependencies;
+	std::vector<Access> Reads, Writes;
+
+	auto AddOverlapping = [&](const std::vector<Access>& list, int top, int bottom) {
+		for (auto const& item : list) {
+			if (item.Top < bottom && top < item.Bottom)
+				Dependencies.push_back(item.Task);
+		}
+	};
+
+	// Bands are sized like ParallelFor: a few per thread, so that uneven rows balance out.
+	const int Threads = m_Threads->GetThreadCount();
+	for (auto const& item : m_Passes) {
+		const CpuPass* Pass = item.get();
+		int Band = (Pass->Bottom - Pass->Top + Threads * 4 - 1) / (Threads * 4);
+		if (Band < CPU_MIN_BAND)
+			Band = CPU_MIN_BAND;
+		Reads.clear();
+		Writes.clear();
+
+		for (int top = Pass->Top; top < Pass->Bottom; top += Band) {
+			const int bottom = std::min(top + Band, Pass->Bottom);
+			const int Task = (int)Tasks.size();
+			size_t FirstRead = Reads.size();
+			if (Pass->CopySources[0]) {
+				for (int i = 0; i < Pass->TargetCount; i++) {
+					Reads.push_back(Access{ Pass->CopySources[i], top, bottom, Task });
+				}
+			}
+			else {
+				for (int i = 0; i < 9; i++) {
+					const CpuSampler& Sampler = Pass->Args.Samplers[i];
+					if (!Sampler.Texture)
+						continue;
+					// Wrapped samplers, like the dither matrix, may read any row.
+					Access Read = { Sampler.Texture, 0, Sampler.Texture->Height, Task };
+					if (Pass->HasFootprint && !Sampler.Wrap)
+						GetCpuShaderInputRows(Pass->Footprint, Pass->Args.Height, Sampler.Texture->Height, top, bottom, &Read.Top, &Read.Bottom);
+					Reads.push_back(Read);
+				}
+			}
+
+			Dependencies.clear();
+			for (size_t i = FirstRead; i < Reads.size(); i++) {
+				AddOverlapping(Textures[Reads[i].Texture].Writers, Reads[i].Top, Reads[i].Bottom);
+			}
+			for (int i = 0; i < Pass->TargetCount; i++) {
+				const TextureAccess& Target = Textures[Pass->Targets[i]];
+				AddOverlapping(Target.Readers, top, bottom);
+				AddOverlapping(Target.Writers, top, bottom);
+				Writes.push_back(Access{ Pass->Targets[i], top, bottom, Task });
+			}
+			std::sort(Dependencies.begin(), Dependencies.end());
+			Dependencies.erase(std::unique(Dependencies.begin(), Dependencies.end()), Dependencies.end());
+			for (auto const dependency : Dependencies) {
+				Tasks[dependency].Next.push_back(Task);
+			}
+
+			Tasks.push_back(GraphTask());
+			Tasks.back().Dependencies = (int)Dependencies.size();
+			Tasks.back().Func = [this, Pass, top, bottom] { RunPass(Pass, top, bottom); };
+		}
+
+		// Accesses to rows the pass overwrites are ordered before it, so following bands only need to wait for the pass.
+		auto IsCovered = [Pass](const Access& item) { return item.Top >= Pass->Top && item.Bottom <= Pass->Bottom; };
+		for (int i = 0; i < Pass->TargetCount; i++) {
+			TextureAccess& Target = Textures[Pass->Targets[i]];
+			Target.Writers.erase(std::remove_if(Target.Writers.begin(), Target.Writers.end(), IsCovered), Target.Writers.end());
+			Target.Readers.erase(std::remove_if(Target.Readers.begin(), Target.Readers.end(), IsCovered), Target.Readers.end());
+		}
+		for (auto const& write : Writes) {
+			Textures[write.Texture].Writers.push_back(write);
+		}
+		for (auto const& read : Reads) {
+			Textures[read.Texture].Readers.push_back(read);
+		}
+	}
+
+	m_Threads->RunGraph(Tasks);
+	m_Passes.clear();
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::CopyDitherMatrix(std::vector<InputTexture*>* textureList, int outputIndex) {
+	CommandStruct cmd{};
+	cmd.OutputIndex = 2;
+	cmd.Precision = -1;
+	// The matrix is sampled with wrap addressing, so every tile needs all of it.
+	int Top = m_RowTop, Bottom = m_RowBottom;
+	SetRowRange(0, -1);
+	HRESULT hr = CopyBuffer(textureList, m_DitherMatrix, &cmd);
+	SetRowRange(Top, Bottom);
+	HR(hr);
+	m_Wrap[outputIndex - 1] = true;
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::InitPixelShader(CommandStruct* cmd, int planeOut) {
+	// Bundled shaders are identified by their file name and run natively.
+	cpu_shader_t* Shader = &m_Shaders[cmd->CommandIndex + planeOut];
+	CpuProgram** Program = &m_Programs[cmd->CommandIndex + planeOut];
+	if (*Shader || *Program)
+		return S_OK;
+
+	*Shader = GetCpuShader(cmd->Path);
+	if (*Shader) {
+		m_HasFootprint[cmd->CommandIndex + planeOut] = GetCpuShaderFootprint(cmd->Path, &m_Footprints[cmd->CommandIndex + planeOut]);
+		return S_OK;
+	}
+
+	// Other shaders are loaded like in D3D9RenderImpl, sharing compiled HLSL shaders, and run by the interpreter.
+	ShaderCode Code;
+	HR(GetShaderCode(cmd, false, ShaderCacheFolder.c_str(), &Code));
+
+	CpuProgram* Decoded = new CpuProgram();
+	bool Valid = DecodeCpuBytecode((const uint32_t*)Code->data(), (UINT)(Code->size() * sizeof(DWORD)), *Decoded);
+	if (!Valid) {
+		delete Decoded;
+		return E_FAIL;
+	}
+	*Program = Decoded;
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::SetPixelShaderConstant(int index, const ParamStruct* param) {
+	if (param->Type == ParamType::Float) {
+		for (int i = 0; i < param->Count && index + i < CPU_SHADER_CONSTANTS; i++) {
+			for (int j = 0; j < 4; j++) {
+				m_Constants[index + i][j] = param->Values[i * 4 + j];
+			}
+		}
+	}
+	else if (param->Type == ParamType::Int) {
+		// Int values are stored bitwise in the float array.
+		const int* Values = (const int*)param->Values;
+		for (int i = 0; i < param->Count && index + i < CPU_INT_CONSTANTS; i++) {
+			for (int j = 0; j < 4; j++) {
+				m_IntConstants[index + i][j] = Values[i * 4 + j];
+			}
+		}
+	}
+	else if (param->Type == ParamType::Bool) {
+		// Each value holds a bool in its first byte; see Shader::ParseParam.
+		for (int i = 0; i < param->Count && index + i < CPU_BOOL_CONSTANTS; i++) {
+			m_BoolConstants[index + i] = *(const bool*)&param->Values[i];
+		}
+	}
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int /*width*/, int /*height*/, InputTexture* dst) {
+	CpuTexture* Dst = dst->Buffer;
+	if (!Dst)
+		return E_FAIL;
+	// Pending passes may read the memory of the texture, or the frame a view is bound to.
+	HR(Flush());
+	if (!Dst->Data)
+		return BindFrame(src, srcPitch, clipPrecision, Dst);
+	if (clipPrecision == 0) {
+		CopyPlaneFromAviSynth(src, srcPitch, 0, Dst);
+		return S_OK;
+	}
+
+	ForEachBand(Dst->Height, [&](int top, int bottom) {
+		for (int y = top; y < bottom; y++) {
+			float* Out = Dst->Data + (size_t)y * Dst->Pitch;
+			const byte* In = src + (size_t)y * srcPitch;
+			if (clipPrecision == 1) {
+				// D3DFMT_A8R8G8B8 is stored as BGRA
+				for (int x = 0; x < Dst->Width; x++) {
+					Out[0] = In[2] * (1.0f / 255.0f);
+					Out[1] = In[1] * (1.0f / 255.0f);
+					Out[2] = In[0] * (1.0f / 255.0f);
+					Out[3] = In[3] * (1.0f / 255.0f);
+					In += 4;
+					Out += 4;
+				}
+			}
+			else if (clipPrecision == 2) {
+				// D3DFMT_A16B16G16R16 is stored as RGBA
+				const uint16_t* In16 = (const uint16_t*)In;
+				for (int x = 0; x < Dst->Width * 4; x++) {
+					Out[x] = In16[x] * (1.0f / 65535.0f);
+				}
+			}
+			else {
+				// D3DFMT_A16B16G16R16F is stored as RGBA
+				const uint16_t* In16 = (const uint16_t*)In;
+				for (int x = 0; x < Dst->Width * 4; x++) {
+					Out[x] = HalfToFloat(In16[x]);
+				}
+			}
+		}
+	});
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int /*width*/, int /*height*/, InputTexture* dst) {
+	if (!dst->BufferY)
+		return E_FAIL;
+	HR(Flush());
+	if (!dst->BufferY->Data) {
+		HR(BindFrame(srcY, srcPitch, clipPrecision, dst->BufferY));
+		HR(BindFrame(srcU, srcPitch, clipPrecision, dst->BufferU));
+		return BindFrame(srcV, srcPitch, clipPrecision, dst->BufferV);
+	}
+	CopyPlaneFromAviSynth(srcY, srcPitch, clipPrecision, dst->BufferY);
+	CopyPlaneFromAviSynth(srcU, srcPitch, clipPrecision, dst->BufferU);
+	CopyPlaneFromAviSynth(srcV, srcPitch, clipPrecision, dst->BufferV);
+	return S_OK;
+}
+
+// Binds a view to a plane of a frame instead of copying it. The view was created with the precision of the clip.
+HRESULT CpuRenderImpl::BindFrame(const byte* src, int srcPitch, int clipPrecision, CpuTexture* view) {
+	if (view->Precision != clipPrecision)
+		return E_FAIL;
+	view->Frame = src;
+	view->FramePitch = srcPitch;
+	return S_OK;
+}
+
+// Reads a D3DFMT_L8, D3DFMT_L16 or D3DFMT_R16F plane.
+void CpuRenderImpl::CopyPlaneFromAviSynth(const byte* src, int srcPitch, int clipPrecision, CpuTexture* dst) {
+	ForEachBand(dst->Height, [&](int top, int bottom) {
+		for (int y = top; y < bottom; y++) {
+			float* Out = dst->Data + (size_t)y * dst->Pitch;
+			const byte* In = src + (size_t)y * srcPitch;
+			const uint16_t* In16 = (const uint16_t*)In;
+			for (int x = 0; x < dst->Width; x++) {
+				float Value = clipPrecision <= 1 ? In[x] * (1.0f / 255.0f) : clipPrecision == 2 ? In16[x] * (1.0f / 65535.0f) : HalfToFloat(In16[x]);
+				if (dst->Channels == 1)
+					Out[x] = Value;
+				else {
+					Out[x * 4] = Value;
+					Out[x * 4 + 1] = Value;
+					Out[x * 4 + 2] = Value;
+					Out[x * 4 + 3] = 1.0f;
+				}
+			}
+		}
+	});
+}
+
+HRESULT CpuRenderImpl::CopyBufferToAviSynth(InputTexture* src, byte* dst, int dstPitch, int outputPrecision) {
+	const CpuTexture* Src = src->Buffer;
+	if (!Src)
+		return E_FAIL;
+	if (!Src->Data)
+		return FlushToFrame(Src, dst, nullptr, nullptr, dstPitch, outputPrecision);
+	HR(Flush());
+	if (outputPrecision == 0) {
+		CopyPlaneToAviSynth(Src, 0, dst, dstPitch, 0);
+		return S_OK;
+	}
+
+	ForEachBand(Src->Height, [&](int top, int bottom) {
+		for (int y = top; y < bottom; y++) {
+			WriteRow(Src->Data + (size_t)y * Src->Pitch, Src->Width, dst + (size_t)y * dstPitch, outputPrecision);
+		}
+	});
+	return S_OK;
+}
+
+HRESULT CpuRenderImpl::CopyBufferToAviSynthPlanar(InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) {
+	if (!src->Buffer)
+		return E_FAIL;
+	if (!src->Buffer->Data)
+		return FlushToFrame(src->Buffer, dstY, dstU, dstV, dstPitch, outputPrecision);
+	HR(Flush());
+	CopyPlaneToAviSynth(src->Buffer, 0, dstY, dstPitch, outputPrecision);
+	CopyPlaneToAviSynth(src->Buffer, 1, dstU, dstPitch, outputPrecision);
+	CopyPlaneToAviSynth(src->Buffer, 2, dstV, dstPitch, outputPrecision);
+	return S_OK;
+}
+
+// Writes one channel as a D3DFMT_L8, D3DFMT_L16 or D3DFMT_R16F plane.
+void CpuRenderImpl::CopyPlaneToAviSynth(const CpuTexture* src, int channel, byte* dst, int dstPitch, int outputPrecision) {
+	ForEachBand(src->Height, [&](int top, int bottom) {
+		for (int y = top; y < bottom; y++) {
+			WritePlaneRow(src->Data + (size_t)y * src->Pitch + channel, src->Channels, src->Width, dst + (size_t)y * dstPitch, outputPrecision);
+		}
+	});
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "avisynth.h"
+#include "D3D9Macros.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "RenderEngine.h"
+#include "CommandStruct.h"
+#include "CpuMemoryPool.h"
+#include "CpuShaders.h"
+#include "CpuBytecode.h"
+#include "ThreadPool.h"
+#include "TextureList.h"
+#include "Dither.h"
+
+/* Executes the command chain on the CPU with native ports of the bundled shaders, for systems without a
+   Direct3D 9 graphic card or where the GPU is busy. Other shaders run on the bytecode interpreter of
+   CpuBytecode.h. Textures are held as 32-bit floats and rounded to the precision of their D3D9 format
+   after each pass so that results match the GPU engine.
+   Input clips aren't copied: their textures read the AviSynth frames in place, decoding texels as they are sampled.
+   Likewise the last pass writes its rows straight into the output frame instead of a texture read back afterwards.
+
+   Passes aren't run as they are issued: they are recorded until the result is read back, then run as a graph
+   of bands where each band starts as soon as the bands it reads are done, without waiting for whole passes. */
+
+class CpuRenderImpl : public RenderEngine {
+public:
+	CpuRenderImpl();
+	~CpuRenderImpl();
+
+	HRESULT Initialize(int clipPrecision[9], int precision, int outputPrecision, bool planarOut, ThreadPool* threads, IScriptEnvironment* env);
+	HRESULT CreateTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) override;
+	HRESULT CopyBuffer(std::vector<InputTexture*>* textureList, InputTexture* src, CommandStruct* cmd) override;
+	HRESULT ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut) override;
+	HRESULT InitPixelShader(CommandStruct* cmd, int planeOut) override;
+	HRESULT SetPixelShaderConstant(int index, const ParamStruct* param) override;
+	HRESULT CopyDitherMatrix(std::vector<InputTexture*>* textureList, int outputIndex) override;
+	HRESULT ResetSamplerState() override;
+	HRESULT CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) override;
+	HRESULT CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) override;
+	HRESULT CopyBufferToAviSynth(InputTexture* src, byte* dst, int dstPitch, int outputPrecision) override;
+	HRESULT CopyBufferToAviSynthPlanar(InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) override;
+	void SetRowRange(int top, int bottom) override;
+	MemoryPoolStats GetPoolStats() override { return m_Pool->GetStats(); }
+	cpu_shader_t m_Shaders[80] = { 0 };
+	CpuProgram* m_Programs[80] = { 0 };	// Shaders without a native port
+	CpuShaderFootprint m_Footprints[80] = {};
+	bool m_HasFootprint[80] = { 0 };		// Whether m_Footprints is known; other shaders read whole inputs
+	CpuMemoryPool* m_Pool = nullptr;
+	InputTexture* m_DitherMatrix = nullptr;
+
+protected:
+	HRESULT ReleaseTextureMemory(InputTexture* texture) override;
+	HRESULT ReserveTextureMemory(InputTexture* texture) override;
+
+private:
+	HRESULT AllocateTextureMemory(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture);
+
+	// A render or copy recorded for the next Flush.
+	struct CpuPass {
+		cpu_shader_t Shader;
+		const CpuProgram* Program;
+		CpuShaderArgs Args;
+		float Constants[CPU_SHADER_CONSTANTS][4];
+		int IntConstants[CPU_INT_CONSTANTS][4];
+		bool BoolConstants[CPU_BOOL_CONSTANTS];
+		bool HasFootprint;
+		CpuShaderFootprint Footprint;
+		const CpuTexture* CopySources[3];	// Set for copies, into the target of the same index
+		CpuTexture* Targets[3];
+		int TargetCount;
+		int Top, Bottom;				// Rows of the targets to compute
+	};
+
+	// Output frame that the last texture, a view, is written to while the readback flushes the passes.
+	struct CpuOutput {
+		const CpuTexture* Texture;
+		byte* Planes[3];	// Y, U and V planes with PlanarOut, otherwise only the first one
+		int Pitch;
+		int Precision;
+	};
+
+	HRESULT Flush();
+	void RecordPass(std::unique_ptr<CpuPass> pass);
+	void RunPass(const CpuPass* pass, int top, int bottom);
+	void RenderToFrame(const CpuPass* pass, int top, int bottom);
+	HRESULT FlushToFrame(const CpuTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision);
+	void CopyRows(const CpuTexture* from, CpuTexture* to, int top, int bottom);
+	HRESULT ReplaceTexture(std::vector<InputTexture*>* textureList, InputTexture* item);
+	int GetInputPrecision(int clipIndex, int shaderPrecision);
+	void Quantize(CpuTexture* texture, int top, int bottom);
+	HRESULT BindFrame(const byte* src, int srcPitch, int clipPrecision, CpuTexture* view);
+	void CopyPlaneFromAviSynth(const byte* src, int srcPitch, int clipPrecision, CpuTexture* dst);
+	void CopyPlaneToAviSynth(const CpuTexture* src, int channel, byte* dst, int dstPitch, int outputPrecision);
+	void GetRowRange(int height, int* top, int* bottom);
+	void ForEachBand(int height, const std::function<void(int, int)>& func);
+
+	ThreadPool* m_Threads = nullptr;
+	float m_Constants[CPU_SHADER_CONSTANTS][4] = { { 0 } };
+	int m_IntConstants[CPU_INT_CONSTANTS][4] = { { 0 } };
+	bool m_BoolConstants[CPU_BOOL_CONSTANTS] = { 0 };
+	bool m_Wrap[9] = { 0 };
+	int m_RowTop = 0;
+	int m_RowBottom = -1;
+	std::vector<std::unique_ptr<CpuPass>> m_Passes;
+	CpuOutput m_Output = {};
+
+	int m_Precision;
+	int m_ClipPrecision[9];
+	int m_OutputPrecision;
+	bool m_PlanarOut;
+};
@@ -0,0 +1,810 @@
+// Native C++ ports of the bundled pixel shaders (see Shaders\Src), executed by the CPU engine.
+// Each kernel follows its HLSL source step by step so that the output matches the GPU within float rounding.
+// Kernels are selected by the file name of the compiled shader they replace.
+
+#include "CpuShaders.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Float3 {
+	float x, y, z;
+};
+
+static inline Float3 operator+(Float3 a, Float3 b) { return Float3{ a.x + b.x, a.y + b.y, a.z + b.z }; }
+static inline Float3 operator-(Float3 a, Float3 b) { return Float3{ a.x - b.x, a.y - b.y, a.z - b.z }; }
+static inline Float3 operator*(Float3 a, Float3 b) { return Float3{ a.x * b.x, a.y * b.y, a.z * b.z }; }
+static inline Float3 operator*(float s, Float3 a) { return Float3{ s * a.x, s * a.y, s * a.z }; }
+static inline Float3 operator/(Float3 a, float s) { return Float3{ a.x / s, a.y / s, a.z / s }; }
+static inline Float4 operator+(Float4 a, Float4 b) { return Float4{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+static inline Float4 operator-(Float4 a, Float4 b) { return Float4{ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+static inline Float4 operator*(Float4 a, Float4 b) { return Float4{ a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w }; }
+static inline Float4 operator*(float s, Float4 a) { return Float4{ s * a.x, s * a.y, s * a.z, s * a.w }; }
+static inline Float4 operator*(Float4 a, float s) { return s * a; }
+static inline Float4 operator/(Float4 a, float s) { return Float4{ a.x / s, a.y / s, a.z / s, a.w / s }; }
+static inline float dot(Float3 a, Float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline Float3 xyz(Float4 a) { return Float3{ a.x, a.y, a.z }; }
+static inline Float4 float4(Float3 a, float w) { return Float4{ a.x, a.y, a.z, w }; }
+static inline float saturate(float x) { return x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x; }
+static inline float lerp(float a, float b, float t) { return a + t * (b - a); }
+static inline Float3 lerp(Float3 a, Float3 b, float t) { return a + t * (b - a); }
+static inline Float4 lerp(Float4 a, Float4 b, Float4 t) { return a + t * (b - a); }
+static inline float step(float a, float x) { return x >= a ? 1.0f : 0.0f; }
+static inline Float3 min(Float3 a, Float3 b) { return Float3{ std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+static inline Float3 max(Float3 a, Float3 b) { return Float3{ std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+// Texture coordinate at the center of pixel i, as interpolated by the rasterizer.
+static inline float TexCoord(int i, int size) {
+	return (i + 0.5f) * (1.0f / size);
+}
+
+// Runs main(u, v) for every pixel in rows [top, bottom) and writes the results into dst.
+template <typename F>
+static inline void Render(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom, F main) {
+	for (int y = top; y < bottom; y++) {
+		float* Out = dst + (size_t)(y - top) * dstPitch;
+		const float v = TexCoord(y, a.Height);
+		for (int x = 0; x < a.Width; x++) {
+			Float4 c = main(TexCoord(x, a.Width), v);
+			Out[0] = c.x;
+			Out[1] = c.y;
+			Out[2] = c.z;
+			Out[3] = c.w;
+			Out += 4;
+		}
+	}
+}
+
+
+// ColourProcessing.hlsl
+
+struct Rec709 { static constexpr float Kb = 0.0722f, Kr = 0.2126f; static constexpr bool LimitedRange = true; };
+struct Rec601 { static constexpr float Kb = 0.114f, Kr = 0.299f; static constexpr bool LimitedRange = true; };
+struct Pc709 { static constexpr float Kb = 0.0722f, Kr = 0.2126f; static constexpr bool LimitedRange = false; };
+struct Pc601 { static constexpr float Kb = 0.114f, Kr = 0.299f; static constexpr bool LimitedRange = false; };
+
+// Rec709 gamma curve
+static inline float Gamma(float x) { return x < 0.018f ? x * 4.506198600878514f : 1.099f * std::pow(x, 0.45f) - 0.099f; }
+static inline float GammaInv(float x) { return x < 0.018f * 4.506198600878514f ? x / 4.506198600878514f : std::pow((x + 0.099f) / 1.099f, 1 / 0.45f); }
+static inline Float3 Gamma(Float3 c) { return Float3{ Gamma(c.x), Gamma(c.y), Gamma(c.z) }; }
+static inline Float3 GammaInv(Float3 c) { return Float3{ GammaInv(c.x), GammaInv(c.y), GammaInv(c.z) }; }
+
+template <typename M>
+static inline float Luma(Float3 rgb) {
+	return dot(Float3{ M::Kr, 1 - M::Kr - M::Kb, M::Kb }, rgb);
+}
+
+template <typename M>
+static inline Float3 ConvertToYUV(Float3 rgb) {
+	const float Kb = M::Kb, Kr = M::Kr;
+	const float midpoint = 0.5f + 0.5f / 255.0f;
+	Float3 yuv = Float3{
+		dot(Float3{ Kr, 1 - Kr - Kb, Kb }, rgb),
+		dot(Float3{ -Kr, Kr + Kb - 1, 1 - Kb } / (2 * (1 - Kb)), rgb),
+		dot(Float3{ 1 - Kr, Kr + Kb - 1, -Kb } / (2 * (1 - Kr)), rgb) };
+	if (!M::LimitedRange)
+		return yuv + Float3{ 0, midpoint, midpoint };
+	else
+		return yuv * Float3{ 219.0f, 224.0f, 224.0f } / 255.0f + Float3{ 16.0f / 255.0f, midpoint, midpoint };
+}
+
+template <typename M>
+static inline Float3 ConvertToRGB(Float3 yuv) {
+	const float Kb = M::Kb, Kr = M::Kr;
+	const float midpoint = 0.5f + 0.5f / 255.0f;
+	if (!M::LimitedRange)
+		yuv = yuv - Float3{ 0, midpoint, midpoint };
+	else {
+		yuv = (yuv - Float3{ 16.0f / 255.0f, midpoint, midpoint }) * Float3{ 255.0f / 219.0f, 255.0f / 224.0f, 255.0f / 224.0f };
+	}
+	return Float3{
+		dot(Float3{ 1, 0, 2 * (1 - Kr) }, yuv),
+		dot(Float3{ Kb + Kr - 1, 2 * (1 - Kb) * Kb, 2 * Kr * (1 - Kr) } / (Kb + Kr - 1), yuv),
+		dot(Float3{ 1, 2 * (1 - Kb), 0 }, yuv) };
+}
+
+
+// GammaToLinear.hlsl, LinearToGamma.hlsl, YuvTo*.hlsl, GammaToYuv.hlsl, LinearToYuv.hlsl
+
+static void gamma_to_linear(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(GammaInv(xyz(c0)), c0.w);
+	});
+}
+
+static void linear_to_gamma(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(Gamma(xyz(c0)), c0.w);
+	});
+}
+
+template <typename M>
+static void yuv_to_gamma(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(ConvertToRGB<M>(xyz(c0)), c0.w);
+	});
+}
+
+template <typename M>
+static void yuv_to_linear(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(GammaInv(ConvertToRGB<M>(xyz(c0))), c0.w);
+	});
+}
+
+template <typename M>
+static void gamma_to_yuv(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(ConvertToYUV<M>(xyz(c0)), c0.w);
+	});
+}
+
+template <typename M>
+static void linear_to_yuv(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		return float4(ConvertToYUV<M>(Gamma(xyz(c0))), c0.w);
+	});
+}
+
+
+// YVToYuv.hlsl, YVToGamma.hlsl, YVToLinear.hlsl: the 3 planes are set in s0, s1 and s2.
+
+static inline Float3 SamplePlanar(const CpuShaderArgs& a, float u, float v) {
+	return Float3{ a.Samplers[0].Sample(u, v).x, a.Samplers[1].Sample(u, v).x, a.Samplers[2].Sample(u, v).x };
+}
+
+static void yv_to_yuv(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		return float4(SamplePlanar(a, u, v), 1);
+	});
+}
+
+template <typename M>
+static void yv_to_gamma(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		return float4(ConvertToRGB<M>(SamplePlanar(a, u, v)), 1);
+	});
+}
+
+template <typename M>
+static void yv_to_linear(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		return float4(GammaInv(ConvertToRGB<M>(SamplePlanar(a, u, v))), 1);
+	});
+}
+
+
+// OutputY.hlsl, OutputU.hlsl, OutputV.hlsl
+
+template <int Channel>
+static void output_plane(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		float c = Channel == 0 ? c0.x : Channel == 1 ? c0.y : c0.z;
+		return Float4{ c, c, c, c };
+	});
+}
+
+
+// Dither.hlsl: s1 is the Bayer matrix with wrap addressing, c2 is the matrix size.
+
+static void dither(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& s1 = a.Samplers[1];
+	const float* MatrixSize = a.Constants[2];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		Float4 m = s1.Sample(u * MatrixSize[2], v * MatrixSize[3]);
+		float Bayer = (m.z * (256.0f * 255.0f) + m.y * 255.0f) * MatrixSize[2] * MatrixSize[3];
+		float Offset = (Bayer - 128.0f) / 256.0f / 255.0f;
+		return Float4{ c0.x + Offset, c0.y + Offset, c0.z + Offset, c0.w };
+	});
+}
+
+
+// SSimDownscaler.hlsl, SSimSoftDownscaler.hlsl, SSimDownscaledVarI.hlsl, SSimDownscaledVarII.hlsl
+// c0 = output size, c1 = 1 / output size, c2 = input size (width, height, 1/width, 1/height)
+//
+// SSimSoftDownscaler defines a Gaussian kernel over 2 output pixels before including SSimDownscaler.hlsl, which keeps
+// it. The variance shaders only define taps, which SSimDownscaler.hlsl redefines along with its default kernel.
+// The taps only depend on the coordinate along the scaled axis, so they are computed once per row or column
+// of the output instead of once per pixel.
+
+struct DownscaleTaps {
+	std::vector<int> Start;		// Index of the first tap of each output coordinate, plus the end of the last one
+	std::vector<float> Pos;		// Texture coordinate of each tap along the axis
+	std::vector<float> Weight;
+};
+
+static void GetDownscaleTaps(const CpuShaderArgs& a, int axis, bool soft, int first, int last, DownscaleTaps& taps) {
+	const float p0 = a.Constants[0][axis];
+	const float dxdy = a.Constants[1][axis];
+	const float InputSize = a.Constants[2][axis];
+	const float ddxddy = a.Constants[2][2 + axis];
+	const float factor = ddxddy * p0;
+	const float Taps = soft ? 2 : 1 + factor;
+	const int OutSize = axis == 0 ? a.Width : a.Height;
+
+	taps.Start.clear();
+	taps.Pos.clear();
+	taps.Weight.clear();
+	for (int i = first; i < last; i++) {
+		const float tex = TexCoord(i, OutSize);
+		const int low = (int)std::floor((tex - 0.5f * Taps * dxdy) * InputSize + 0.5f);
+		const int high = (int)std::floor((tex + 0.5f * Taps * dxdy) * InputSize + 0.5f);
+		taps.Start.push_back((int)taps.Pos.size());
+		for (int k = 0; k < high - low; k++) {
+			const float pos = ddxddy * (k + low + 0.5f);
+			const float rel = (pos - tex) * p0;
+			taps.Pos.push_back(pos);
+			taps.Weight.push_back(soft ? std::exp(-2 * rel * rel) : saturate(0.5f + (0.5f - std::abs(rel)) / factor));
+		}
+	}
+	taps.Start.push_back((int)taps.Pos.size());
+}
+
+// Runs the downscaler along axis, with the kernel of SSimSoftDownscaler if Soft is set. init(u, v) returns the per-pixel state passed to get(state, u, v) for each tap,
+// and post(avg, u, v) returns the final color.
+template <int Axis, bool Soft = false, typename Init, typename Get, typename Post>
+static void Downscale(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom, Init init, Get get, Post post) {
+	DownscaleTaps Taps;
+	if (Axis == 0)
+		GetDownscaleTaps(a, 0, Soft, 0, a.Width, Taps);
+	else
+		GetDownscaleTaps(a, 1, Soft, top, bottom, Taps);
+
+	for (int y = top; y < bottom; y++) {
+		float* Out = dst + (size_t)(y - top) * dstPitch;
+		const float v = TexCoord(y, a.Height);
+		for (int x = 0; x < a.Width; x++) {
+			const float u = TexCoord(x, a.Width);
+			const int i = Axis == 0 ? x : y - top;
+			auto State = init(u, v);
+			Float4 avg = Float4{ 0, 0, 0, 0 };
+			float W = 0;
+			for (int k = Taps.Start[i]; k < Taps.Start[i + 1]; k++) {
+				const float w = Taps.Weight[k];
+				avg = avg + w * (Axis == 0 ? get(State, Taps.Pos[k], v) : get(State, u, Taps.Pos[k]));
+				W += w;
+			}
+			Float4 c = post(avg / W, u, v);
+			Out[0] = c.x;
+			Out[1] = c.y;
+			Out[2] = c.z;
+			Out[3] = c.w;
+			Out += 4;
+		}
+	}
+}
+
+static inline int NoInit(float, float) { return 0; }
+static inline Float4 NoPost(Float4 avg, float, float) { return avg; }
+
+template <int Axis, bool Soft>
+static void ssim_downscaler(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	Downscale<Axis, Soft>(a, dst, dstPitch, top, bottom, NoInit,
+		[&](int, float u, float v) { return s0.Sample(u, v); },
+		NoPost);
+}
+
+static void ssim_downscaled_var_i(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& sMean = a.Samplers[1];
+	Downscale<0>(a, dst, dstPitch, top, bottom,
+		[&](float u, float v) { return sMean.Sample(u, v); },
+		[&](const Float4& mean, float u, float v) { Float4 d = s0.Sample(u, v) - mean; return d * d; },
+		NoPost);
+}
+
+static void ssim_downscaled_var_ii(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& sHMean = a.Samplers[1];
+	const CpuSampler& sMean = a.Samplers[2];
+	Downscale<1>(a, dst, dstPitch, top, bottom,
+		[&](float u, float v) { return sMean.Sample(u, v); },
+		[&](const Float4& mean, float u, float v) { Float4 d = sHMean.Sample(u, v) - mean; return s0.Sample(u, v) + d * d; },
+		NoPost);
+}
+
+
+// SSimConvolver.hlsl: 3-tap kernel (0.5, 1, 0.5) with coordinates clamped to the texture.
+// c1 = 1 / output size
+
+static inline float clamp01(float x) { return x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x; }
+
+template <typename T, typename Get>
+static inline T Convolve(float tex, float d, Get get) {
+	T avg = get(clamp01(tex - d)) * 0.5f + get(clamp01(tex)) + get(clamp01(tex + d)) * 0.5f;
+	return avg * 0.5f;
+}
+
+static void ssim_single_pass_convolver(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const float dx = a.Constants[1][0], dy = a.Constants[1][1];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		return Convolve<Float4>(v, dy, [&](float pv) {
+			return Convolve<Float4>(u, dx, [&](float pu) { return s0.Sample(pu, pv); });
+		});
+	});
+}
+
+struct Float2x4 {
+	Float4 r0, r1;
+};
+static inline Float2x4 operator+(const Float2x4& a, const Float2x4& b) { return Float2x4{ a.r0 + b.r0, a.r1 + b.r1 }; }
+static inline Float2x4 operator*(const Float2x4& a, float s) { return Float2x4{ a.r0 * s, a.r1 * s }; }
+
+// SSimCalcR.hlsl: s1 = mean, s2 = variance
+static void ssim_calc_r(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& sMean = a.Samplers[1];
+	const CpuSampler& sH = a.Samplers[2];
+	const float dx = a.Constants[1][0], dy = a.Constants[1][1];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		const Float4 mean = sMean.Sample(u, v);
+		Float2x4 S = Convolve<Float2x4>(v, dy, [&](float pv) {
+			return Convolve<Float2x4>(u, dx, [&](float pu) {
+				Float4 d = s0.Sample(pu, pv) - mean;
+				return Float2x4{ d * d, sH.Sample(pu, pv) };
+			});
+		});
+		return Float4{
+			S.r0.x == 0 ? 0 : std::sqrt(1 + S.r1.x / S.r0.x),
+			S.r0.y == 0 ? 0 : std::sqrt(1 + S.r1.y / S.r0.y),
+			S.r0.z == 0 ? 0 : std::sqrt(1 + S.r1.z / S.r0.z),
+			S.r0.w == 0 ? 0 : std::sqrt(1 + S.r1.w / S.r0.w) };
+	});
+}
+
+// SSimCalc.hlsl: s0 = downscaled, s1 = mean, s2 = R, c3 = strength
+static void ssim_calc(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& sL = a.Samplers[0];
+	const CpuSampler& sM = a.Samplers[1];
+	const CpuSampler& sR = a.Samplers[2];
+	const float dx = a.Constants[1][0], dy = a.Constants[1][1];
+	const float strength = a.Constants[3][0];
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		const Float4 L = sL.Sample(u, v);
+		Float4 result = Convolve<Float4>(v, dy, [&](float pv) {
+			return Convolve<Float4>(u, dx, [&](float pu) {
+				Float4 R = sR.Sample(pu, pv);
+				Float4 c = lerp(sM.Sample(pu, pv), L, R);
+				return Float4{ c.x, c.y, c.z, dot(xyz(R), xyz(R)) };
+			});
+		});
+		float t = strength / (strength + (1 - strength) * result.w / 200);
+		return L + t * (result - L);
+	});
+}
+
+
+// SuperResDownscaleAndDiff.hlsl: s0 = image downscaled horizontally, s1 = original, c2 = size of s0.
+// With ConvertGamma, s1 is YUV and is converted to RGB with the matrix M.
+
+template <typename M, bool ConvertGamma>
+static void super_res_downscale_and_diff(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& s1 = a.Samplers[1];
+	Downscale<1>(a, dst, dstPitch, top, bottom, NoInit,
+		[&](int, float u, float v) { return s0.Sample(u, v); },
+		[&](Float4 c0, float u, float v) {
+			Float4 c1 = s1.Sample(u, v);
+			Float3 c = Gamma(xyz(c0));
+			Float3 c1rgb = ConvertGamma ? ConvertToRGB<M>(xyz(c1)) : xyz(c1);
+			return float4(c - c1rgb, Luma<M>(c));
+		});
+}
+
+
+// SuperRes.hlsl: s0 = current image, s1 = output of SuperResDownscaleAndDiff,
+// c2 = original size, c3 = output size, c4 = (strength, softness, pass, passes)
+
+template <typename M, bool FinalPass, bool ConvertGamma, bool SkipSoftening>
+static void super_res(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const CpuSampler& sDiff = a.Samplers[1];
+	const float* originalSize = a.Constants[2];
+	const float* sizeOutput = a.Constants[3];
+	const float strength = a.Constants[4][0];
+	const float softness = a.Constants[4][1];
+	const float acuity = 6.0f;
+	const float softAcuity = 6.0f;
+	const float radius = 0.5f;
+	const float pi = std::acos(-1.0f);
+	const int taps = 4;
+	// Kernel(x) = cos(pi * x / taps) for X, Y in [minX, maxX]
+	const int minX = 1 - (int)std::ceil(taps / 2.0f);
+	const int maxX = (int)std::floor(taps / 2.0f);
+	// Offset of the softening taps: sqrt(ddxddy/dxdy)*dxdy
+	const float SoftX = std::sqrt(originalSize[2] / sizeOutput[2]) * sizeOutput[2];
+	const float SoftY = std::sqrt(originalSize[3] / sizeOutput[3]) * sizeOutput[3];
+
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		Float4 c0 = s0.Sample(u, v);
+		const Float4 Lin = c0;
+		Float3 c = Gamma(xyz(c0));
+
+		// Calculate position
+		float posX = u * originalSize[0] - 0.5f;
+		float posY = v * originalSize[1] - 0.5f;
+		const float offsetX = posX - std::floor(posX);
+		const float offsetY = posY - std::floor(posY);
+		posX -= offsetX;
+		posY -= offsetY;
+
+		// Calculate faithfulness force
+		float weightSum = 0;
+		Float3 diff = Float3{ 0, 0, 0 };
+		const float luma = Luma<M>(c);
+		for (int X = minX; X <= maxX; X++) {
+			const float kernelX = std::cos(pi * (X - offsetX) / taps);
+			const float DiffU = originalSize[2] * (posX + X + 0.5f);
+			for (int Y = minX; Y <= maxX; Y++) {
+				Float4 Diff = sDiff.Sample(DiffU, originalSize[3] * (posY + Y + 0.5f));
+				const float dI = acuity * (luma - Diff.w);
+				const float dI2 = dI * dI;
+				const float weight = kernelX * std::cos(pi * (Y - offsetY) / taps) / (1 + dI2);
+
+				diff = diff + weight * xyz(Diff);
+				weightSum += weight;
+			}
+		}
+		diff = diff / weightSum;
+
+		c = c - strength * diff;
+
+		if (!FinalPass) {
+			// Convert back to linear light
+			c = GammaInv(c);
+
+			if (!SkipSoftening) {
+				weightSum = 0;
+				Float3 soft = Float3{ 0, 0, 0 };
+				for (int X = -1; X <= 1; X++) {
+					for (int Y = -1; Y <= 1; Y++) {
+						if (X != 0 || Y != 0) {
+							const Float3 dI = xyz(s0.Sample(u + SoftX * X, v + SoftY * Y)) - xyz(Lin);
+							const float dI2 = softAcuity * softAcuity * dot(dI, dI);
+							const float dXY2 = (X * X + Y * Y) / (radius * radius);
+							const float r = 1 / std::sqrt(dXY2 + dI2);
+							const float weight = r * r * r; // Fundamental solution to the 5d Laplace equation
+
+							soft = soft + weight * dI;
+							weightSum += weight;
+						}
+					}
+				}
+				soft = soft / weightSum;
+
+				c = c + softness * soft;
+			}
+		}
+		else if (ConvertGamma) {
+			// Tweak: Convert back to YUV.
+			c = ConvertToYUV<M>(c);
+		}
+
+		return float4(c, c0.w);
+	});
+}
+
+
+// SuperXbr.hlsl: c2 = (edge strength, weight), c3 = input size (width, height, 1/width, 1/height)
+
+static inline float df(float A, float B) {
+	return std::abs(A - B);
+}
+
+static inline float Luma709(Float3 color) {
+	return dot(color, Float3{ .2126f, .7152f, .0722f });
+}
+
+template <int Pass>
+static void super_xbr(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const float XBR_EDGE_STR = a.Constants[2][0];
+	const float XBR_WEIGHT = a.Constants[2][1];
+	const float* size0 = a.Constants[3];
+	const float wp1 = 1.0f;
+	const float wp2 = 0.0f;
+	const float wp3 = 0.0f;
+	const float wp4 = Pass == 0 ? 2.0f : Pass == 1 ? 4.0f : 0.0f;
+	const float wp5 = Pass == 1 ? 0.0f : -1.0f;
+	const float wp6 = 0.0f;
+	const float weight1 = Pass == 1 ? XBR_WEIGHT * 1.75068f / 10.0f : XBR_WEIGHT * 1.29633f / 10.0f;
+	const float weight2 = Pass == 1 ? XBR_WEIGHT * 1.29633f / 10.0f / 2.0f : XBR_WEIGHT * 1.75068f / 10.0f / 2.0f;
+
+	auto d_wd = [&](float b0, float b1, float c0, float c1, float c2, float d0, float d1, float d2, float d3, float e1, float e2, float e3, float f2, float f3) {
+		return (wp1 * (df(c1, c2) + df(c1, c0) + df(e2, e1) + df(e2, e3)) + wp2 * (df(d2, d3) + df(d0, d1)) + wp3 * (df(d1, d3) + df(d0, d2)) + wp4 * df(d1, d2) + wp5 * (df(c0, c2) + df(e1, e3)) + wp6 * (df(b0, b1) + df(f2, f3)));
+	};
+	auto hv_wd = [&](float i1, float i2, float i3, float i4, float e1, float e2, float e3, float e4) {
+		return (wp4 * (df(i1, i2) + df(i3, i4)) + wp1 * (df(i1, e1) + df(i2, e2) + df(i3, e3) + df(i4, e4)) + wp3 * (df(i1, e2) + df(i3, e4) + df(e1, i2) + df(e3, i4)));
+	};
+
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		// Skip pixels on wrong grid
+		if (Pass == 0) {
+			float fx = u * size0[0], fy = v * size0[1];
+			if (fx - std::floor(fx) < 0.5f || fy - std::floor(fy) < 0.5f)
+				return s0.Sample(u, v);
+		}
+		else if (Pass == 1) {
+			float fx = u * size0[0] / 2.0f, fy = v * size0[1] / 2.0f;
+			float dirX = fx - std::floor(fx) - 0.5f, dirY = fy - std::floor(fy) - 0.5f;
+			if (dirX * dirY > 0.0f)
+				return s0.Sample(u, v);
+		}
+
+		auto Get = [&](int x, int y) {
+			if (Pass == 0)
+				return xyz(s0.Sample(u + size0[2] * x, v + size0[3] * y));
+			else if (Pass == 1)
+				return xyz(s0.Sample(u + size0[2] * (x + y - 1), v + size0[3] * (y - x)));
+			else
+				return xyz(s0.Sample(u - size0[2] * x, v - size0[3] * y));
+		};
+
+		const Float3 P0 = Get(-1, -1);
+		const Float3 P1 = Get(2, -1);
+		const Float3 P2 = Get(-1, 2);
+		const Float3 P3 = Get(2, 2);
+
+		const Float3 B = Get(0, -1);
+		const Float3 C = Get(1, -1);
+		const Float3 D = Get(-1, 0);
+		const Float3 E = Get(0, 0);
+		const Float3 F = Get(1, 0);
+		const Float3 G = Get(-1, 1);
+		const Float3 H = Get(0, 1);
+		const Float3 I = Get(1, 1);
+
+		const Float3 F4 = Get(2, 0);
+		const Float3 I4 = Get(2, 1);
+		const Float3 H5 = Get(0, 2);
+		const Float3 I5 = Get(1, 2);
+
+		const float b = Luma709(B);
+		const float c = Luma709(C);
+		const float d = Luma709(D);
+		const float e = Luma709(E);
+		const float f = Luma709(F);
+		const float g = Luma709(G);
+		const float h = Luma709(H);
+		const float i = Luma709(I);
+
+		const float i4 = Luma709(I4); const float p0 = Luma709(P0);
+		const float i5 = Luma709(I5); const float p1 = Luma709(P1);
+		const float h5 = Luma709(H5); const float p2 = Luma709(P2);
+		const float f4 = Luma709(F4); const float p3 = Luma709(P3);
+
+		// Calc edgeness in diagonal directions.
+		const float d_edge = (d_wd(d, b, g, e, c, p2, h, f, p1, h5, i, f4, i5, i4) - d_wd(c, f4, b, f, i4, p0, e, i, p3, d, h, i5, g, h5));
+
+		// Calc edgeness in horizontal/vertical directions.
+		const float hv_edge = (hv_wd(f, i, e, h, c, i5, b, h5) - hv_wd(e, f, h, i, d, f4, g, i4));
+
+		// Filtering and normalization in four direction generating four colors.
+		const float w1a = -weight1, w1b = weight1 + 0.5f;
+		const float w2a = -weight2, w2b = weight2 + 0.25f;
+		const Float3 c1 = w1a * P2 + w1b * H + w1b * F + w1a * P1;
+		const Float3 c2 = w1a * P0 + w1b * E + w1b * I + w1a * P3;
+		const Float3 c3 = (w2a * D + w2b * E + w2b * F + w2a * F4) + (w2a * G + w2b * H + w2b * I + w2a * I4);
+		const Float3 c4 = (w2a * C + w2b * F + w2b * I + w2a * I5) + (w2a * B + w2b * E + w2b * H + w2a * H5);
+
+		// Smoothly blends the two strongest directions (one in diagonal and the other in vert/horiz direction).
+		const float limits = XBR_EDGE_STR + 0.000001f;
+		const float t = saturate(std::abs(d_edge) / limits);
+		const float edge_strength = t * t * (3 - 2 * t);
+		Float3 color = lerp(lerp(c1, c2, step(0.0f, d_edge)), lerp(c3, c4, step(0.0f, hv_edge)), 1 - edge_strength);
+
+		// Anti-ringing code.
+		const Float3 Ring = lerp((P2 - H) * (F - P1), (P0 - E) * (I - P3), step(0.0f, d_edge));
+		const Float3 min_sample = min(E, min(F, min(H, I))) + Ring;
+		const Float3 max_sample = max(E, max(F, max(H, I))) - Ring;
+		color = min(max(color, min_sample), max_sample);
+
+		return float4(color, 1.0f);
+	});
+}
+
+
+// Bicubic.hlsl: c0 = output size, c1 = input size, c2 = (B, C)
+
+static void bicubic(const CpuShaderArgs& a, float* dst, int dstPitch, int top, int bottom) {
+	const CpuSampler& s0 = a.Samplers[0];
+	const float* out_size = a.Constants[0];
+	const float* in_size = a.Constants[1];
+	const float B = a.Constants[2][0];
+	const float C = a.Constants[2][1];
+	const float support_size = 2;
+
+	auto cubic = [&](float x) {
+		float ax = std::abs(x);
+		if (ax < 1.f)
+			return (((12.f - 9.f * B - 6.f * C) * ax + (-18.f + 12.f * B + 6.f * C)) * ax * ax + (6.f - 2.f * B)) * .16666666666666666666666666666667f;
+		else if (ax < 2.f)
+			return ((((-B - 6.f * C) * ax + (6.f * B + 30.f * C)) * ax * ax + (-12.f * B - 48.f * C) * ax + (8.f * B + 24.f * C))) * .16666666666666666666666666666667f;
+		return 0.f;
+	};
+
+	float reduction_factor[2], inv_reduction_factor[2], xydia[2];
+	for (int k = 0; k < 2; k++) {
+		reduction_factor[k] = std::max(1.0f, in_size[k] * out_size[2 + k]);
+		inv_reduction_factor[k] = std::min(1.0f, out_size[k] * in_size[2 + k]);
+		xydia[k] = 2 * std::ceil(support_size * reduction_factor[k]);
+	}
+
+	Render(a, dst, dstPitch, top, bottom, [&](float u, float v) {
+		const float posX = u + in_size[2] * .5f, posY = v + in_size[3] * .5f;
+		const float fX = posX * in_size[0] - std::floor(posX * in_size[0]);
+		const float fY = posY * in_size[1] - std::floor(posY * in_size[1]);
+		const float start_posX = posX + (.5f - xydia[0] / 2 - fX) * in_size[2];
+		const float start_posY = posY + (.5f - xydia[1] / 2 - fY) * in_size[3];
+
+		Float3 OUT = Float3{ 0, 0, 0 };
+		float ytaps_sum = 0;
+
+		for (int i = (int)xydia[1]; i--; ) {
+			Float3 tmp = Float3{ 0, 0, 0 };
+			float pos_y = start_posY + i * in_size[3];
+			float xtaps_sum = 0;
+			float y_weight = (pos_y < 0 || pos_y > 1) ? 0 : cubic((1 - fY - xydia[1] / 2 + i) * inv_reduction_factor[1]);
+
+			if (y_weight != 0) {
+				for (int j = (int)xydia[0]; j--; ) {
+					float pos_x = start_posX + j * in_size[2];
+					float x_weight = (pos_x < 0 || pos_x > 1) ? 0 : cubic((1 - fX - xydia[0] / 2 + j) * inv_reduction_factor[0]);
+
+					if (x_weight != 0) {
+						tmp = tmp + x_weight * xyz(s0.Sample(pos_x, pos_y));
+						xtaps_sum += x_weight;
+					}
+				}
+
+				if (xtaps_sum != 0)
+					tmp = tmp / xtaps_sum;
+
+				OUT = OUT + y_weight * tmp;
+				ytaps_sum += y_weight;
+			}
+		}
+
+		if (ytaps_sum != 0)
+			OUT = OUT / ytaps_sum;
+
+		return float4(OUT, 1);
+	});
+}
+
+
+// Vertical footprints of the kernels above, in texels of the input around the row of the output pixel.
+const CpuShaderFootprint SamePixel = { 0, 0 };
+const CpuShaderFootprint DownscaleY = { 0.5f, 0.5f };	// Taps span (1 + input / output) input rows
+const CpuShaderFootprint SoftDownscaleY = { 0, 1 };		// Taps span 2 output rows
+const CpuShaderFootprint Convolver = { 0, 1 };			// One output row on each side
+const CpuShaderFootprint SuperRes = { 2, 1 };			// 4 rows of the diff, and the softening taps less than an output row away
+const CpuShaderFootprint XbrPass0 = { 2, 0 };			// Rows -1 to 2 of the input
+const CpuShaderFootprint XbrPass1 = { 3, 0 };			// Diagonal taps up to 3 rows away
+const CpuShaderFootprint XbrPass2 = { 2, 0 };
+const CpuShaderFootprint Bicubic = { 3, 2 };			// 2 taps per output row on each side, plus rounding
+
+struct CpuShaderInfo {
+	cpu_shader_t Run;
+	CpuShaderFootprint Footprint;
+};
+
+static const CpuShaderInfo* FindCpuShader(const char* path) {
+	static const std::map<std::string, CpuShaderInfo> shaders = {
+		{ "gammatolinear.cso", { gamma_to_linear, SamePixel } },
+		{ "lineartogamma.cso", { linear_to_gamma, SamePixel } },
+		{ "yuvtogammarec709.cso", { yuv_to_gamma<Rec709>, SamePixel } },
+		{ "yuvtogammarec601.cso", { yuv_to_gamma<Rec601>, SamePixel } },
+		{ "yuvtogammapc709.cso", { yuv_to_gamma<Pc709>, SamePixel } },
+		{ "yuvtogammapc601.cso", { yuv_to_gamma<Pc601>, SamePixel } },
+		{ "yuvtolinearrec709.cso", { yuv_to_linear<Rec709>, SamePixel } },
+		{ "yuvtolinearrec601.cso", { yuv_to_linear<Rec601>, SamePixel } },
+		{ "yuvtolinearpc709.cso", { yuv_to_linear<Pc709>, SamePixel } },
+		{ "yuvtolinearpc601.cso", { yuv_to_linear<Pc601>, SamePixel } },
+		{ "gammatoyuvrec709.cso", { gamma_to_yuv<Rec709>, SamePixel } },
+		{ "gammatoyuvrec601.cso", { gamma_to_yuv<Rec601>, SamePixel } },
+		{ "gammatoyuvpc709.cso", { gamma_to_yuv<Pc709>, SamePixel } },
+		{ "gammatoyuvpc601.cso", { gamma_to_yuv<Pc601>, SamePixel } },
+		{ "lineartoyuvrec709.cso", { linear_to_yuv<Rec709>, SamePixel } },
+		{ "lineartoyuvrec601.cso", { linear_to_yuv<Rec601>, SamePixel } },
+		{ "lineartoyuvpc709.cso", { linear_to_yuv<Pc709>, SamePixel } },
+		{ "lineartoyuvpc601.cso", { linear_to_yuv<Pc601>, SamePixel } },
+		{ "yvtoyuv.cso", { yv_to_yuv, SamePixel } },
+		{ "yvtogammarec709.cso", { yv_to_gamma<Rec709>, SamePixel } },
+		{ "yvtogammarec601.cso", { yv_to_gamma<Rec601>, SamePixel } },
+		{ "yvtogammapc709.cso", { yv_to_gamma<Pc709>, SamePixel } },
+		{ "yvtogammapc601.cso", { yv_to_gamma<Pc601>, SamePixel } },
+		{ "yvtolinearrec709.cso", { yv_to_linear<Rec709>, SamePixel } },
+		{ "yvtolinearrec601.cso", { yv_to_linear<Rec601>, SamePixel } },
+		{ "yvtolinearpc709.cso", { yv_to_linear<Pc709>, SamePixel } },
+		{ "yvtolinearpc601.cso", { yv_to_linear<Pc601>, SamePixel } },
+		{ "outputy.cso", { output_plane<0>, SamePixel } },
+		{ "outputu.cso", { output_plane<1>, SamePixel } },
+		{ "outputv.cso", { output_plane<2>, SamePixel } },
+		{ "dither.cso", { dither, SamePixel } },
+		{ "ssimdownscalerx.cso", { ssim_downscaler<0, false>, SamePixel } },
+		{ "ssimdownscalery.cso", { ssim_downscaler<1, false>, DownscaleY } },
+		{ "ssimsoftdownscalerx.cso", { ssim_downscaler<0, true>, SamePixel } },
+		{ "ssimsoftdownscalery.cso", { ssim_downscaler<1, true>, SoftDownscaleY } },
+		{ "ssimdownscaledvari.cso", { ssim_downscaled_var_i, SamePixel } },
+		{ "ssimdownscaledvarii.cso", { ssim_downscaled_var_ii, DownscaleY } },
+		{ "ssimsinglepassconvolver.cso", { ssim_single_pass_convolver, Convolver } },
+		{ "ssimcalcr.cso", { ssim_calc_r, Convolver } },
+		{ "ssimcalc.cso", { ssim_calc, Convolver } },
+		{ "superresdownscaleanddiff.cso", { super_res_downscale_and_diff<Rec709, false>, DownscaleY } },
+		{ "superresdownscaleanddiffrec709.cso", { super_res_downscale_and_diff<Rec709, true>, DownscaleY } },
+		{ "superresdownscaleanddiffrec601.cso", { super_res_downscale_and_diff<Rec601, true>, DownscaleY } },
+		{ "superresdownscaleanddiffpc709.cso", { super_res_downscale_and_diff<Pc709, true>, DownscaleY } },
+		{ "superresdownscaleanddiffpc601.cso", { super_res_downscale_and_diff<Pc601, true>, DownscaleY } },
+		{ "superres.cso", { super_res<Rec709, false, false, false>, SuperRes } },
+		{ "superresskipsoft.cso", { super_res<Rec709, false, false, true>, SuperRes } },
+		{ "superresfinal.cso", { super_res<Rec709, true, false, false>, SuperRes } },
+		{ "superresfinalrec709.cso", { super_res<Rec709, true, true, false>, SuperRes } },
+		{ "superresfinalrec601.cso", { super_res<Rec601, true, true, false>, SuperRes } },
+		{ "superresfinalpc709.cso", { super_res<Pc709, true, true, false>, SuperRes } },
+		{ "superresfinalpc601.cso", { super_res<Pc601, true, true, false>, SuperRes } },
+		{ "superxbr-pass0.cso", { super_xbr<0>, XbrPass0 } },
+		{ "superxbr-pass1.cso", { super_xbr<1>, XbrPass1 } },
+		{ "superxbr-pass2.cso", { super_xbr<2>, XbrPass2 } },
+		{ "bicubic.cso", { bicubic, Bicubic } },
+	};
+
+	if (!path)
+		return nullptr;
+
+	// Only the file name matters; compare without case like Windows does.
+	std::string Name = path;
+	size_t Separator = Name.find_last_of("\\/");
+	if (Separator != std::string::npos)
+		Name = Name.substr(Separator + 1);
+	std::transform(Name.begin(), Name.end(), Name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	auto it = shaders.find(Name);
+	return it != shaders.end() ? &it->second : nullptr;
+}
+
+} // namespace
+
+cpu_shader_t GetCpuShader(const char* path) {
+	const CpuShaderInfo* Info = FindCpuShader(path);
+	return Info ? Info->Run : nullptr;
+}
+
+bool GetCpuShaderFootprint(const char* path, CpuShaderFootprint* footprint) {
+	const CpuShaderInfo* Info = FindCpuShader(path);
+	if (!Info)
+		return false;
+	*footprint = Info->Footprint;
+	return true;
+}
+
+void GetCpuShaderInputRows(const CpuShaderFootprint& footprint, int outputHeight, int inputHeight, int top, int bottom, int* inputTop, int* inputBottom) {
+	// Output row y samples around input row (y + 0.5) * Scale, plus a row for rounding.
+	double Scale = (double)inputHeight / outputHeight;
+	int Halo = (int)std::ceil(footprint.Radius + footprint.Scale * Scale) + 1;
+	*inputTop = std::max((int)std::floor(top * Scale) - Halo, 0);
+	*inputBottom = std::min((int)std::ceil(bottom * Scale) + Halo, inputHeight);
+}
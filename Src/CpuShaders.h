@@ -0,0 +1,31 @@
+#pragma once
+#include "CpuTexture.h"
+
+const int CPU_SHADER_CONSTANTS = 224; // Float constant registers of ps_3_0
+
+// State seen by the native shader kernels of the CPU engine; this matches what the pixel shader sees on the GPU.
+struct CpuShaderArgs {
+	CpuSampler Samplers[9];			// s0-s8
+	const float(*Constants)[4];		// c0-c223
+	const int(*IntConstants)[4];	// i0-i15, for shaders run by the interpreter
+	const bool* BoolConstants;		// b0-b15
+	int Width, Height;				// Render target size
+};
+
+// Renders rows [top, bottom) of the render target into dst, which holds RGBA float texels starting at row top.
+// dstPitch is in floats.
+using cpu_shader_t = void(*)(const CpuShaderArgs& args, float* dst, int dstPitch, int top, int bottom);
+
+// Rows of its inputs that a shader reads around each output pixel, in texels of the input: Radius texels plus Scale
+// texels per row of the output, which grows with downscaling. ExecuteShader uses it to compute the halo of each tile.
+struct CpuShaderFootprint {
+	float Radius;
+	float Scale;
+};
+
+// Returns the native implementation of a bundled shader from its file name, or nullptr if there is none.
+cpu_shader_t GetCpuShader(const char* path);
+// Gets the vertical footprint of a bundled shader. Returns false if it is unknown, in which case the whole inputs are needed.
+bool GetCpuShaderFootprint(const char* path, CpuShaderFootprint* footprint);
+// Gets the rows [*inputTop, *inputBottom) of an input read when rendering rows [top, bottom) of the output.
+void GetCpuShaderInputRows(const CpuShaderFootprint& footprint, int outputHeight, int inputHeight, int top, int bottom, int* inputTop, int* inputBottom);
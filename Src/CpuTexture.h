@@ -0,0 +1,92 @@
+#pragma once
+#include <cmath>
+#include "HalfFloat.h"
+
+// A texture of the CPU engine, held in system memory as 32-bit float texels.
+// Precision is the D3D9 format it stands for (see GetD3DFormat); rendered values are rounded to that precision when written.
+//
+// Input clips are views instead: they hold no texels and read the planes of the AviSynth frame they are bound to,
+// converting each texel as it is fetched, so that frames are never copied. The frame must outlive the passes reading it.
+struct CpuTexture {
+	bool Available;
+	int Width;
+	int Height;
+	int Channels;	// 4 for RGBA textures, 1 for planar and Y8 textures
+	int Pitch;		// Row stride, in floats
+	int Precision;
+	float* Data;	// nullptr for views
+	const unsigned char* Frame;	// Plane a view is bound to, in the format of its precision, or nullptr if unbound
+	int FramePitch;	// Row stride of Frame, in bytes
+};
+
+struct Float4 {
+	float x, y, z, w;
+};
+
+// Emulates a D3D9 sampler with point filtering and either clamp or wrap addressing.
+struct CpuSampler {
+	const CpuTexture* Texture;
+	bool Wrap;
+
+	// Returns the texel at integer coordinates, applying the addressing mode.
+	inline Float4 Fetch(int x, int y) const {
+		const CpuTexture* t = Texture;
+		if (!t)
+			return Float4{ 0, 0, 0, 1 };
+		if (Wrap) {
+			x %= t->Width;
+			y %= t->Height;
+			if (x < 0) x += t->Width;
+			if (y < 0) y += t->Height;
+		}
+		else {
+			x = x < 0 ? 0 : x >= t->Width ? t->Width - 1 : x;
+			y = y < 0 ? 0 : y >= t->Height ? t->Height - 1 : y;
+		}
+		if (!t->Data)
+			return FetchFrame(x, y);
+		const float* p = t->Data + (size_t)y * t->Pitch + (size_t)x * t->Channels;
+		if (t->Channels == 4)
+			return Float4{ p[0], p[1], p[2], p[3] };
+		else if (t->Precision == 3)
+			return Float4{ p[0], 1, 1, 1 }; // D3DFMT_R16F
+		else
+			return Float4{ p[0], p[0], p[0], 1 }; // D3DFMT_L8, D3DFMT_L16
+	}
+
+	// Converts a texel of the frame a view is bound to like CopyAviSynthToBuffer does.
+	inline Float4 FetchFrame(int x, int y) const {
+		const CpuTexture* t = Texture;
+		const unsigned char* Row = t->Frame + (size_t)y * t->FramePitch;
+		const uint16_t* Row16 = (const uint16_t*)Row;
+		if (t->Channels == 4) {
+			if (t->Precision == 1) {
+				// D3DFMT_A8R8G8B8 is stored as BGRA
+				const unsigned char* p = Row + (size_t)x * 4;
+				return Float4{ p[2] * (1.0f / 255.0f), p[1] * (1.0f / 255.0f), p[0] * (1.0f / 255.0f), p[3] * (1.0f / 255.0f) };
+			}
+			const uint16_t* p = Row16 + (size_t)x * 4;
+			if (t->Precision == 2)
+				return Float4{ p[0] * (1.0f / 65535.0f), p[1] * (1.0f / 65535.0f), p[2] * (1.0f / 65535.0f), p[3] * (1.0f / 65535.0f) };
+			return Float4{ HalfToFloat(p[0]), HalfToFloat(p[1]), HalfToFloat(p[2]), HalfToFloat(p[3]) };
+		}
+		float Value = t->Precision <= 1 ? Row[x] * (1.0f / 255.0f) : t->Precision == 2 ? Row16[x] * (1.0f / 65535.0f) : HalfToFloat(Row16[x]);
+		if (t->Precision == 3)
+			return Float4{ Value, 1, 1, 1 }; // D3DFMT_R16F
+		else
+			return Float4{ Value, Value, Value, 1 }; // D3DFMT_L8, D3DFMT_L16
+	}
+
+	// Returns the texel at normalized coordinates, like tex2D.
+	inline Float4 Sample(float u, float v) const {
+		if (!Texture)
+			return Float4{ 0, 0, 0, 1 };
+		return Fetch(ToTexel(u, Texture->Width), ToTexel(v, Texture->Height));
+	}
+
+	static inline int ToTexel(float u, int size) {
+		float x = std::floor(u * size);
+		// Keep out-of-range and NaN coordinates within int range before the addressing mode applies.
+		return x >= -1e9f && x <= 1e9f ? (int)x : x > 0 ? 1000000000 : -1000000000;
+	}
+};
@@ -5,6 +5,7 @@
 HRESULT D3D9Include::Open(D3DXINCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID * ppData, UINT * pBytes)
 {
     *ppData = GetResource(pFileName, pBytes, false);
+    m_IncludedFiles.push_back(pFileName);
     return ppData ? S_OK : E_FAIL;
 }
 
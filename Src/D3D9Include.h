@@ -14,9 +14,12 @@ public:
     HRESULT __stdcall Open(D3DXINCLUDE_TYPE IncludeType, LPCSTR pFileName, LPCVOID pParentData, LPCVOID *ppData, UINT *pBytes);
     HRESULT __stdcall Close(LPCVOID pData);
     LPCVOID GetResource(std::string filePath, UINT* fileLength, bool searchFile);
+    // Files opened by #include directives while compiling.
+    const std::vector<std::string>& GetIncludedFiles() { return m_IncludedFiles; }
 private:
     LPCVOID ReadBinaryFile(std::string filePath, UINT* fileLength);
     void GetDefaultPath(char* outPath, int maxSize, const char* filePath);
     static void StaticFunction() {}; // needed by GetDefaultPath
     std::vector<LPCVOID> m_OpenedFiles; // list of files that need to be closed
+    std::vector<std::string> m_IncludedFiles;
 };
\ No newline at end of file
@@ -1,5 +1,11 @@
 #pragma once
+#ifdef _WIN32
 #include "d3dx9.h"
+#else
+// Without Direct3D, the CPU engine gets HRESULT and its codes from Platform.h.
+#include "avisynth.h"
+#include "Platform.h"
+#endif
 
 template <typename T>
 inline void SafeRelease(T& p) {
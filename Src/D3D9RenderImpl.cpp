@@ -18,8 +18,10 @@ D3D9RenderImpl::D3D9RenderImpl() {
 
 D3D9RenderImpl::~D3D9RenderImpl(void) {
     ClearRenderTarget();
-    if (m_DitherMatrix)
-        ReleaseTexture(m_DitherMatrix);
+    if (m_DitherMatrix) {
+        ::ReleaseTextureMemory(m_DitherMatrix);
+        delete m_DitherMatrix;
+    }
     if (m_Pool)
         delete m_Pool;
     for (auto const item : m_RenderTargetMatrixCache) {
@@ -43,7 +45,7 @@ HRESULT D3D9RenderImpl::Initialize(HWND hDisplayWindow, int clipPrecision[9], in
 
     m_DitherMatrix = new InputTexture();
     CreateTexture(-1, DITHER_MATRIX_SIZE, DITHER_MATRIX_SIZE, true, false, false, 1, m_DitherMatrix);
-    CopyDitherMatrixToSurface(m_DitherMatrix, env);
+    CopyDitherMatrixToSurface(this, m_DitherMatrix);
 
 	// Ensure graphic card supports PlanarOut
 	if (m_PlanarOut) {
@@ -116,7 +118,7 @@ HRESULT D3D9RenderImpl::CheckDeviceFormat(D3DFORMAT format, bool renderTarget) {
 	return SUCCEEDED(hr);
 }
 
-HRESULT D3D9RenderImpl::SetRenderTarget(int width, int height, D3DFORMAT format, IScriptEnvironment* env)
+HRESULT D3D9RenderImpl::SetRenderTarget(int width, int height, D3DFORMAT format)
 {
     // Skip if current render target has right dimensions.
     if (m_pCurrentRenderTarget && m_pCurrentRenderTarget->Width == width && m_pCurrentRenderTarget->Height == height && m_pCurrentRenderTarget->Format == format)
@@ -186,6 +188,13 @@ HRESULT D3D9RenderImpl::GetRenderTargetMatrix(int width, int height, RenderTarge
 }
 
 HRESULT D3D9RenderImpl::CreateTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) {
+    HRESULT hr = AllocateTextureMemory(clipIndex, width, height, isInput, isPlanar, isLast, shaderPrecision, outTexture);
+    if (FAILED(hr))
+        ::ReleaseTextureMemory(outTexture);
+    return hr;
+}
+
+HRESULT D3D9RenderImpl::AllocateTextureMemory(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) {
     outTexture->Pool = m_Pool;
     outTexture->ClipIndex = clipIndex;
     outTexture->Width = width;
@@ -220,17 +229,17 @@ HRESULT D3D9RenderImpl::CreateTexture(int clipIndex, int width, int height, bool
 }
 
 
-HRESULT D3D9RenderImpl::ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut, IScriptEnvironment* env)
+HRESULT D3D9RenderImpl::ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut)
 {
     HR(m_pDevice->TestCooperativeLevel());
     D3DFORMAT fmt = planeOut > 0 ? GetD3DFormat(m_OutputPrecision, true) : GetD3DFormat(isLast ? m_OutputPrecision : cmd->Precision > -1 ? cmd->Precision : m_Precision, false);
-    HR(SetRenderTarget(width, height, fmt, env));
-    HR(CreateScene(textureList, cmd, isLast, planeOut, env));
-    HR(CopyFromRenderTarget(textureList, cmd, width, height, isLast, planeOut, env));
+    HR(SetRenderTarget(width, height, fmt));
+    HR(CreateScene(textureList, cmd, isLast, planeOut));
+    HR(CopyFromRenderTarget(textureList, cmd, width, height, isLast, planeOut));
     return S_OK;
 }
 
-HRESULT D3D9RenderImpl::CreateScene(std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool isLast, int planeOut, IScriptEnvironment* env)
+HRESULT D3D9RenderImpl::CreateScene(std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool isLast, int planeOut)
 {
     RenderTargetMatrix* Matrix;
     SCENE_HR(GetRenderTargetMatrix(m_pCurrentRenderTarget->Width, m_pCurrentRenderTarget->Height, &Matrix), m_pDevice);
@@ -264,7 +273,7 @@ HRESULT D3D9RenderImpl::CreateScene(std::vector<InputTexture*>* textureList, Com
                 }
             }
             else
-                env->ThrowError("Shader: Invalid clip index.");
+                SCENE_HR(E_INVALIDARG, m_pDevice);
         }
     }
 
@@ -272,7 +281,7 @@ HRESULT D3D9RenderImpl::CreateScene(std::vector<InputTexture*>* textureList, Com
     return m_pDevice->EndScene();
 }
 
-HRESULT D3D9RenderImpl::CopyFromRenderTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut, IScriptEnvironment* env)
+HRESULT D3D9RenderImpl::CopyFromRenderTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut)
 {
     InputTexture* dst;
     HR(PrepareReadTarget(textureList, cmd, width, height, planeOut, isLast, false, &dst));
@@ -298,17 +307,14 @@ HRESULT D3D9RenderImpl::CopyFromRenderTarget(std::vector<InputTexture*>* texture
             PlanarCmd.ClipIndex[0] = 1;
             PlanarCmd.OutputIndex = 1;
             PlanarCmd.Precision = m_OutputPrecision;
-            if FAILED(InitPixelShader(&PlanarCmd, 1, env))
-                env->ThrowError("ExecuteShader: OutputY.cso not found");
-            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 1, env));
+            HR(InitPixelShader(&PlanarCmd, 1));
+            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 1));
             PlanarCmd.Path = "OutputU.cso";
-            if FAILED(InitPixelShader(&PlanarCmd, 2, env))
-                env->ThrowError("ExecuteShader: OutputU.cso not found");
-            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 2, env));
+            HR(InitPixelShader(&PlanarCmd, 2));
+            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 2));
             PlanarCmd.Path = "OutputV.cso";
-            if FAILED(InitPixelShader(&PlanarCmd, 3, env))
-                env->ThrowError("ExecuteShader: OutputV.cso not found");
-            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 3, env));
+            HR(InitPixelShader(&PlanarCmd, 3));
+            HR(ProcessFrame(textureList, &PlanarCmd, width, height, true, 3));
         }
         else if (planeOut > 0) {
             // This gets called recursively from the code below for each plane.
@@ -347,21 +353,47 @@ HRESULT D3D9RenderImpl::CopyDitherMatrix(std::vector<InputTexture*>* textureList
     return S_OK;
 }
 
+HRESULT D3D9RenderImpl::CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) {
+    return ::CopyAviSynthToBuffer(src, srcPitch, clipPrecision, width, height, dst);
+}
+
+HRESULT D3D9RenderImpl::CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) {
+    return ::CopyAviSynthToPlanarBuffer(srcY, srcU, srcV, srcPitch, clipPrecision, width, height, dst);
+}
+
+HRESULT D3D9RenderImpl::CopyBufferToAviSynth(InputTexture* src, byte* dst, int dstPitch, int outputPrecision) {
+    return ::CopyBufferToAviSynth(0, src, dst, dstPitch, outputPrecision);
+}
+
+HRESULT D3D9RenderImpl::CopyBufferToAviSynthPlanar(InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) {
+    return ::CopyBufferToAviSynthPlanar(0, src, dstY, dstU, dstV, dstPitch, outputPrecision);
+}
+
+HRESULT D3D9RenderImpl::ReleaseTextureMemory(InputTexture* texture) {
+    return ::ReleaseTextureMemory(texture);
+}
+
+HRESULT D3D9RenderImpl::ReserveTextureMemory(InputTexture* texture) {
+    // The render target may have been allocated from the memory of a texture released earlier in the frame.
+    if (m_pCurrentRenderTarget && m_pCurrentRenderTarget->Surface == texture->Surface)
+        HR(ClearRenderTarget());
+    return ::ReserveTextureMemory(texture);
+}
+
 HRESULT D3D9RenderImpl::PrepareReadTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, int planeOut, bool isLast, bool isPlanar, InputTexture** outDst) {
     InputTexture* dst = FindTexture(textureList, cmd->OutputIndex);
     if (planeOut == 0) {
-        // Remove previous item with OutputIndex and replace it with new texture
+        // Remove previous item with OutputIndex and replace it with the texture of this step
         if (dst)
-            HR(RemoveTexture(textureList, dst));
-        dst = new InputTexture();
-        HR(CreateTexture(cmd->OutputIndex, width, height, false, isPlanar, isLast, cmd->Precision, dst));
+            HR(DiscardTexture(textureList, dst));
+        HR(AcquireTexture(cmd->OutputIndex, width, height, false, isPlanar, isLast, cmd->Precision, &dst));
         textureList->push_back(dst);
     }
     *outDst = dst;
     return S_OK;
 }
 
-HRESULT D3D9RenderImpl::InitPixelShader(CommandStruct* cmd, int planeOut, IScriptEnvironment* env) {
+HRESULT D3D9RenderImpl::InitPixelShader(CommandStruct* cmd, int planeOut) {
     // PlaneOut will use the next 3 shader positions
     ShaderItem* Shader = &m_Shaders[cmd->CommandIndex + planeOut];
     if (Shader->Shader)
@@ -369,49 +401,14 @@ HRESULT D3D9RenderImpl::InitPixelShader(CommandStruct* cmd, int planeOut, IScrip
 
     std::unique_lock<std::mutex> my_lock(mutex_InitPixelShader);
 
-    CComPtr<ID3DXBuffer> code;
-    LPCVOID ShaderBuf = nullptr;
-    UINT ShaderBufLength = 0;
-    DWORD* CodeBuffer = nullptr;
-    bool FromResource = false;
-
-    D3D9Include Include;
-    ShaderBuf = Include.GetResource(cmd->Path, &ShaderBufLength, m_ResourceFiles);
-    if (ShaderBuf == nullptr)
-        return E_FAIL;
-
-    if (!StringEndsWith(cmd->Path, ".hlsl")) {
-        // Precompiled shader
-        HR(D3DXGetShaderConstantTable((DWORD*)ShaderBuf, &Shader->ConstantTable));
-        CodeBuffer = (DWORD*)ShaderBuf;
-    }
-    else {
-        // Compile HLSL shader code
-        HR(D3DXCompileShader((LPCSTR)ShaderBuf, (UINT)ShaderBufLength, cmd->Defines, &Include, cmd->EntryPoint, cmd->ShaderModel, 0, &code, nullptr, &Shader->ConstantTable));
-        CodeBuffer = (DWORD*)code->GetBufferPointer();
-    }
-
-    HR(m_pDevice->CreatePixelShader(CodeBuffer, &Shader->Shader));
-
-    Include.Close(ShaderBuf);      
+    // HLSL shaders are compiled once for all engines; see ShaderCache.h.
+    ShaderCode Code;
+    HR(GetShaderCode(cmd, m_ResourceFiles, ShaderCacheFolder.c_str(), &Code));
+    HR(D3DXGetShaderConstantTable(Code->data(), &Shader->ConstantTable));
+    HR(m_pDevice->CreatePixelShader(Code->data(), &Shader->Shader));
     return S_OK;
 }
 
-
-// returns 1 if str ends with suffix
-bool D3D9RenderImpl::StringEndsWith(const char * str, const char * suffix) {
-    if (str == nullptr || suffix == nullptr)
-        return false;
-
-    size_t str_len = strlen(str);
-    size_t suffix_len = strlen(suffix);
-
-    if (suffix_len > str_len)
-        return false;
-
-    return 0 == strncmp(str + str_len - suffix_len, suffix, suffix_len);
-}
-
 HRESULT D3D9RenderImpl::SetDefaults(LPD3DXCONSTANTTABLE table) {
     return table->SetDefaults(m_pDevice);
 }
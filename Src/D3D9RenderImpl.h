@@ -9,10 +9,12 @@
 #include <vector>
 #include <algorithm>
 #include "CommandStruct.h"
+#include "RenderEngine.h"
 #include "MemoryPool.h"
 #include "TextureList.h"
 #include "Dither.h"
 #include "D3D9Include.h"
+#include "ShaderCache.h"
 
 struct RenderTargetMatrix {
 	int Width, Height;
@@ -25,35 +27,42 @@ struct ShaderItem {
 	CComPtr<ID3DXConstantTable> ConstantTable;
 };
 
-class D3D9RenderImpl {
+class D3D9RenderImpl : public RenderEngine {
 public:
 	D3D9RenderImpl();
 	~D3D9RenderImpl();
 
 	HRESULT Initialize(HWND hDisplayWindow, int clipPrecision[9], int precision, int outputPrecision, bool planarOut, bool resourceFiles, bool isMT, IScriptEnvironment* env);
-	HRESULT CreateTexture(int clipIndex, int width, int height, bool isInput, bool IsPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture);
-	HRESULT CopyBuffer(std::vector<InputTexture*>* textureList, InputTexture* src, CommandStruct* cmd);
-	HRESULT ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut, IScriptEnvironment* env);
-	HRESULT InitPixelShader(CommandStruct* cmd, int planeOut, IScriptEnvironment* env);
+	HRESULT CreateTexture(int clipIndex, int width, int height, bool isInput, bool IsPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) override;
+	HRESULT CopyBuffer(std::vector<InputTexture*>* textureList, InputTexture* src, CommandStruct* cmd) override;
+	HRESULT ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut) override;
+	HRESULT InitPixelShader(CommandStruct* cmd, int planeOut) override;
 	HRESULT SetDefaults(LPD3DXCONSTANTTABLE table);
-	HRESULT SetPixelShaderConstant(int index, const ParamStruct* param);
-	HRESULT CopyDitherMatrix(std::vector<InputTexture*>* textureList, int outputIndex);
-	HRESULT ResetSamplerState();
-	static const int maxClips = 9;
+	HRESULT SetPixelShaderConstant(int index, const ParamStruct* param) override;
+	HRESULT CopyDitherMatrix(std::vector<InputTexture*>* textureList, int outputIndex) override;
+	HRESULT ResetSamplerState() override;
+	HRESULT CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) override;
+	HRESULT CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) override;
+	HRESULT CopyBufferToAviSynth(InputTexture* src, byte* dst, int dstPitch, int outputPrecision) override;
+	HRESULT CopyBufferToAviSynthPlanar(InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) override;
+	MemoryPoolStats GetPoolStats() override { return m_Pool->GetStats(); }
 	ShaderItem m_Shaders[80] = { 0 };
-	std::mutex mutex_ProcessCommand;
 	MemoryPool* m_Pool = nullptr;
 	InputTexture* m_DitherMatrix;
 
+protected:
+	HRESULT ReleaseTextureMemory(InputTexture* texture) override;
+	HRESULT ReserveTextureMemory(InputTexture* texture) override;
+
 private:
-	bool StringEndsWith(const char * str, const char * suffix);
+	HRESULT AllocateTextureMemory(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture);
 	HRESULT CreateDevice(IDirect3DDevice9Ex** device, HWND hDisplayWindow, bool isMT);
 	HRESULT GetRenderTargetMatrix(int width, int height, RenderTargetMatrix** target);
-	HRESULT CreateScene(std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool isLast, int planeOut, IScriptEnvironment* env);
-	HRESULT CopyFromRenderTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut, IScriptEnvironment* env);
+	HRESULT CreateScene(std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool isLast, int planeOut);
+	HRESULT CopyFromRenderTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut);
 	HRESULT PrepareReadTarget(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, int planeOut, bool isLast, bool isPlanar, InputTexture** dst);
 	HRESULT CheckDeviceFormat(D3DFORMAT format, bool renderTarget);
-	HRESULT SetRenderTarget(int width, int height, D3DFORMAT format, IScriptEnvironment* env);
+	HRESULT SetRenderTarget(int width, int height, D3DFORMAT format);
 	HRESULT ClearRenderTarget();
 	HRESULT GetPresentParams(D3DPRESENT_PARAMETERS* params, HWND hDisplayWindow);
 
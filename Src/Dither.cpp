@@ -19,7 +19,7 @@ const unsigned short DITHER_MATRIX[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE] = {
 0x3ac4, 0x2800, 0x3b4a, 0x39ee, 0x2cc0, 0x3764, 0x31c8, 0x35cc, 0x3bb6, 0x39a8, 0x2f30, 0x3a1e, 0x3816, 0x3160, 0x35b0, 0x389a,
 0x3a86, 0x3070, 0x3848, 0x2d70, 0x38ba, 0x3baa, 0x2e60, 0x3414, 0x3ae4, 0x3544, 0x3a06, 0x37fc, 0x347c, 0x36d8, 0x3b12, 0x35a4};
 
-HRESULT __stdcall CopyDitherMatrixToSurface(InputTexture* dst, IScriptEnvironment* env) {
+HRESULT __stdcall CopyDitherMatrixToSurface(RenderEngine* render, InputTexture* dst) {
 	// Copy into BG values of BGRA texture
 	int TempMatrix[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE]{ };
 	for (int i = 0; i < DITHER_MATRIX_SIZE; ++i) {
@@ -28,11 +28,13 @@ HRESULT __stdcall CopyDitherMatrixToSurface(InputTexture* dst, IScriptEnvironmen
 		}
 	}
 
-	HR(CopyAviSynthToBuffer((byte*)&TempMatrix, 4 * DITHER_MATRIX_SIZE, 1, DITHER_MATRIX_SIZE, DITHER_MATRIX_SIZE, dst, env));
+	HR(render->CopyAviSynthToBuffer((byte*)&TempMatrix, 4 * DITHER_MATRIX_SIZE, 1, DITHER_MATRIX_SIZE, DITHER_MATRIX_SIZE, dst));
 	return S_OK;
 }
 
-HRESULT __stdcall CreateDitherCommand(D3D9RenderImpl* render, std::vector<InputTexture*>* textureList, CommandStruct* cmd, int commandIndex, int outputPrecision) {
+// The Bayer matrix must be copied to texture 2 with CopyDitherMatrix before running the command.
+// matrixSize receives the 4 values of Param2 and must outlive the command.
+HRESULT __stdcall CreateDitherCommand(CommandStruct* cmd, int commandIndex, int outputPrecision, float* matrixSize) {
 	cmd->CommandIndex = commandIndex;
 	cmd->EntryPoint = "main";
 	cmd->ShaderModel = "ps_3_0";
@@ -41,15 +43,12 @@ HRESULT __stdcall CreateDitherCommand(D3D9RenderImpl* render, std::vector<InputT
 	cmd->ClipIndex[1] = 2;
 	cmd->Param[2].Type = ParamType::Float;
 	cmd->Param[2].Count = 1;
-	cmd->Param[2].Values = new float[4];
+	cmd->Param[2].Values = matrixSize;
 	cmd->Param[2].Values[0] = DITHER_MATRIX_SIZE;
 	cmd->Param[2].Values[1] = DITHER_MATRIX_SIZE;
 	cmd->Param[2].Values[2] = 1.0f / DITHER_MATRIX_SIZE;
 	cmd->Param[2].Values[3] = 1.0f / DITHER_MATRIX_SIZE;
 	cmd->OutputIndex = 1;
 	cmd->Precision = outputPrecision;
-
-	// Pass Bayer Matrix to dither shader
-	render->CopyDitherMatrix(textureList, 2);
 	return S_OK;
 }
\ No newline at end of file
@@ -0,0 +1,38 @@
+#include "EngineScheduler.h"
+
+EngineScheduler::EngineScheduler(const std::vector<RenderEngine*>& engines, int lookahead) :
+	m_Idle(engines.rbegin(), engines.rend()), m_Lookahead(lookahead) {
+}
+
+// Frame n starts when it is the lowest frame waiting and within the lookahead of the oldest frame.
+bool EngineScheduler::CanStart(int n) {
+	if (m_Idle.empty() || n != *m_Waiting.begin())
+		return false;
+	if (m_Lookahead > 0 && !m_Running.empty() && n - *m_Running.begin() > m_Lookahead)
+		return false;
+	return true;
+}
+
+RenderEngine* EngineScheduler::Acquire(int n) {
+	std::unique_lock<std::mutex> my_lock(m_mutex);
+	m_Waiting.insert(n);
+	m_Available.wait(my_lock, [this, n] { return CanStart(n); });
+	m_Waiting.erase(m_Waiting.find(n));
+	m_Running.insert(n);
+	RenderEngine* Result = m_Idle.back();
+	m_Idle.pop_back();
+	// The next lowest frame may be able to start on another idle engine.
+	if (!m_Idle.empty() && !m_Waiting.empty())
+		m_Available.notify_all();
+	return Result;
+}
+
+void EngineScheduler::Release(RenderEngine* engine, int n) {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+		m_Idle.push_back(engine);
+		m_Running.erase(m_Running.find(n));
+	}
+	// Waiting threads check whether they are the next frame in order.
+	m_Available.notify_all();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <vector>
+#include "RenderEngine.h"
+
+/* Hands the engines of ExecuteShader to the threads calling GetFrame. A frame takes whichever engine is idle
+   instead of one picked in turn, so a frame that takes longer doesn't hold back the frames queued behind it
+   while other engines wait. An engine belongs to a single frame until it is released, as the textures of its
+   frame plan are shared by all the frames it processes.
+
+   When more threads than engines are waiting, engines go to the lowest frame numbers first, so that frames come
+   out in the order the encoder needs them instead of the order threads happened to arrive in. With a lookahead,
+   frames further than that past the oldest frame being processed or waiting also wait, even if an engine is idle. */
+class EngineScheduler {
+public:
+	// lookahead: How many frames past the oldest one a frame may be processed, or 0 for no limit.
+	EngineScheduler(const std::vector<RenderEngine*>& engines, int lookahead);
+
+	// Waits until an engine is available for frame n and reserves it for the calling thread.
+	RenderEngine* Acquire(int n);
+	// Returns an engine reserved with Acquire for frame n.
+	void Release(RenderEngine* engine, int n);
+
+private:
+	bool CanStart(int n);
+
+	// The engine released last is taken first, as its memory is the most likely to still be in cache.
+	std::vector<RenderEngine*> m_Idle;
+	std::multiset<int> m_Waiting;	// Frames waiting for an engine
+	std::multiset<int> m_Running;	// Frames being processed
+	int m_Lookahead;
+	std::mutex m_mutex;
+	std::condition_variable m_Available;
+};
+
+// Reserves an engine for its lifetime, so that it gets released when processing the frame throws.
+class ScopedEngine {
+public:
+	ScopedEngine(EngineScheduler* scheduler, int n) : m_Scheduler(scheduler), m_Frame(n), m_Engine(scheduler->Acquire(n)) {}
+	~ScopedEngine() { m_Scheduler->Release(m_Engine, m_Frame); }
+	ScopedEngine(const ScopedEngine&) = delete;
+	ScopedEngine& operator=(const ScopedEngine&) = delete;
+	RenderEngine* Get() { return m_Engine; }
+
+private:
+	EngineScheduler* m_Scheduler;
+	int m_Frame;
+	RenderEngine* m_Engine;
+};
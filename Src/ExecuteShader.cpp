@@ -1,14 +1,44 @@
 #include "ExecuteShader.h"
 // http://gamedev.stackexchange.com/questions/13435/loading-and-using-an-hlsl-shader
 
-ExecuteShader::ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _clip3, PClip _clip4, PClip _clip5, PClip _clip6, PClip _clip7, PClip _clip8, PClip _clip9, int _clipPrecision[9], int _precision, int _outputPrecision, bool _planarOut, int _engines, bool _resource, IScriptEnvironment* env) :
-	GenericVideoFilter(_child), m_Precision(_precision), m_OutputPrecision(_outputPrecision), m_PlanarOut(_planarOut), m_enginesCount(_engines) {
+// Allocates memory for a texture in the layout of ConvertToShader's frames, with rows aligned for the conversion kernels.
+static PackedFrame AllocatePackedFrame(int width, int height, int precision, bool planar, IScriptEnvironment* env) {
+	PackedFrame Result = { };
+	Result.Pitch = (width * GetD3DFormatSize(precision, planar) + 63) & ~63;
+	size_t PlaneSize = (size_t)Result.Pitch * height;
+	Result.Planes[0] = (byte*)_aligned_malloc(PlaneSize * (planar ? 3 : 1), 64);
+	if (!Result.Planes[0])
+		env->ThrowError("ExecuteShader: Out of memory");
+	if (planar) {
+		Result.Planes[1] = Result.Planes[0] + PlaneSize;
+		Result.Planes[2] = Result.Planes[1] + PlaneSize;
+	}
+	return Result;
+}
+
+ExecuteShader::ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _clip3, PClip _clip4, PClip _clip5, PClip _clip6, PClip _clip7, PClip _clip8, PClip _clip9, int _clipPrecision[9], int _precision, int _outputPrecision, bool _planarOut, int _engines, bool _resource, bool _cpu, int _threads, int _tileHeight, int _lookahead, int _readAhead, const char* _shaderCache, bool _convert, bool _lsbIn, bool _planarIn, int _outputFormat, bool _lsbOut, IScriptEnvironment* env) :
+	GenericVideoFilter(_child), m_Precision(_precision), m_OutputPrecision(_outputPrecision), m_PlanarOut(_planarOut), m_enginesCount(_engines), m_Cpu(_cpu), m_TileHeight(_tileHeight) {
 
 	// Validate parameters
 	if (!vi.IsY8())
 		env->ThrowError("ExecuteShader: Source must be a command chain");
+#ifndef _WIN32
+	if (!m_Cpu)
+		env->ThrowError("ExecuteShader: Cpu=false requires Direct3D 9 on Windows");
+	(void)_resource;	// Only read by the Direct3D engine
+#endif
 	if (m_enginesCount < 1)
 		env->ThrowError("ExecuteShader: Engines must be greater than 0");
+	if (_threads < 0)
+		env->ThrowError("ExecuteShader: Threads must be 0 or greater");
+	if (m_TileHeight < 0)
+		env->ThrowError("ExecuteShader: TileHeight must be 0 or greater");
+	if (m_TileHeight > 0 && !m_Cpu)
+		env->ThrowError("ExecuteShader: TileHeight requires Cpu=true");
+	if (_lookahead < 0)
+		env->ThrowError("ExecuteShader: Lookahead must be 0 or greater");
+	if (_readAhead < 0)
+		env->ThrowError("ExecuteShader: ReadAhead must be 0 or greater");
 
 	memcpy(m_ClipPrecision, _clipPrecision, sizeof(int) * 9);
 	m_clips[0] = _clip1;
@@ -27,24 +57,65 @@ ExecuteShader::ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _cl
 		m_ClipMultiplier[i] = AdjustPrecision(env, m_ClipPrecision[i]);
 	}
 
-	// Initialize
-	dummyHWND = CreateWindowA("STATIC", "dummy", 0, 0, 0, 100, 100, nullptr, nullptr, nullptr, nullptr);
+	// With Convert, clips come in their source format and are packed as ConvertToShader would while they are uploaded.
+	// Their chroma was already resampled to 4:4:4 by the script function. YUV clips read as planar 8-bit textures
+	// are uploaded as they are.
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (!m_clips[i])
+			continue;
+		const VideoInfo& ClipInfo = m_clips[i]->GetVideoInfo();
+		if (_convert && m_ClipPrecision[i] > 0 && !(m_ClipPrecision[i] == 1 && _planarIn && ClipInfo.IsYUV())) {
+			m_Packers[i] = new ShaderPacker(ClipInfo, m_ClipPrecision[i], _lsbIn, _planarIn, get_arch(-1));
+			if (!m_Packers[i]->valid())
+				env->ThrowError("ExecuteShader: Convert doesn't support the format of Clip%d with its precision; call ConvertToShader instead", i + 1);
+			m_ClipShapes[i] = TextureShape{ m_Packers[i]->texture_width(), m_Packers[i]->texture_height(), _planarIn };
+		}
+		else {
+			bool IsPlanar = ClipInfo.IsYV24();
+			if (!ClipInfo.IsRGB32() && !IsPlanar && !ClipInfo.IsY8())
+				env->ThrowError("ExecuteShader: You must first call ConvertToShader on source");
+			else if (m_ClipPrecision[i] == 0 && !ClipInfo.IsY8())
+				env->ThrowError("ExecuteShader: Clip with Precision=0 must be in Y8 format");
+			m_ClipShapes[i] = TextureShape{ ClipInfo.width / m_ClipMultiplier[i], ClipInfo.height, IsPlanar };
+		}
+	}
 
-	// Runs as MT_NICE_FILTER in AviSynth+ MT, otherwise MT_MULTI_INSTANCE
+	// Initialize. The CPU engine doesn't need a window nor a graphic card. Converting frames also runs on the threads.
+#ifdef _WIN32
+	if (!m_Cpu)
+		dummyHWND = CreateWindowA("STATIC", "dummy", 0, 0, 0, 100, 100, nullptr, nullptr, nullptr, nullptr);
+#endif
+	// Instances using all cores share one pool instead of each starting a thread per core.
+	if (m_Cpu || _convert || _outputFormat)
+		m_Threads = _threads > 0 ? std::make_shared<ThreadPool>(_threads) : ThreadPool::GetShared();
+
+	// Runs as MT_NICE_FILTER in AviSynth+ MT, otherwise MT_MULTI_INSTANCE. Frames read ahead can use
+	// several engines even when the host requests one frame at a time.
 	if (env->FunctionExists("SetFilterMTMode") && SUPPORT_MT_NICE_FILTER == true) {
-		int ThreadCount = env->GetEnvProperty(AEP_THREADPOOL_THREADS);
+		int ThreadCount = env->GetEnvProperty(AEP_THREADPOOL_THREADS) + _readAhead;
 		if (m_enginesCount > ThreadCount)
 			m_enginesCount = ThreadCount;
 	}
 	else
-		m_enginesCount = 1;
+		m_enginesCount = std::min(m_enginesCount, std::max(_readAhead, 1));
 
-	D3D9RenderImpl* NewEngine;
 	for (int i = 0; i < m_enginesCount; i++) {
-		NewEngine = new D3D9RenderImpl();
-		if (FAILED(NewEngine->Initialize(dummyHWND, m_ClipPrecision, m_Precision, m_OutputPrecision, m_PlanarOut, _resource, true, env)))
-			env->ThrowError("ExecuteShader: Initialize failed.");
-		m_engines.push_back(NewEngine);
+		if (m_Cpu) {
+			// All CPU engines share the same threads.
+			CpuRenderImpl* NewEngine = new CpuRenderImpl();
+			if (FAILED(NewEngine->Initialize(m_ClipPrecision, m_Precision, m_OutputPrecision, m_PlanarOut, m_Threads.get(), env)))
+				env->ThrowError("ExecuteShader: Initialize failed.");
+			m_engines.push_back(NewEngine);
+		}
+#ifdef _WIN32
+		else {
+			D3D9RenderImpl* NewEngine = new D3D9RenderImpl();
+			if (FAILED(NewEngine->Initialize(dummyHWND, m_ClipPrecision, m_Precision, m_OutputPrecision, m_PlanarOut, _resource, true, env)))
+				env->ThrowError("ExecuteShader: Initialize failed.");
+			m_engines.push_back(NewEngine);
+		}
+#endif
+		m_engines.back()->ShaderCacheFolder = _shaderCache;
 	}
 
 	// We must change pixel type here for the next filter to recognize it properly during its initialization
@@ -52,133 +123,398 @@ ExecuteShader::ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _cl
 	vi.pixel_type = m_PlanarOut ? VideoInfo::CS_YV24 : VideoInfo::CS_BGR32;
 
 	// vi.width and vi.height must be set during constructor
-	std::vector<InputTexture*> TextureList;
-	AllocateAndCopyInputTextures(m_engines.front(), &TextureList, 0, true, env);
-	ProcessCommandChain(m_engines.front(), &TextureList, 0, true, env);
-	if FAILED(ClearTextures(m_engines.front()->m_Pool, &TextureList))
-		env->ThrowError("ExecuteShader: ClearTextures failed");
+	CompileCommandChain(env);
+	PNeoEnv Neo(env);
+	m_ParallelFetch = !!Neo && std::count(m_ClipUsed, m_ClipUsed + RenderEngine::maxClips, true) > 1;
+
+	// Each engine packs the clips it reads into its own memory, aligned for the conversion kernels.
+	m_PackedFrames.resize(m_engines.size() * RenderEngine::maxClips, PackedFrame{});
+	for (size_t e = 0; e < m_engines.size(); e++) {
+		for (int i = 0; i < RenderEngine::maxClips; i++) {
+			if (!m_Packers[i] || !m_ClipUsed[i])
+				continue;
+			const TextureShape& Shape = m_ClipShapes[i];
+			m_PackedFrames[e * RenderEngine::maxClips + i] = AllocatePackedFrame(Shape.Width, Shape.Height, m_ClipPrecision[i], Shape.Planar, env);
+		}
+	}
+
+	// With OutputFormat, the result is unpacked like ConvertFromShader as it is read back. Planar textures are
+	// already YV24 with OutputPrecision=1 and YUV444P16 with OutputPrecision=2, and are read back as they are.
+	if (_outputFormat) {
+		int TextureWidth = vi.width / m_OutputMultiplier;
+		bool AsIs = m_PlanarOut && !_lsbOut && ((m_OutputPrecision == 1 && _outputFormat == VideoInfo::CS_YV24) ||
+			(m_OutputPrecision == 2 && _outputFormat == VideoInfo::CS_YUV444P16));
+		if (!AsIs) {
+			m_Unpacker = new ShaderUnpacker(m_OutputPrecision, m_PlanarOut, _outputFormat, _lsbOut, TextureWidth, vi.height, get_arch(-1));
+			if (!m_Unpacker->valid())
+				env->ThrowError("ExecuteShader: OutputFormat isn't supported with this OutputPrecision and PlanarOut; call ConvertFromShader instead");
+			for (size_t e = 0; e < m_engines.size(); e++) {
+				m_OutputFrames.push_back(AllocatePackedFrame(TextureWidth, vi.height, m_OutputPrecision, m_PlanarOut, env));
+			}
+			vi.height = m_Unpacker->frame_height();
+		}
+		vi.pixel_type = _outputFormat;
+		vi.width = TextureWidth;
+	}
+
+	// Running the chain on each engine records their frame plan, binding the textures of every step once.
+	// Tiles all create the same textures, so each of them runs as a frame of the plan.
+	for (auto const item : m_engines) {
+		std::vector<InputTexture*> TextureList;
+		const char* Error = AllocateAndCopyInputTextures(item, &TextureList, nullptr, 0, true);
+		if (!Error)
+			Error = ProcessCommandChain(item, &TextureList, 0);
+		if (Error)
+			env->ThrowError("%s", Error);
+		if FAILED(item->ClearTextures(&TextureList))
+			env->ThrowError("ExecuteShader: ClearTextures failed");
+	}
+	m_Scheduler = new EngineScheduler(m_engines, _lookahead);
+	if (_readAhead > 0)
+		m_ReadAhead = new FrameReadAhead(_readAhead, m_enginesCount);
 }
 
 ExecuteShader::~ExecuteShader() {
-	DestroyWindow(dummyHWND);
+	// Frames still processed in the background use the engines.
+	if (m_ReadAhead)
+		delete m_ReadAhead;
+#ifdef _WIN32
+	if (dummyHWND)
+		DestroyWindow(dummyHWND);
+#endif
+
+#if defined(_DEBUG) && defined(_WIN32)
+	// Debug builds report memory usage of all engines for tuning; visible with a debugger or DebugView.
+	MemoryPoolStats Stats = {};
+	for (auto const item : m_engines) {
+		Stats.Add(item->GetPoolStats());
+	}
+	char Text[256];
+	sprintf_s(Text, "ExecuteShader: %d engines, pool hits %llu, misses %llu, %llu MB resident, %llu MB sum of per-engine peaks\n", (int)m_engines.size(),
+		(unsigned long long)Stats.Hits, (unsigned long long)Stats.Misses, (unsigned long long)(Stats.BytesResident >> 20), (unsigned long long)(Stats.PeakSum >> 20));
+	OutputDebugStringA(Text);
+#endif
+
+	if (m_Scheduler)
+		delete m_Scheduler;
 	for (auto const item : m_engines) {
 		delete item;
 	}
+	for (auto const& item : m_PackedFrames) {
+		if (item.Planes[0])
+			_aligned_free(item.Planes[0]);
+	}
+	for (auto const& item : m_OutputFrames) {
+		_aligned_free(item.Planes[0]);
+	}
+	if (m_Unpacker)
+		delete m_Unpacker;
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (m_Packers[i])
+			delete m_Packers[i];
+	}
 }
 
 PVideoFrame __stdcall ExecuteShader::GetFrame(int n, IScriptEnvironment* env) {
-	// Iterate between both devices. First frame uses render1, second frame uses render2 and so on.
-	// We don't need to lock until within ProcessCommandChain but we need to know which device is being used within GetFrame.
-	D3D9RenderImpl* render;
-	if (m_enginesCount > 1) {
-		mutex_IterateDevice.lock();
-		render = m_engines[m_IterateDevice++];
-		if (m_IterateDevice >= m_enginesCount)
-			m_IterateDevice = 0;
-		mutex_IterateDevice.unlock();
+	PVideoFrame Result;
+	if (m_ReadAhead && TakeReadAhead(n, &Result, env))
+		return Result;
+
+	PVideoFrame Frames[RenderEngine::maxClips];
+	FetchFrames(n, Frames, env);
+	PVideoFrame dst = env->NewVideoFrame(vi);
+	const char* Error = RenderFrame(n, Frames, GetFrameOutput(dst));
+	if (Error)
+		env->ThrowError("%s", Error);
+	return dst;
+}
+
+// While the host requests frames in order, the following frames are processed in the background. Their source
+// frames are fetched here, as only the thread calling GetFrame may use the script environment. The lock isn't held
+// while fetching, as upstream filters may wait for other threads requesting frames of this filter.
+// Returns whether frame n was read ahead, waiting for it if it is still being processed.
+bool ExecuteShader::TakeReadAhead(int n, PVideoFrame* result, IScriptEnvironment* env) {
+	std::future<ReadAheadFrame> Result;
+	bool Found;
+	std::vector<int> Fetch;
+	{
+		std::unique_lock<std::mutex> lock(mutex_ReadAhead);
+		Found = m_ReadAhead->Take(n, &Result);
+		// Requesting the same frame again doesn't break the sequence.
+		bool Sequential = n == m_LastFrame + 1 || n == m_LastFrame;
+		m_LastFrame = n;
+		m_ReadAhead->Trim(n, Sequential);
+		if (Sequential) {
+			int Last = std::min(n + m_ReadAhead->GetDepth(), vi.num_frames - 1);
+			for (int i = n + 1; i <= Last; i++) {
+				if (m_ReadAhead->Contains(i) || m_ReadAheadFetching.count(i))
+					continue;
+				m_ReadAheadFetching.insert(i);
+				Fetch.push_back(i);
+			}
+		}
+	}
+
+	for (size_t k = 0; k < Fetch.size(); k++) {
+		int i = Fetch[k];
+		PVideoFrame Frames[RenderEngine::maxClips];
+		try {
+			FetchFrames(i, Frames, env);
+		}
+		catch (...) {
+			std::unique_lock<std::mutex> lock(mutex_ReadAhead);
+			for (; k < Fetch.size(); k++) {
+				m_ReadAheadFetching.erase(Fetch[k]);
+			}
+			throw;
+		}
+		PVideoFrame dst = env->NewVideoFrame(vi);
+		FrameOutput Output = GetFrameOutput(dst);
+		std::unique_lock<std::mutex> lock(mutex_ReadAhead);
+		m_ReadAheadFetching.erase(i);
+		m_ReadAhead->Submit(i, [this, i, Frames, dst, Output] {
+			return ReadAheadFrame{ dst, RenderFrame(i, Frames, Output) };
+		});
 	}
-	else
-		render = m_engines.front();
 
-	std::vector<InputTexture*> TextureList;
-	AllocateAndCopyInputTextures(render, &TextureList, n, false, env);
+	if (Found) {
+		// Errors of the background threads are thrown here, as only this thread may use the script environment.
+		ReadAheadFrame Frame = Result.get();
+		if (Frame.Error)
+			env->ThrowError("%s", Frame.Error);
+		*result = Frame.Frame;
+	}
+	return Found;
+}
 
-	ProcessCommandChain(render, &TextureList, n, false, env);
+// A source frame fetched by FetchFrames.
+struct FetchJob {
+	PClip Clip;
+	int Frame;
+	PVideoFrame Result;
+	std::string Error;
+};
+
+static void FetchClip(FetchJob* job, IScriptEnvironment* env) {
+	try {
+		job->Result = job->Clip->GetFrame(job->Frame, env);
+	}
+	catch (const AvisynthError& e) {
+		job->Error = e.msg;
+	}
+	catch (...) {
+		job->Error = "ExecuteShader: Failed to get a frame of the source clips";
+	}
+}
 
-	// After last command, copy result back to AviSynth.
-	PVideoFrame dst = env->NewVideoFrame(vi);
-	if (m_PlanarOut) {
-		if FAILED(CopyBufferToAviSynthPlanar(srcHeight - 1, TextureList.back(), dst->GetWritePtr(PLANAR_Y), dst->GetWritePtr(PLANAR_U), dst->GetWritePtr(PLANAR_V), dst->GetPitch(PLANAR_Y), m_OutputPrecision, env))
-			env->ThrowError("ExecuteShader: CopyBufferToAviSynthPlanar failed");
+static AVSValue FetchClipJob(IScriptEnvironment2* env, void* data) {
+	FetchClip((FetchJob*)data, env);
+	return AVSValue();
+}
+
+// Fetches the source frames read by the command chain. This happens before taking an engine so that upstream
+// filters don't run while holding it.
+//
+// With AviSynth+, clips after the first one are fetched on its threads while this thread fetches the first one, so
+// that their upstream filters, like ConvertToShader, run at the same time. This only happens on the main thread: the
+// threads of AviSynth+, like the ones of Prefetch, fetch in turn, as they may all be waiting in GetFrame with no
+// thread left to run the jobs.
+void ExecuteShader::FetchFrames(int n, PVideoFrame* frames, IScriptEnvironment* env) {
+	if (!m_ParallelFetch || env->GetEnvProperty(AEP_THREAD_ID) != 0) {
+		for (int i = 0; i < RenderEngine::maxClips; i++) {
+			if (m_ClipUsed[i])
+				frames[i] = m_clips[i]->GetFrame(n, env);
+		}
+		return;
+	}
+
+	PNeoEnv Neo(env);
+	IJobCompletion* Completion = Neo->NewCompletion(RenderEngine::maxClips);
+	FetchJob Jobs[RenderEngine::maxClips];
+	int First = -1;
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (!m_ClipUsed[i])
+			continue;
+		Jobs[i].Clip = m_clips[i];
+		Jobs[i].Frame = n;
+		if (First < 0)
+			First = i;
+		else
+			Neo->ParallelJob(FetchClipJob, &Jobs[i], Completion);
+	}
+	FetchClip(&Jobs[First], env);
+	Completion->Wait();
+	Completion->Destroy();
+
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (!Jobs[i].Error.empty())
+			env->ThrowError("%s", Jobs[i].Error.c_str());
+		frames[i] = Jobs[i].Result;
+	}
+}
+
+int ExecuteShader::GetEngineIndex(const RenderEngine* render) {
+	return (int)(std::find(m_engines.begin(), m_engines.end(), render) - m_engines.begin());
+}
+
+FrameOutput ExecuteShader::GetFrameOutput(PVideoFrame& dst) {
+	FrameOutput Result = { };
+	if (vi.IsPlanar()) {
+		Result.Planes[0] = dst->GetWritePtr(PLANAR_Y);
+		Result.Planes[1] = dst->GetWritePtr(PLANAR_U);
+		Result.Planes[2] = dst->GetWritePtr(PLANAR_V);
+		Result.Pitch = dst->GetPitch(PLANAR_Y);
 	}
 	else {
-		if FAILED(CopyBufferToAviSynth(srcHeight - 1, TextureList.back(), dst->GetWritePtr(), dst->GetPitch(), m_OutputPrecision, env))
-			env->ThrowError("ExecuteShader: CopyBufferToAviSynth failed");
+		Result.Planes[0] = dst->GetWritePtr();
+		Result.Pitch = dst->GetPitch();
 	}
+	return Result;
+}
 
-	// Release all 
-	if FAILED(ClearTextures(render->m_Pool, &TextureList))
-		env->ThrowError("ExecuteShader: ClearTextures failed");
+const char* ExecuteShader::RenderFrame(int n, const PVideoFrame* frames, const FrameOutput& output) {
+	// The frame runs on the first idle engine, which processes one frame at a time. Lower frames get engines first.
+	ScopedEngine Engine(m_Scheduler, n);
+	RenderEngine* render = Engine.Get();
+
+	// With TileHeight, the chain runs once per band of the output, computing only the rows each band needs.
+	for (int Tile = 0; Tile < m_TileCount; Tile++) {
+		std::vector<InputTexture*> TextureList;
+		const char* Error = AllocateAndCopyInputTextures(render, &TextureList, frames, Tile, false);
+		if (!Error)
+			Error = ProcessCommandChain(render, &TextureList, Tile);
+		if (Error)
+			return Error;
+
+		// After last command, copy result back to AviSynth. With OutputFormat, it goes to the engine's memory first
+		// and the rows are unpacked into the frame right away, while they are still in the cache.
+		InputTexture* Result = TextureList.back();
+		if (m_TileHeight > 0)
+			render->SetRowRange(Tile * m_TileHeight, (Tile + 1) * m_TileHeight);
+		FrameOutput Target = m_Unpacker ? FrameOutput{ { }, 0 } : output;
+		if (m_Unpacker) {
+			const PackedFrame& Staging = m_OutputFrames[GetEngineIndex(render)];
+			std::copy(Staging.Planes, Staging.Planes + 3, Target.Planes);
+			Target.Pitch = Staging.Pitch;
+		}
+		if (m_PlanarOut) {
+			if FAILED(render->CopyBufferToAviSynthPlanar(Result, Target.Planes[0], Target.Planes[1], Target.Planes[2], Target.Pitch, m_OutputPrecision))
+				return "ExecuteShader: CopyBufferToAviSynthPlanar failed";
+		}
+		else {
+			if FAILED(render->CopyBufferToAviSynth(Result, Target.Planes[0], Target.Pitch, m_OutputPrecision))
+				return "ExecuteShader: CopyBufferToAviSynth failed";
+		}
+		if (m_Unpacker) {
+			int Top = m_TileHeight > 0 ? Tile * m_TileHeight : 0;
+			int Bottom = m_TileHeight > 0 ? std::min(Top + m_TileHeight, Result->Height) : Result->Height;
+			m_Unpacker->unpack(Target.Planes, Target.Pitch, output.Planes, output.Pitch, Top, Bottom, m_Threads.get());
+		}
 
-	return dst;
+		// Unbind textures for the next tile or frame
+		if FAILED(render->ClearTextures(&TextureList))
+			return "ExecuteShader: ClearTextures failed";
+	}
+	render->SetRowRange(0, -1);
+	return nullptr;
 }
 
 int __stdcall ExecuteShader::SetCacheHints(int cachehints, int frame_range) {
 	return cachehints == CachePolicyHint::CACHE_GET_MTMODE ? (SUPPORT_MT_NICE_FILTER ? MT_NICE_FILTER : MT_MULTI_INSTANCE) : 0;
 }
 
-void ExecuteShader::ProcessCommandChain(D3D9RenderImpl* render, std::vector<InputTexture*>* textureList, int n, bool init, IScriptEnvironment* env) {
-	// Each row of input clip contains commands to execute
-	CommandStruct cmd;
-	bool IsLast;
-	bool Dither = m_Precision >= 2 && m_OutputPrecision < 2;
-
-	PVideoFrame src = child->GetFrame(n, env);
-	const byte* srcReader = src->GetReadPtr();
+// The command clip holds the same commands for every frame: one command per row, each pointing to data of its Shader filter.
+// The chain is read once and everything that doesn't change between frames is resolved here, so that each frame only
+// sets constants, renders and transfers.
+void ExecuteShader::CompileCommandChain(IScriptEnvironment* env) {
+	// Shapes of the textures defined at each point of the chain, starting with the input clips.
+	std::map<int, TextureShape> Shapes;
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (m_clips[i])
+			Shapes[i + 1] = m_ClipShapes[i];
+	}
 
-	std::unique_lock<std::mutex> lock(render->mutex_ProcessCommand);
+	PVideoFrame Commands = child->GetFrame(0, env);
+	const byte* srcReader = Commands->GetReadPtr();
+	m_Dither = m_Precision >= 2 && m_OutputPrecision < 2;
 
 	for (int i = 0; i < srcHeight; i++) {
-		memcpy(&cmd, srcReader, sizeof(CommandStruct));
-		srcReader += src->GetPitch();
-		IsLast = i == srcHeight - 1;
-
-		ProcessCommand(render, textureList, &cmd, init, IsLast && !Dither, env);
+		bool IsLast = i == srcHeight - 1;
+		m_Chain.push_back(CompiledCommand());
+		CompiledCommand* Item = &m_Chain.back();
+		memcpy(&Item->Cmd, srcReader, sizeof(CommandStruct));
+		srcReader += Commands->GetPitch();
+		CompileCommand(Item, IsLast && !m_Dither, &Shapes, env);
+
+		// Add a command to the chain for Dithering, reading the Bayer matrix from texture 2
+		if (IsLast && m_Dither) {
+			int DitherIndex = Item->Cmd.CommandIndex + 1;
+			m_Chain.push_back(CompiledCommand());
+			Item = &m_Chain.back();
+			Item->Type = DitherMatrixCommand;
+			Item->Cmd.OutputIndex = 2;
+			Shapes[2] = TextureShape{ DITHER_MATRIX_SIZE, DITHER_MATRIX_SIZE, false };
+
+			m_Chain.push_back(CompiledCommand());
+			Item = &m_Chain.back();
+			CreateDitherCommand(&Item->Cmd, DitherIndex, m_OutputPrecision, Item->Constants[2]);
+			Item->DefaultParam[2] = true;
+			CompileCommand(Item, true, &Shapes, env);
+		}
+	}
 
-		// Add a command to the chain for Dithering
-		if (IsLast && Dither) {
-			CreateDitherCommand(render, textureList, &cmd, cmd.CommandIndex + 1, m_OutputPrecision);
-			ProcessCommand(render, textureList, &cmd, init, true, env);
-			render->ResetSamplerState();
+	ForwardCopies();
+	RemoveDeadCommands();
+	ComputeLifetimes();
+	if (m_TileHeight > 0)
+		ComputeTiles();
+
+	// Commands moved while optimizing; point default parameters to their final location.
+	for (auto& item : m_Chain) {
+		for (int i = 0; i < 3; i++) {
+			if (item.DefaultParam[i])
+				item.Cmd.Param[i].Values = item.Constants[i];
 		}
 	}
 }
 
-void ExecuteShader::ProcessCommand(D3D9RenderImpl* render, std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool init, bool isLast, IScriptEnvironment* env) {
-	bool IsPlanar;
-	InputTexture* texture;
-	int OutputWidth, OutputHeight;
+void ExecuteShader::CompileCommand(CompiledCommand* item, bool isLast, std::map<int, TextureShape>* shapes, IScriptEnvironment* env) {
+	CommandStruct* cmd = &item->Cmd;
+	item->IsLast = isLast;
 
 	if (cmd->Path && cmd->Path[0] != '\0') {
-		if (init)
-			ConfigureShader(cmd, env);
+		item->Type = RenderCommand;
+		ConfigureShader(cmd, env);
+
+		for (int j = 0; j < 9; j++) {
+			if (cmd->ClipIndex[j] > 0 && shapes->find(cmd->ClipIndex[j]) == shapes->end())
+				env->ThrowError("Shader: Invalid clip index.");
+		}
 
 		// If clip at output position isn't defined, use dimensions of first clip by default.
-		texture = FindTexture(textureList, cmd->OutputIndex);
-		if (!texture || !texture->Texture)
-			texture = FindTexture(textureList, cmd->ClipIndex[0]);
-		OutputWidth = cmd->OutputWidth > 0 ? cmd->OutputWidth : texture->Width;
-		OutputHeight = cmd->OutputHeight > 0 ? cmd->OutputHeight : texture->Height;
-		IsPlanar = texture->TextureY && (!cmd->Path || cmd->Path[0] == '\0');
-
-		if (init && isLast) {
+		auto Shape = shapes->find(cmd->OutputIndex);
+		if (Shape == shapes->end() || Shape->second.Planar)
+			Shape = shapes->find(cmd->ClipIndex[0]);
+		if (Shape == shapes->end())
+			env->ThrowError("Shader: Invalid clip index.");
+		item->OutputWidth = cmd->OutputWidth > 0 ? cmd->OutputWidth : Shape->second.Width;
+		item->OutputHeight = cmd->OutputHeight > 0 ? cmd->OutputHeight : Shape->second.Height;
+
+		if (isLast) {
 			if (cmd->OutputIndex != 1)
 				env->ThrowError("ExecuteShader: Last command must have Output = 1");
 
-			vi.width = OutputWidth * m_OutputMultiplier;
-			vi.height = OutputHeight;
+			vi.width = item->OutputWidth * m_OutputMultiplier;
+			vi.height = item->OutputHeight;
 		}
 
-		// Set Param0 and Param1 default values.
-		bool SetDefault1 = SetDefaultParamValue(&cmd->Param[0], (float)OutputWidth, (float)OutputHeight, 0, 0);
-		bool SetDefault2 = SetDefaultParamValue(&cmd->Param[1], 1.0f / OutputWidth, 1.0f / OutputHeight, 0, 0);
-
-		// Configure pixel shader
-		for (int j = 0; j < 9; j++) {
-			if (cmd->Param[j].Type != ParamType::None) {
-				if (FAILED(render->SetPixelShaderConstant(j, &cmd->Param[j])))
-					env->ThrowError("ExecuteShader failed to set parameters.");
-			}
-		}
+		item->HasFootprint = GetCpuShaderFootprint(cmd->Path, &item->Footprint);
 
-		if FAILED(render->ProcessFrame(textureList, cmd, OutputWidth, OutputHeight, isLast, 0, env))
-			env->ThrowError("ExecuteShader: ProcessFrame failed.");
+		// Set Param0 and Param1 default values.
+		item->DefaultParam[0] = SetDefaultParamValue(&cmd->Param[0], item->Constants[0], (float)item->OutputWidth, (float)item->OutputHeight, 0, 0);
+		item->DefaultParam[1] = SetDefaultParamValue(&cmd->Param[1], item->Constants[1], 1.0f / item->OutputWidth, 1.0f / item->OutputHeight, 0, 0);
 
-		// Delete memory allocated for default values
-		if (SetDefault1)
-			delete cmd->Param[0].Values;
-		if (SetDefault2)
-			delete cmd->Param[1].Values;
+		(*shapes)[cmd->OutputIndex] = TextureShape{ item->OutputWidth, item->OutputHeight, false };
 	}
 	else {
 		if (isLast)
@@ -189,19 +525,260 @@ void ExecuteShader::ProcessCommand(D3D9RenderImpl* render, std::vector<InputText
 			env->ThrowError("ExecuteShader: If Path is not specified, OutputWidth and OutputHeight cannot be set");
 
 		// Only copy Clip1 to Output without processing
-		texture = FindTexture(textureList, cmd->ClipIndex[0]);
-		if FAILED(render->CopyBuffer(textureList, texture, cmd))
-			env->ThrowError("ExecuteShader: CopyBuffer failed.");
+		auto Shape = shapes->find(cmd->ClipIndex[0]);
+		if (Shape == shapes->end())
+			env->ThrowError("Shader: Invalid clip index.");
+		item->Type = CopyCommand;
+		item->OutputWidth = Shape->second.Width;
+		item->OutputHeight = Shape->second.Height;
+		item->PlanarOutput = Shape->second.Planar;
+		(*shapes)[cmd->OutputIndex] = Shape->second;
+	}
+}
+
+// Returns the indexes of the textures read by a command.
+static int GetCommandInputs(const CompiledCommand* item, int* inputs) {
+	int Count = 0;
+	if (item->Type == RenderCommand) {
+		for (int j = 0; j < 9; j++) {
+			if (item->Cmd.ClipIndex[j] > 0)
+				inputs[Count++] = item->Cmd.ClipIndex[j];
+		}
+	}
+	else if (item->Type == CopyCommand)
+		inputs[Count++] = item->Cmd.ClipIndex[0];
+	return Count;
+}
+
+static bool ReadsTexture(const CompiledCommand* item, int index) {
+	int Inputs[9];
+	int Count = GetCommandInputs(item, Inputs);
+	return std::find(Inputs, Inputs + Count, index) != Inputs + Count;
+}
+
+// Returns the precision of the texture written by a command, or -1 when it depends on the engine.
+int ExecuteShader::GetOutputPrecision(const CompiledCommand* item) {
+	if (item->Type == DitherMatrixCommand || item->IsLast || item->PlanarOutput)
+		return -1;
+	return item->Cmd.Precision > -1 ? item->Cmd.Precision : m_Precision;
+}
+
+// A copy whose source keeps its content until the copy is last read is an alias: readers use the source instead.
+// Only copies that don't convert the texture format are removed. Input clips are left alone as their format depends on the engine.
+void ExecuteShader::ForwardCopies() {
+	for (size_t p = 0; p < m_Chain.size(); p++) {
+		const CompiledCommand* Copy = &m_Chain[p];
+		if (Copy->Type != CopyCommand)
+			continue;
+		int Src = Copy->Cmd.ClipIndex[0];
+		int Dst = Copy->Cmd.OutputIndex;
+
+		const CompiledCommand* Source = nullptr;
+		for (size_t q = p; q-- > 0;) {
+			if (m_Chain[q].Cmd.OutputIndex == Src) {
+				Source = &m_Chain[q];
+				break;
+			}
+		}
+		int Precision = GetOutputPrecision(Copy);
+		if (!Source || Precision < 0 || GetOutputPrecision(Source) != Precision)
+			continue;
+
+		// Every read of the copy must happen before Src is written again.
+		size_t SrcWrite = m_Chain.size(), DstWrite = m_Chain.size();
+		for (size_t q = p + 1; q < m_Chain.size(); q++) {
+			if (m_Chain[q].Cmd.OutputIndex == Src && SrcWrite == m_Chain.size())
+				SrcWrite = q;
+			if (m_Chain[q].Cmd.OutputIndex == Dst) {
+				DstWrite = q;
+				break;
+			}
+		}
+		bool IsAlias = true;
+		for (size_t q = SrcWrite + 1; q <= DstWrite && q < m_Chain.size(); q++) {
+			if (ReadsTexture(&m_Chain[q], Dst))
+				IsAlias = false;
+		}
+		if (!IsAlias)
+			continue;
+
+		for (size_t q = p + 1; q <= DstWrite && q < m_Chain.size(); q++) {
+			CommandStruct* cmd = &m_Chain[q].Cmd;
+			int Count = m_Chain[q].Type == RenderCommand ? 9 : m_Chain[q].Type == CopyCommand ? 1 : 0;
+			for (int j = 0; j < Count; j++) {
+				if (cmd->ClipIndex[j] == Dst)
+					cmd->ClipIndex[j] = Src;
+			}
+		}
+		m_Chain.erase(m_Chain.begin() + p);
+		p--;
+	}
+}
+
+// Removes commands whose output is written again or never read, and marks input clips that are never read.
+void ExecuteShader::RemoveDeadCommands() {
+	// The output of the last command is read back to AviSynth.
+	std::vector<bool> Live(256, false);
+	Live[1] = true;
+	for (size_t p = m_Chain.size(); p-- > 0;) {
+		const CompiledCommand* Item = &m_Chain[p];
+		if (!Live[Item->Cmd.OutputIndex]) {
+			m_Chain.erase(m_Chain.begin() + p);
+			continue;
+		}
+		Live[Item->Cmd.OutputIndex] = false;
+		int Inputs[9];
+		int Count = GetCommandInputs(Item, Inputs);
+		for (int j = 0; j < Count; j++) {
+			Live[Inputs[j]] = true;
+		}
+	}
+
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		m_ClipUsed[i] = m_clips[i] && Live[i + 1];
+	}
+}
+
+// Finds after which command each texture is read for the last time before being written again or reaching the end.
+void ExecuteShader::ComputeLifetimes() {
+	for (size_t p = 0; p < m_Chain.size(); p++) {
+		CompiledCommand* Item = &m_Chain[p];
+		int Inputs[9];
+		int Count = GetCommandInputs(Item, Inputs);
+		for (int j = 0; j < Count; j++) {
+			int Index = Inputs[j];
+			// The command replaces its own output texture, and the last output is read back.
+			if (Index == Item->Cmd.OutputIndex || std::find(Item->ReleaseAfter.begin(), Item->ReleaseAfter.end(), Index) != Item->ReleaseAfter.end())
+				continue;
+			bool LastRead = Index != 1;
+			for (size_t q = p + 1; q < m_Chain.size(); q++) {
+				if (ReadsTexture(&m_Chain[q], Index)) {
+					LastRead = false;
+					break;
+				}
+				if (m_Chain[q].Cmd.OutputIndex == Index) {
+					LastRead = true;
+					break;
+				}
+			}
+			if (LastRead)
+				Item->ReleaseAfter.push_back(Index);
+		}
+	}
+}
+
+// Splits the output into bands of TileHeight rows and finds, for each band, which rows every command must compute.
+// Going back from the last command, the rows needed from each input are the output rows mapped to the input size,
+// widened by the footprint of the shader (the halo). Shaders with an unknown footprint read whole inputs.
+// Each tile then recomputes its halo instead of sharing it with its neighbours.
+void ExecuteShader::ComputeTiles() {
+	// Height of each texture read by each command.
+	std::vector<int> Heights(256, 0);
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		if (m_clips[i])
+			Heights[i + 1] = m_ClipShapes[i].Height;
+	}
+	std::vector<std::vector<int>> InputHeights;
+	for (auto const& item : m_Chain) {
+		InputHeights.push_back(Heights);
+		Heights[item.Cmd.OutputIndex] = item.Type == DitherMatrixCommand ? DITHER_MATRIX_SIZE : item.OutputHeight;
+	}
+
+	m_TileCount = (vi.height + m_TileHeight - 1) / m_TileHeight;
+	for (int Tile = 0; Tile < m_TileCount; Tile++) {
+		// Rows needed from each texture by the commands processed so far, or Top >= Bottom when none.
+		std::vector<RowRange> Needed(256, RowRange{ 0, 0 });
+		auto Need = [&](int index, int top, int bottom) {
+			RowRange& Rows = Needed[index];
+			top = std::max(top, 0);
+			bottom = std::min(bottom, Heights[index]);
+			if (Rows.Top >= Rows.Bottom)
+				Rows = RowRange{ top, bottom };
+			else
+				Rows = RowRange{ std::min(Rows.Top, top), std::max(Rows.Bottom, bottom) };
+		};
+		Needed[1] = RowRange{ Tile * m_TileHeight, std::min((Tile + 1) * m_TileHeight, vi.height) };
+
+		for (size_t p = m_Chain.size(); p-- > 0;) {
+			CompiledCommand* Item = &m_Chain[p];
+			Heights = InputHeights[p];
+			RowRange Rows = Needed[Item->Cmd.OutputIndex];
+			Needed[Item->Cmd.OutputIndex] = RowRange{ 0, 0 };
+			if (Item->Type == DitherMatrixCommand)
+				Rows = RowRange{ 0, DITHER_MATRIX_SIZE };
+			Item->TileRows.push_back(Rows);
+			if (Rows.Top >= Rows.Bottom)
+				continue;
+
+			int Inputs[9];
+			int Count = GetCommandInputs(Item, Inputs);
+			for (int j = 0; j < Count; j++) {
+				int InputHeight = Heights[Inputs[j]];
+				if (Item->Type == CopyCommand)
+					Need(Inputs[j], Rows.Top, Rows.Bottom);
+				else if (!Item->HasFootprint)
+					Need(Inputs[j], 0, InputHeight);
+				else {
+					int Top, Bottom;
+					GetCpuShaderInputRows(Item->Footprint, Item->OutputHeight, InputHeight, Rows.Top, Rows.Bottom, &Top, &Bottom);
+					Need(Inputs[j], Top, Bottom);
+				}
+			}
+		}
+
+		for (int i = 0; i < RenderEngine::maxClips; i++) {
+			m_ClipTileRows[i].push_back(Needed[i + 1]);
+		}
+	}
+}
+
+// Runs the chain on the whole frame, or on the rows needed by one tile when TileHeight is set.
+const char* ExecuteShader::ProcessCommandChain(RenderEngine* render, std::vector<InputTexture*>* textureList, int tile) {
+	for (auto& item : m_Chain) {
+		CommandStruct* cmd = &item.Cmd;
+		if (m_TileHeight > 0)
+			render->SetRowRange(item.TileRows[tile].Top, item.TileRows[tile].Bottom);
+		if (item.Type == RenderCommand) {
+			// Configure pixel shader
+			for (int j = 0; j < 9; j++) {
+				if (cmd->Param[j].Type != ParamType::None) {
+					if (FAILED(render->SetPixelShaderConstant(j, &cmd->Param[j])))
+						return "ExecuteShader failed to set parameters.";
+				}
+			}
+
+			if FAILED(render->ProcessFrame(textureList, cmd, item.OutputWidth, item.OutputHeight, item.IsLast, 0))
+				return "ExecuteShader: ProcessFrame failed.";
+		}
+		else if (item.Type == CopyCommand) {
+			if FAILED(render->CopyBuffer(textureList, FindTexture(textureList, cmd->ClipIndex[0]), cmd))
+				return "ExecuteShader: CopyBuffer failed.";
+		}
+		else {
+			if FAILED(render->CopyDitherMatrix(textureList, cmd->OutputIndex))
+				return "ExecuteShader: CopyDitherMatrix failed.";
+		}
+
+		for (auto const index : item.ReleaseAfter) {
+			InputTexture* Texture = FindTexture(textureList, index);
+			if (Texture && FAILED(render->DiscardTexture(textureList, Texture)))
+				return "ExecuteShader: DiscardTexture failed.";
+		}
 	}
+
+	// The dither matrix is sampled with wrap addressing.
+	if (m_Dither)
+		render->ResetSamplerState();
+	return nullptr;
 }
 
-// Sets the default parameter value if it is not already defined.
+// Sets the default parameter value if it is not already defined, storing it in values.
 // Returns whether a value was assigned.
-bool ExecuteShader::SetDefaultParamValue(ParamStruct* p, float value0, float value1, float value2, float value3) {
+bool ExecuteShader::SetDefaultParamValue(ParamStruct* p, float* values, float value0, float value1, float value2, float value3) {
 	if (p->Type == ParamType::None) {
 		p->Type = ParamType::Float;
 		p->Count = 1;
-		p->Values = new float[4];
+		p->Values = values;
 		p->Values[0] = value0;
 		p->Values[1] = value1;
 		p->Values[2] = value2;
@@ -211,52 +788,70 @@ bool ExecuteShader::SetDefaultParamValue(ParamStruct* p, float value0, float val
 	return false;
 }
 
-void ExecuteShader::AllocateAndCopyInputTextures(D3D9RenderImpl* render, std::vector<InputTexture*>* list, int n, bool init, IScriptEnvironment* env) {
-	// Allocated textures must be released manually after use
+const char* ExecuteShader::AllocateAndCopyInputTextures(RenderEngine* render, std::vector<InputTexture*>* list, const PVideoFrame* frames, int tile, bool init) {
+	// Textures come from the engine's frame plan and must be returned with ClearTextures after use
 	InputTexture* NewTexture;
-	for (int i = 0; i < D3D9RenderImpl::maxClips; i++) {
-		PClip clip = m_clips[i];
-		if (clip) {
-			// Allocate textures
-			bool IsPlanar = clip->GetVideoInfo().IsYV24();
-			if (!clip->GetVideoInfo().IsRGB32() && !IsPlanar && !clip->GetVideoInfo().IsY8())
-				env->ThrowError("ExecuteShader: You must first call ConvertToShader on source");
-			else if (m_ClipPrecision[i] == 0 && !clip->GetVideoInfo().IsY8())
-				env->ThrowError("ExecuteShader: Clip with Precision=0 must be in Y8 format");
-
-			NewTexture = new InputTexture();
-			if (FAILED(render->CreateTexture(i + 1, clip->GetVideoInfo().width / m_ClipMultiplier[i], clip->GetVideoInfo().height, true, IsPlanar, false, -1, NewTexture)))
-				env->ThrowError("ExecuteShader: Failed to create input textures.");
-
-			list->push_back(NewTexture);
+	for (int i = 0; i < RenderEngine::maxClips; i++) {
+		// Clips that no command reads aren't uploaded
+		if (!m_clips[i] || !m_ClipUsed[i])
+			continue;
+
+		// Allocate textures
+		const TextureShape& Shape = m_ClipShapes[i];
+		if (FAILED(render->AcquireTexture(i + 1, Shape.Width, Shape.Height, true, Shape.Planar, false, -1, &NewTexture)))
+			return "ExecuteShader: Failed to create input textures.";
+
+		list->push_back(NewTexture);
+
+		if (!init) {
+			// Copy frame data from AviSynth; a tile only needs the rows its commands read.
+			RowRange Rows = { 0, Shape.Height };
+			if (m_TileHeight > 0) {
+				Rows = m_ClipTileRows[i][tile];
+				render->SetRowRange(Rows.Top, Rows.Bottom);
+			}
+			const PVideoFrame& frame = frames[i];
+			const byte* Planes[3];
+			int Pitch;
+			if (m_Packers[i]) {
+				// Pack those rows from the source format into the engine's memory, which is then uploaded like
+				// a frame of ConvertToShader.
+				const PackedFrame& Packed = m_PackedFrames[GetEngineIndex(render) * RenderEngine::maxClips + i];
+				m_Packers[i]->pack(frame, Packed.Planes, Packed.Pitch, Rows.Top, Rows.Bottom, m_Threads.get());
+				std::copy(Packed.Planes, Packed.Planes + 3, Planes);
+				Pitch = Packed.Pitch;
+			}
+			else {
+				Planes[0] = frame->GetReadPtr();
+				Planes[1] = Shape.Planar ? frame->GetReadPtr(PLANAR_U) : nullptr;
+				Planes[2] = Shape.Planar ? frame->GetReadPtr(PLANAR_V) : nullptr;
+				Pitch = frame->GetPitch();
+			}
 
-			if (!init) {
-				// Copy frame data from AviSynth
-				PVideoFrame frame = clip->GetFrame(n, env);
-				if (clip->GetVideoInfo().IsYV24()) {
-					// Copy planar data from YV24.
-					if (FAILED(CopyAviSynthToPlanarBuffer(frame->GetReadPtr(PLANAR_Y), frame->GetReadPtr(PLANAR_U), frame->GetReadPtr(PLANAR_V), frame->GetPitch(PLANAR_Y), m_ClipPrecision[i], clip->GetVideoInfo().width, clip->GetVideoInfo().height, NewTexture, env)))
-						env->ThrowError("ExecuteShader: CopyInputClip failed");
-				}
-				else {
-					// Copy regular data after calling ConvertToShader.
-					if (FAILED(CopyAviSynthToBuffer(frame->GetReadPtr(), frame->GetPitch(), m_ClipPrecision[i], clip->GetVideoInfo().width / m_ClipMultiplier[i], clip->GetVideoInfo().height, NewTexture, env)))
-						env->ThrowError("ExecuteShader: CopyInputClip failed");
-				}
+			if (Shape.Planar) {
+				// Copy planar data from YV24.
+				if (FAILED(render->CopyAviSynthToPlanarBuffer(Planes[0], Planes[1], Planes[2], Pitch, m_ClipPrecision[i], Shape.Width * m_ClipMultiplier[i], Shape.Height, NewTexture)))
+					return "ExecuteShader: CopyInputClip failed";
+			}
+			else {
+				// Copy regular data after calling ConvertToShader.
+				if (FAILED(render->CopyAviSynthToBuffer(Planes[0], Pitch, m_ClipPrecision[i], Shape.Width, Shape.Height, NewTexture)))
+					return "ExecuteShader: CopyInputClip failed";
 			}
 		}
 	}
+	return nullptr;
 }
 
 void ExecuteShader::ConfigureShader(CommandStruct* cmd, IScriptEnvironment* env) {
 	for (auto const item : m_engines) {
-		if FAILED(item->InitPixelShader(cmd, 0, env)) {
-			char* ErrorText = "Shader: Failed to open pixel shader ";
+		if FAILED(item->InitPixelShader(cmd, 0)) {
+			const char* ErrorText = m_Cpu ? "Shader: Failed to open or decode pixel shader on the CPU " : "Shader: Failed to open pixel shader ";
 			char* FullText;
 			size_t TextLength = strlen(ErrorText) + strlen(cmd->Path) + 1;
 			FullText = (char*)malloc(TextLength);
-			strcpy_s(FullText, TextLength, ErrorText);
-			strcat_s(FullText, TextLength, cmd->Path);
+			strcpy(FullText, ErrorText);
+			strcat(FullText, cmd->Path);
 			env->ThrowError(FullText);
 			free(FullText);
 		}
@@ -1,41 +1,146 @@
 #pragma once
+#ifdef _WIN32
 #include <windows.h>
 #include <d3d9.h>
 #include <d3dx9.h>
+#endif
 #include <cstdio>		//needed by OutputDebugString()
 #include "avisynth.h"
+#ifdef _WIN32
 #include "D3D9RenderImpl.h"
+#endif
+#include "CpuRenderImpl.h"
+#include "ThreadPool.h"
+#include "EngineScheduler.h"
+#include "FrameReadAhead.h"
 #include <mutex>
 #include <vector>
+#include <map>
+#include <set>
+#include <string>
+#ifdef _WIN32
 #include <DxErr.h>
+#endif
 #include "TextureList.h"
+#include "ConvertShader.h"
 
 const bool SUPPORT_MT_NICE_FILTER = true;
 
+enum CompiledCommandType {
+	RenderCommand,		// Runs a shader
+	CopyCommand,		// Copies Clip1 to Output
+	DitherMatrixCommand	// Copies the Bayer matrix to Output for the Dither command
+};
+
+// Rows [Top, Bottom) of a texture.
+struct RowRange {
+	int Top, Bottom;
+};
+
+// A command of the chain, validated and resolved once when ExecuteShader is created.
+struct CompiledCommand {
+	CompiledCommandType Type;
+	CommandStruct Cmd;
+	int OutputWidth, OutputHeight;
+	bool IsLast;
+	bool PlanarOutput;
+	// Values of Param0 and Param1 when not set by the script, and of the dither matrix size.
+	// Cmd.Param[i] points to Constants[i] when DefaultParam[i] is set.
+	float Constants[3][4];
+	bool DefaultParam[3];
+	// Textures no longer read after this command, released so that later commands can reuse their memory.
+	std::vector<int> ReleaseAfter;
+	// Rows of the inputs read around each output row, if known; see CpuShaderFootprint.
+	bool HasFootprint;
+	CpuShaderFootprint Footprint;
+	// Rows of the output computed for each tile when the frame is processed in tiles.
+	std::vector<RowRange> TileRows;
+};
+
+// Planes of an output frame, taken on the thread that created it while the frame is still writable.
+struct FrameOutput {
+	byte* Planes[3];	// Y, U and V planes with PlanarOut, otherwise only the first one
+	int Pitch;
+};
+
+// Memory of an engine holding a texture laid out like a frame of ConvertToShader: a clip packed with Convert, or the
+// result read back before it is unpacked into OutputFormat.
+struct PackedFrame {
+	byte* Planes[3];	// Y, U and V planes of planar textures, otherwise only the first one
+	int Pitch;
+};
+
 class ExecuteShader : public GenericVideoFilter {
 public:
-	ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _clip3, PClip _clip4, PClip _clip5, PClip _clip6, PClip _clip7, PClip _clip8, PClip _clip9, int _clipPrecision[9], int _precision, int _outputPrecision, bool _planarOut, int _engines, bool _resource, IScriptEnvironment* env);
+	ExecuteShader(PClip _child, PClip _clip1, PClip _clip2, PClip _clip3, PClip _clip4, PClip _clip5, PClip _clip6, PClip _clip7, PClip _clip8, PClip _clip9, int _clipPrecision[9], int _precision, int _outputPrecision, bool _planarOut, int _engines, bool _resource, bool _cpu, int _threads, int _tileHeight, int _lookahead, int _readAhead, const char* _shaderCache, bool _convert, bool _lsbIn, bool _planarIn, int _outputFormat, bool _lsbOut, IScriptEnvironment* env);
 	~ExecuteShader();
 	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
 	int __stdcall SetCacheHints(int cachehints, int frame_range);
 private:
-	void ProcessCommandChain(D3D9RenderImpl* render, std::vector<InputTexture*>* textureList, int n, bool init, IScriptEnvironment* env);
-	void ProcessCommand(D3D9RenderImpl* render, std::vector<InputTexture*>* textureList, CommandStruct* cmd, bool init, bool isLast, IScriptEnvironment* env);
-	void AllocateAndCopyInputTextures(D3D9RenderImpl* render, std::vector<InputTexture*>* list, int n, bool init, IScriptEnvironment* env);
+	struct TextureShape {
+		int Width, Height;
+		bool Planar;
+	};
+
+	void CompileCommandChain(IScriptEnvironment* env);
+	void CompileCommand(CompiledCommand* item, bool isLast, std::map<int, TextureShape>* shapes, IScriptEnvironment* env);
+	void ForwardCopies();
+	void RemoveDeadCommands();
+	void ComputeLifetimes();
+	void ComputeTiles();
+	int GetOutputPrecision(const CompiledCommand* item);
+	bool TakeReadAhead(int n, PVideoFrame* result, IScriptEnvironment* env);
+	void FetchFrames(int n, PVideoFrame* frames, IScriptEnvironment* env);
+	int GetEngineIndex(const RenderEngine* render);
+	FrameOutput GetFrameOutput(PVideoFrame& dst);
+	// These don't use the script environment, so that frames can be rendered in the background. They return the error
+	// message, or nullptr on success.
+	const char* RenderFrame(int n, const PVideoFrame* frames, const FrameOutput& output);
+	const char* ProcessCommandChain(RenderEngine* render, std::vector<InputTexture*>* textureList, int tile);
+	const char* AllocateAndCopyInputTextures(RenderEngine* render, std::vector<InputTexture*>* list, const PVideoFrame* frames, int tile, bool init);
 	void ConfigureShader(CommandStruct* cmd, IScriptEnvironment* env);
-	bool SetDefaultParamValue(ParamStruct* p, float value0, float value1, float value2, float value3);
+	bool SetDefaultParamValue(ParamStruct* p, float* values, float value0, float value1, float value2, float value3);
 	int m_Precision;
 	int m_PrecisionMultiplier;
 	int m_OutputPrecision;
 	int m_OutputMultiplier;
 	PClip m_clips[9];
+	bool m_ClipUsed[9];
+	// Whether several clips are read and AviSynth+ can fetch them on its threads.
+	bool m_ParallelFetch = false;
 	int m_ClipPrecision[9];
 	int m_ClipMultiplier[9];
+	// Shape of the texture of each input clip.
+	TextureShape m_ClipShapes[9];
+	// Packs clips given in their source format with Convert; nullptr for clips uploaded as they are.
+	ShaderPacker* m_Packers[9] = { 0 };
+	// Packed clips of each engine, at [engine * RenderEngine::maxClips + clip]; reused from frame to frame.
+	std::vector<PackedFrame> m_PackedFrames;
+	// Unpacks the result into OutputFormat, or nullptr to return the texture as it is.
+	ShaderUnpacker* m_Unpacker = nullptr;
+	// Result of each engine read back before it is unpacked.
+	std::vector<PackedFrame> m_OutputFrames;
 	bool m_PlanarOut;
-	HWND dummyHWND;
-	std::vector<D3D9RenderImpl*> m_engines;
+#ifdef _WIN32
+	HWND dummyHWND = nullptr;
+#endif
+	std::vector<CompiledCommand> m_Chain;
+	bool m_Dither;
+	std::vector<RenderEngine*> m_engines;
 	int m_enginesCount;
-	int m_IterateDevice = 0;
-	std::mutex mutex_IterateDevice;
+	EngineScheduler* m_Scheduler = nullptr;
+	// Frames processed in the background ahead of the host, or nullptr without ReadAhead.
+	FrameReadAhead* m_ReadAhead = nullptr;
+	int m_LastFrame = -1;
+	// Frames being read ahead whose source frames are still being fetched.
+	std::set<int> m_ReadAheadFetching;
+	std::mutex mutex_ReadAhead;
 	int srcHeight;
+	bool m_Cpu;
+	std::shared_ptr<ThreadPool> m_Threads;
+	// Output rows per tile, or 0 to process whole frames.
+	int m_TileHeight;
+	int m_TileCount = 1;
+	// Rows of each input clip read by each tile.
+	std::vector<RowRange> m_ClipTileRows[9];
 };
\ No newline at end of file
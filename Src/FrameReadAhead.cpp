@@ -0,0 +1,71 @@
+#include "FrameReadAhead.h"
+
+FrameReadAhead::FrameReadAhead(int depth, int threads) : m_Depth(depth) {
+	for (int i = 0; i < threads; i++) {
+		m_Workers.emplace_back(&FrameReadAhead::WorkerLoop, this);
+	}
+}
+
+FrameReadAhead::~FrameReadAhead() {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+		m_Stop = true;
+		m_Queue.clear();
+	}
+	m_Wake.notify_all();
+	for (auto& item : m_Workers) {
+		item.join();
+	}
+}
+
+bool FrameReadAhead::Take(int n, std::future<ReadAheadFrame>* result) {
+	std::unique_lock<std::mutex> my_lock(m_mutex);
+	auto Item = m_Frames.find(n);
+	if (Item == m_Frames.end())
+		return false;
+	*result = std::move(Item->second);
+	m_Frames.erase(Item);
+	return true;
+}
+
+bool FrameReadAhead::Contains(int n) {
+	std::unique_lock<std::mutex> my_lock(m_mutex);
+	return m_Frames.find(n) != m_Frames.end();
+}
+
+void FrameReadAhead::Submit(int n, std::function<ReadAheadFrame()> func) {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+		Task Item = { n, std::packaged_task<ReadAheadFrame()>(std::move(func)) };
+		m_Frames[n] = Item.Func.get_future();
+		m_Queue.push_back(std::move(Item));
+	}
+	m_Wake.notify_one();
+}
+
+void FrameReadAhead::Trim(int n, bool keep) {
+	std::unique_lock<std::mutex> my_lock(m_mutex);
+	auto Stale = [n, keep](int frame) { return !keep || frame < n; };
+	for (auto it = m_Frames.begin(); it != m_Frames.end();) {
+		it = Stale(it->first) ? m_Frames.erase(it) : std::next(it);
+	}
+	for (auto it = m_Queue.begin(); it != m_Queue.end();) {
+		it = Stale(it->Frame) ? m_Queue.erase(it) : std::next(it);
+	}
+}
+
+void FrameReadAhead::WorkerLoop() {
+	while (true) {
+		std::packaged_task<ReadAheadFrame()> Func;
+		{
+			std::unique_lock<std::mutex> my_lock(m_mutex);
+			m_Wake.wait(my_lock, [this] { return m_Stop || !m_Queue.empty(); });
+			if (m_Stop)
+				return;
+			Func = std::move(m_Queue.front().Func);
+			m_Queue.pop_front();
+		}
+		// Errors are stored in the future and rethrown to the thread requesting the frame.
+		Func();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "avisynth.h"
+
+/* Processes frames that are likely to be requested next on background threads, so that the engines work on the
+   following frames while the host consumes the current one. This gives hosts requesting one frame at a time, like
+   AviSynth 2.6, the same overlap that AviSynth+ MT gets from its threads.
+
+   The caller fetches the source frames and creates the output frame itself, as the script environment may only be
+   used from the thread calling GetFrame; only the work of the engines runs in the background. */
+
+// A frame processed in the background, with the message of the error that stopped it or nullptr.
+struct ReadAheadFrame {
+	PVideoFrame Frame;
+	const char* Error;
+};
+
+class FrameReadAhead {
+public:
+	// depth: Number of frames kept ahead of the last frame requested. threads: Number of background threads.
+	FrameReadAhead(int depth, int threads);
+	~FrameReadAhead();
+	int GetDepth() { return m_Depth; }
+
+	// Takes frame n out of the read-ahead frames and returns whether it was there. *result is then ready once
+	// the frame is processed, and holds the error message if processing it failed.
+	bool Take(int n, std::future<ReadAheadFrame>* result);
+	// Returns whether frame n is queued or processed.
+	bool Contains(int n);
+	// Queues func to compute frame n on a background thread.
+	void Submit(int n, std::function<ReadAheadFrame()> func);
+	// Drops the frames before n, or all frames if keep is false. Frames already running finish in the background.
+	void Trim(int n, bool keep);
+
+private:
+	struct Task {
+		int Frame;
+		std::packaged_task<ReadAheadFrame()> Func;
+	};
+
+	void WorkerLoop();
+
+	int m_Depth;
+	std::map<int, std::future<ReadAheadFrame>> m_Frames;
+	std::deque<Task> m_Queue;
+	std::vector<std::thread> m_Workers;
+	std::mutex m_mutex;
+	std::condition_variable m_Wake;
+	bool m_Stop = false;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Scalar conversions between half-float and float data. They give the same results as F16C with round-to-nearest-even,
+// and are used where the CPU engine reads, writes or emulates D3DFMT_A16B16G16R16F and D3DFMT_R16F textures.
+
+static inline float HalfToFloat(uint16_t h) {
+	const uint32_t ShiftedExp = 0x7C00 << 13;
+	uint32_t Bits = (uint32_t)(h & 0x7FFF) << 13; // Exponent and mantissa
+	uint32_t Exp = Bits & ShiftedExp;
+	Bits += (127 - 15) << 23; // Exponent adjust
+	float Result;
+	if (Exp == ShiftedExp) {
+		Bits += (128 - 16) << 23; // Inf/NaN
+		memcpy(&Result, &Bits, 4);
+	}
+	else if (Exp == 0) {
+		// Zero/denormal, let the FPU renormalize
+		Bits += 1 << 23;
+		memcpy(&Result, &Bits, 4);
+		Result -= 6.103515625e-05f; // 2^-14
+	}
+	else
+		memcpy(&Result, &Bits, 4);
+	memcpy(&Bits, &Result, 4);
+	Bits |= (uint32_t)(h & 0x8000) << 16;
+	memcpy(&Result, &Bits, 4);
+	return Result;
+}
+
+static inline uint16_t FloatToHalf(float f) {
+	uint32_t Bits;
+	memcpy(&Bits, &f, 4);
+	uint32_t Sign = Bits & 0x80000000u;
+	Bits ^= Sign;
+	uint16_t Result;
+	if (Bits >= (127 + 16) << 23) {
+		// Overflow to Inf, and keep NaN as quiet NaN
+		Result = Bits > 0x7F800000u ? 0x7E00 : 0x7C00;
+	}
+	else if (Bits < (113 << 23)) {
+		// Denormal result; the float addition does the rounding
+		const uint32_t DenormMagicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+		float DenormMagic, Value;
+		memcpy(&DenormMagic, &DenormMagicBits, 4);
+		memcpy(&Value, &Bits, 4);
+		Value += DenormMagic;
+		memcpy(&Bits, &Value, 4);
+		Result = (uint16_t)(Bits - DenormMagicBits);
+	}
+	else {
+		// Normal result, rounding to nearest even
+		uint32_t MantOdd = (Bits >> 13) & 1;
+		Bits += ((uint32_t)(15 - 127) << 23) + 0xFFF;
+		Bits += MantOdd;
+		Result = (uint16_t)(Bits >> 13);
+	}
+	return Result | (uint16_t)(Sign >> 16);
+}
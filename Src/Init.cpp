@@ -4,10 +4,31 @@
 #include "ExecuteShader.h"
 #include "PixelFormatParser.h"
 #include "ConvertStacked.hpp"
+#include "SSimDownscale.h"
+#include "SuperXbrCpu.h"
+#include "SuperResCpu.h"
 
 const int DefaultConvertYuv = false;
 static PixelFormatParser pixelFormatParser;
 
+// The conversion kernels don't resample chroma, so Y8, YV12 and YV16 sources are converted to YV24 first.
+static PClip ResampleChromaTo444(PClip input, bool stack16, const char* name, IScriptEnvironment* env) {
+	const VideoInfo& vi = input->GetVideoInfo();
+	if (!vi.IsY8() && !vi.IsYV12() && !vi.IsYV16())
+		return input;
+	if (stack16) {
+		if (!env->FunctionExists("Dither_resize16nr"))
+			env->ThrowError("%s: Dither_resize16nr is missing.", name);
+		AVSValue sargs[5] = { input, vi.width, vi.height / 2, "Spline36", "YV24" };
+		const char *nargs[5] = { 0, 0, 0, "kernel", "csp" };
+		return env->Invoke("Dither_resize16nr", AVSValue(sargs, 5), nargs).AsClip();
+	} else {
+		AVSValue sargs[2] = { input, "Spline36" };
+		const char *nargs[2] = { 0, "chromaresample" };
+		return env->Invoke("ConvertToYV24", AVSValue(sargs, 2), nargs).AsClip();
+	}
+}
+
 AVSValue __cdecl Create_ConvertToShader(AVSValue args, void* user_data, IScriptEnvironment* env) {
 	PClip input = args[0].AsClip();
 	bool planar = args[3].AsBool(false);
@@ -47,27 +68,15 @@ AVSValue __cdecl Create_ConvertToShader(AVSValue args, void* user_data, IScriptE
 				input = env->Invoke("ConvertToYV24", AVSValue(sargs, 2), nargs).AsClip();
 			}
 		} else {
-			if (vi.IsY8() || vi.IsYV12() || vi.IsYV16()) {
-				if (stack16) {
-					if (!env->FunctionExists("Dither_resize16nr"))
-						env->ThrowError("ConvertToShader: Dither_resize16nr is missing.");
-					AVSValue sargs[5] = { input, vi.width, vi.height / 2, "Spline36", "YV24" };
-					const char *nargs[5] = { 0, 0, 0, "kernel", "csp" };
-					input = env->Invoke("Dither_resize16nr", AVSValue(sargs, 5), nargs).AsClip();
-				} else {
-					AVSValue sargs[2] = { input, "Spline36" };
-					const char *nargs[2] = { 0, "chromaresample" };
-					input = env->Invoke("ConvertToYV24", AVSValue(sargs, 2), nargs).AsClip();
-				}
-			}
-
+			input = ResampleChromaTo444(input, stack16, "ConvertToShader", env);
 			input = new ConvertShader(
 				input,					// source clip
 				precision,				// precision, 1 for RGB32, 2 for UINT16 and 3 for half-float data.
 				stack16,				// lsb / Stack16
 				std::string(""),
 				planar,					// Planar
-				Opt,					// 0 for C++ only, 1 for use SSE2, 2 for use SSSE3 and others for use F16C. -1 to use Avisynth+ functions.
+				Opt,					// 0 for C++ only, 1 for SSE2, 2 for SSSE3, 3 for F16C, 4 for AVX2, others for AVX-512. -1 to use Avisynth+ functions.
+				args[5].AsInt(0),		// Threads converting bands of rows, 0 for all logical cores
 				env);					// env is the link to essential informations, always provide it
 		}
 	} else {
@@ -185,7 +194,8 @@ AVSValue __cdecl Create_ConvertFromShader(AVSValue args, void* user_data, IScrip
 				stack16,			// lsb / Stack16
 				format,				// destination format
 				false,
-				Opt,				// 0 for C++ only, 1 for use SSE2, 2 for use SSSE3 and others for use F16C. -1 to use Avisynth+ functions.
+				Opt,				// 0 for C++ only, 1 for SSE2, 2 for SSSE3, 3 for F16C, 4 for AVX2, others for AVX-512. -1 to use Avisynth+ functions.
+				args[5].AsInt(0),	// Threads converting bands of rows, 0 for all logical cores
 				env);				// env is the link to essential informations, always provide it
 
 			if (viDst.IsY8() || viDst.IsYV12() || viDst.IsYV16()) {
@@ -303,6 +313,52 @@ AVSValue __cdecl Create_Shader(AVSValue args, void* user_data, IScriptEnvironmen
 		env);						// env is the link to essential informations, always provide it
 }
 
+// Without Direct3D 9, ExecuteShader runs on the CPU by default.
+#ifdef _WIN32
+static const bool DEFAULT_CPU = false;
+#else
+static const bool DEFAULT_CPU = true;
+#endif
+
+// With Convert, ExecuteShader packs clips in their source format while uploading them, like ConvertToShader does
+// in AviSynth 2.6. Their chroma is resampled here and clips with Precision=0 are converted to Y8.
+static PClip PrepareSourceClip(PClip input, int precision, bool stack16, IScriptEnvironment* env) {
+	const VideoInfo& vi = input->GetVideoInfo();
+	if (vi.BitsPerComponent() > 8)
+		env->ThrowError("ExecuteShader: Convert doesn't support high-bit-depth clips; call ConvertToShader instead");
+	if (precision == 0)
+		return vi.IsY8() ? input : env->Invoke("ConvertToY8", input).AsClip();
+	if (stack16 && precision == 1)
+		env->ThrowError("ExecuteShader: When using lsb_in, don't set a clip precision of 1!");
+	if (stack16 && vi.IsRGB())
+		env->ThrowError("ExecuteShader: Conversion from Stack16 only supports YV12 and YV24");
+	return ResampleChromaTo444(input, stack16, "ExecuteShader", env);
+}
+
+// With OutputFormat, ExecuteShader unpacks its result like ConvertFromShader does in AviSynth 2.6. It writes YV24,
+// RGB24 or RGB32 frames, or YV24 Stack16 with lsb_out, and YUV444P16 from planar 16-bit textures. Other formats are
+// resampled from these here. Returns the format ExecuteShader writes.
+static int GetUnpackedFormat(const VideoInfo& viDst, int outputPrecision, bool planarOut, bool stack16, IScriptEnvironment* env) {
+	if (viDst.pixel_type == 0)
+		env->ThrowError("ExecuteShader: OutputFormat is not supported");
+	if (stack16 && outputPrecision < 2)
+		env->ThrowError("ExecuteShader: When using lsb_out, OutputPrecision must be 2 or 3");
+	if (stack16 && !viDst.IsYV12() && !viDst.IsYV24())
+		env->ThrowError("ExecuteShader: Conversion to Stack16 only supports YV12 and YV24");
+	if (stack16 && viDst.IsYV12() && !env->FunctionExists("Dither_resize16nr"))
+		env->ThrowError("ExecuteShader: Dither_resize16nr is missing.");
+	if (viDst.BitsPerComponent() > 8) {
+		if (viDst.BitsPerComponent() != 16 || !viDst.IsYUV() || viDst.NumComponents() != 3 || outputPrecision != 2 || !planarOut)
+			env->ThrowError("ExecuteShader: High-bit-depth OutputFormat must be 16-bit YUV, with OutputPrecision=2 and PlanarOut=true; call ConvertFromShader instead");
+		return VideoInfo::CS_YUV444P16;
+	}
+	if (viDst.IsRGB24() || viDst.IsRGB32())
+		return viDst.pixel_type;
+	if (!viDst.IsY8() && !viDst.IsYV12() && !viDst.IsYV16() && !viDst.IsYV24())
+		env->ThrowError("ExecuteShader: OutputFormat is not supported; call ConvertFromShader instead");
+	return VideoInfo::CS_YV24;
+}
+
 AVSValue __cdecl Create_ExecuteShader(AVSValue args, void* user_data, IScriptEnvironment* env) {
 	int ParamClipPrecision[9];
 	int CurrentPrecision = 1;
@@ -311,25 +367,156 @@ AVSValue __cdecl Create_ExecuteShader(AVSValue args, void* user_data, IScriptEnv
 		ParamClipPrecision[i] = CurrentPrecision;
 	}
 
+	bool Convert = args[30].AsBool(false);
+	bool lsbIn = args[31].AsBool(false);
 	// P.F. IsClip() pre-check, because avisynth debug version give assert if AsClip() is not a clip
 	// preventing happy debugging
-	return new ExecuteShader(
+	PClip Clips[9];
+	for (int i = 0; i < 9; i++) {
+		if (args[i + 1].IsClip()) {
+			Clips[i] = args[i + 1].AsClip();
+			if (Convert)
+				Clips[i] = PrepareSourceClip(Clips[i], ParamClipPrecision[i], lsbIn, env);
+		}
+	}
+
+	// The chroma of OutputFormat is resampled after ExecuteShader.
+	std::string Format = args[33].AsString("");
+	std::transform(Format.begin(), Format.end(), Format.begin(), toupper);
+	bool lsbOut = args[34].AsBool(false);
+	VideoInfo viDst = pixelFormatParser.GetVideoInfo(Format);
+	int OutputFormat = Format.empty() ? 0 : GetUnpackedFormat(viDst, args[20].AsInt(1), args[21].AsBool(false), lsbOut, env);
+
+	PClip Result = new ExecuteShader(
 		args[0].AsClip(),			// source clip containing commands
-		args[1].IsClip() ? args[1].AsClip() : nullptr,			// Clip1
-		args[2].IsClip() ? args[2].AsClip() : nullptr,			// Clip2
-		args[3].IsClip() ? args[3].AsClip() : nullptr,			// Clip3
-		args[4].IsClip() ? args[4].AsClip() : nullptr,			// Clip4
-		args[5].IsClip() ? args[5].AsClip() : nullptr,			// Clip5
-		args[6].IsClip() ? args[6].AsClip() : nullptr,			// Clip6
-		args[7].IsClip() ? args[7].AsClip() : nullptr,			// Clip7
-		args[8].IsClip() ? args[8].AsClip() : nullptr,			// Clip8
-		args[9].IsClip() ? args[9].AsClip() : nullptr,			// Clip9
+		Clips[0],					// Clip1
+		Clips[1],					// Clip2
+		Clips[2],					// Clip3
+		Clips[3],					// Clip4
+		Clips[4],					// Clip5
+		Clips[5],					// Clip6
+		Clips[6],					// Clip7
+		Clips[7],					// Clip8
+		Clips[8],					// Clip9
 		ParamClipPrecision,			// ClipPrecision, args[10-18]
 		args[19].AsInt(3),			// Precision
 		args[20].AsInt(1),			// PrecisionOut
 		args[21].AsBool(false),		// PlanarOut
 		args[22].AsInt(1),			// Engines count
 		args[23].AsBool(false),		// Resource (don't search for file)
+		args[24].AsBool(DEFAULT_CPU),	// Cpu (run on the CPU instead of DirectX)
+		args[25].AsInt(0),			// Threads used by the CPU engine and by Convert
+		args[26].AsInt(0),			// TileHeight (rows per tile, 0 for whole frames)
+		args[27].AsInt(0),			// Lookahead (frames past the oldest one, 0 for no limit)
+		args[28].AsInt(0),			// ReadAhead (frames processed in the background, 0 to disable)
+		args[29].AsString(""),		// ShaderCache (folder keeping compiled shaders)
+		Convert,					// Convert (clips are in their source format)
+		lsbIn,						// lsb_in (source clips are Stack16)
+		args[32].AsBool(false),		// PlanarIn (pack clips as planar textures)
+		OutputFormat,				// OutputFormat (format written by the readback, 0 for the texture itself)
+		lsbOut,						// lsb_out (output is Stack16)
+		env);
+
+	if (OutputFormat && lsbOut && viDst.IsYV12()) {
+		AVSValue sargs[6] = { Result, Result->GetVideoInfo().width, Result->GetVideoInfo().height / 2, "Spline36", "YV12", true };
+		const char *nargs[6] = { 0, 0, 0, "kernel", "csp", "invks" };
+		Result = env->Invoke("Dither_resize16nr", AVSValue(sargs, 6), nargs).AsClip();
+	}
+	else if (OutputFormat && viDst.BitsPerComponent() > 8 && (viDst.Is420() || viDst.Is422())) {
+		AVSValue sargs[2] = { Result, "Spline36" };
+		const char *nargs[2] = { 0, "chromaresample" };
+		Result = env->Invoke(viDst.Is422() ? "ConvertToYUV422" : "ConvertToYUV420", AVSValue(sargs, 2), nargs).AsClip();
+	}
+	else if (OutputFormat && (viDst.IsYV12() || viDst.IsYV16() || viDst.IsY8()))
+		Result = env->Invoke(viDst.IsYV12() ? "ConvertToYV12" : viDst.IsYV16() ? "ConvertToYV16" : "ConvertToY8", Result).AsClip();
+	return Result;
+}
+
+AVSValue __cdecl Create_SSimDownscale(AVSValue args, void* user_data, IScriptEnvironment* env) {
+	PClip input = args[0].AsClip();
+	const VideoInfo& vi = input->GetVideoInfo();
+	if (vi.BitsPerComponent() != 32 || vi.NumComponents() != 3 || (!vi.IsPlanarRGB() && !vi.Is444()))
+		env->ThrowError("SSimDownscale: Source must be planar RGB or YUV 4:4:4 with 32-bit float samples");
+
+	int width = args[1].AsInt(vi.width);
+	int height = args[2].AsInt(vi.height);
+	if (width < 1 || width > vi.width || height < 1 || height > vi.height)
+		env->ThrowError("SSimDownscale: Width and Height must be between 1 and the size of the source");
+
+	float strength = (float)args[3].AsFloat(.5);
+	if (strength < 0 || strength > 1)
+		env->ThrowError("SSimDownscale: Str must be between 0 and 1");
+
+	return new SSimDownscale(
+		input,					// source clip, in linear light
+		width,					// output width
+		height,					// output height
+		strength,				// Str
+		args[4].AsInt(-1),		// 0 for C++ only, -1 to use AVX2 when available
+		args[5].AsInt(0),		// Threads processing bands of rows, 0 for all logical cores
+		env);
+}
+
+AVSValue __cdecl Create_SuperXbrCpu(AVSValue args, void* user_data, IScriptEnvironment* env) {
+	PClip input = args[0].AsClip();
+	const VideoInfo& vi = input->GetVideoInfo();
+	if (vi.BitsPerComponent() != 32 || vi.NumComponents() != 3 || !vi.IsPlanarRGB())
+		env->ThrowError("SuperXbrCpu: Source must be planar RGB with 32-bit float samples");
+
+	float edgeStrength = (float)args[1].AsFloat(1);
+	if (edgeStrength < 0 || edgeStrength > 5)
+		env->ThrowError("SuperXbrCpu: Str must be between 0 and 5");
+
+	float weight = (float)args[2].AsFloat(1);
+	if (weight < 0 || weight > 1.5)
+		env->ThrowError("SuperXbrCpu: Sharp must be between 0 and 1.5");
+
+	int factor = args[3].AsInt(2);
+	if (factor != 2 && factor != 4 && factor != 8 && factor != 16)
+		env->ThrowError("SuperXbrCpu: Factor must be 2, 4, 8 or 16");
+
+	return new SuperXbrCpu(
+		input,					// source clip
+		edgeStrength,			// Str
+		weight,					// Sharp
+		factor,					// Factor
+		args[4].AsInt(-1),		// 0 for C++ only, -1 to use AVX2 when available
+		args[5].AsInt(0),		// Threads processing bands of rows, 0 for all logical cores
+		env);
+}
+
+AVSValue __cdecl Create_SuperResCpu(AVSValue args, void* user_data, IScriptEnvironment* env) {
+	PClip input = args[0].AsClip();
+	PClip original = args[1].AsClip();
+	const VideoInfo& vi = input->GetVideoInfo();
+	const VideoInfo& viOriginal = original->GetVideoInfo();
+	const char* matrixIn = args[5].AsString("");
+	if (vi.BitsPerComponent() != 32 || vi.NumComponents() != 3 || !vi.IsPlanarRGB())
+		env->ThrowError("SuperResCpu: Source must be planar RGB with 32-bit float samples");
+	if (viOriginal.BitsPerComponent() != 32 || viOriginal.NumComponents() != 3 || !(matrixIn[0] ? viOriginal.Is444() : viOriginal.IsPlanarRGB()))
+		env->ThrowError("SuperResCpu: Original must be planar RGB with 32-bit float samples, or YUV 4:4:4 when MatrixIn is set");
+	if (viOriginal.width > vi.width || viOriginal.height > vi.height)
+		env->ThrowError("SuperResCpu: Original must not be larger than the source");
+	if (vi.num_frames != viOriginal.num_frames)
+		env->ThrowError("SuperResCpu: Source and Original must have the same number of frames");
+
+	float strength = (float)args[2].AsFloat(1);
+	if (strength < 0 || strength > 1)
+		env->ThrowError("SuperResCpu: Str must be between 0 and 1");
+
+	float softness = (float)args[3].AsFloat(0);
+	if (softness < 0 || softness > 1)
+		env->ThrowError("SuperResCpu: Soft must be between 0 and 1");
+
+	return new SuperResCpu(
+		input,					// current image, in linear light
+		original,				// source clip before upscaling, in gamma light
+		strength,				// Str
+		softness,				// Soft
+		args[4].AsBool(true),	// FinalPass: output in gamma light, or YUV with MatrixOut
+		matrixIn,				// MatrixIn: Original is YUV when set
+		args[6].AsString(""),	// MatrixOut: final pass outputs YUV when set
+		args[7].AsInt(0),		// Threads processing bands of rows, 0 for all logical cores
 		env);
 }
 
@@ -352,10 +539,13 @@ const AVS_Linkage *AVS_linkage = 0;
 
 extern "C" __declspec(dllexport) const char* __stdcall AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors) {
 	AVS_linkage = vectors;
-	env->AddFunction("ConvertToShader", "c[Precision]i[lsb]b[planar]b[opt]i", Create_ConvertToShader, 0);
-	env->AddFunction("ConvertFromShader", "c[Precision]i[Format]s[lsb]b[opt]i", Create_ConvertFromShader, 0);
+	env->AddFunction("ConvertToShader", "c[Precision]i[lsb]b[planar]b[opt]i[threads]i", Create_ConvertToShader, 0);
+	env->AddFunction("ConvertFromShader", "c[Precision]i[Format]s[lsb]b[opt]i[threads]i", Create_ConvertFromShader, 0);
 	env->AddFunction("Shader", "c[Path]s[EntryPoint]s[ShaderModel]s[Param0]s[Param1]s[Param2]s[Param3]s[Param4]s[Param5]s[Param6]s[Param7]s[Param8]s[Clip1]i[Clip2]i[Clip3]i[Clip4]i[Clip5]i[Clip6]i[Clip7]i[Clip8]i[Clip9]i[Output]i[Width]i[Height]i[Precision]i[Defines]s", Create_Shader, 0);
-	env->AddFunction("ExecuteShader", "c[Clip1]c[Clip2]c[Clip3]c[Clip4]c[Clip5]c[Clip6]c[Clip7]c[Clip8]c[Clip9]c[Clip1Precision]i[Clip2Precision]i[Clip3Precision]i[Clip4Precision]i[Clip5Precision]i[Clip6Precision]i[Clip7Precision]i[Clip8Precision]i[Clip9Precision]i[Precision]i[OutputPrecision]i[PlanarOut]b[Engines]i[Resource]b", Create_ExecuteShader, 0);
+	env->AddFunction("ExecuteShader", "c[Clip1]c[Clip2]c[Clip3]c[Clip4]c[Clip5]c[Clip6]c[Clip7]c[Clip8]c[Clip9]c[Clip1Precision]i[Clip2Precision]i[Clip3Precision]i[Clip4Precision]i[Clip5Precision]i[Clip6Precision]i[Clip7Precision]i[Clip8Precision]i[Clip9Precision]i[Precision]i[OutputPrecision]i[PlanarOut]b[Engines]i[Resource]b[Cpu]b[Threads]i[TileHeight]i[Lookahead]i[ReadAhead]i[ShaderCache]s[Convert]b[lsb_in]b[PlanarIn]b[OutputFormat]s[lsb_out]b", Create_ExecuteShader, 0);
+	env->AddFunction("SSimDownscale", "c[Width]i[Height]i[Str]f[opt]i[threads]i", Create_SSimDownscale, 0);
+	env->AddFunction("SuperXbrCpu", "c[Str]f[Sharp]f[Factor]i[opt]i[threads]i", Create_SuperXbrCpu, 0);
+	env->AddFunction("SuperResCpu", "cc[Str]f[Soft]f[Final]b[MatrixIn]s[MatrixOut]s[threads]i", Create_SuperResCpu, 0);
 	env->AddFunction("Shader_GetBitDepth", "c[format]s", Create_GetBitDepth, 0);
 
 	env->AddFunction("Shader_ConvertFromStacked", "c[bits]i", ConvertFromStacked::Create, 0);
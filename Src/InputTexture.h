@@ -1,12 +1,19 @@
+#pragma once
+#ifdef _WIN32
 #include "atlbase.h"
 #include "d3d9.h"
 #include "MemoryPool.h"
-#pragma once
+#else
+class MemoryPool;
+#endif
+#include "CpuTexture.h"
 
 struct InputTexture {
 	int ClipIndex;
 	int Width, Height;
+	bool Planned; // Owned by a step of the engine's frame plan
 	MemoryPool* Pool; // The pool containing this texture
+#ifdef _WIN32
 	CComPtr<IDirect3DSurface9> Memory;
 	CComPtr<IDirect3DTexture9> Texture;
 	CComPtr<IDirect3DSurface9> Surface;
@@ -16,4 +23,10 @@ struct InputTexture {
 	CComPtr<IDirect3DSurface9> SurfaceU;
 	CComPtr<IDirect3DTexture9> TextureV;
 	CComPtr<IDirect3DSurface9> SurfaceV;
+#endif
+	// Textures of the CPU engine, used instead of the Direct3D objects.
+	CpuTexture* Buffer = nullptr;
+	CpuTexture* BufferY = nullptr;
+	CpuTexture* BufferU = nullptr;
+	CpuTexture* BufferV = nullptr;
 };
\ No newline at end of file
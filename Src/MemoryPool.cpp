@@ -12,21 +12,34 @@ MemoryPool::~MemoryPool() {
 	m_Pool.clear();
 }
 
+static int GetFormatBytes(D3DFORMAT format) {
+	switch (format) {
+	case D3DFMT_L8:
+		return 1;
+	case D3DFMT_L16:
+	case D3DFMT_R16F:
+		return 2;
+	case D3DFMT_A8R8G8B8:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
 HRESULT MemoryPool::AllocateInternal(CComPtr<IDirect3DDevice9Ex> device, bool gpuTexture, int width, int height, bool renderTarget, D3DFORMAT format, CComPtr<IDirect3DTexture9> &texture, CComPtr<IDirect3DSurface9> &surface) {
 	// Textures must be created by the device that will use them; thus, a memory pool is required for each device.
 
-	m_mutex.lock();
-	// Search for available texture in pool.
-	for (auto const item : m_Pool) {
-		if (item->Available == true && item->GpuTexture == gpuTexture && item->Width == width && item->Height == height && item->RenderTarget == renderTarget && item->Format == format) {
-			item->Available = false;
-			texture = item->Texture;
-			surface = item->Surface;
-			m_mutex.unlock();
-			return S_OK;
-		}
+	// Take an available texture from the free list.
+	std::vector<PooledTexture*>& Free = m_Free[PoolKey{ gpuTexture, width, height, renderTarget, format }];
+	if (!Free.empty()) {
+		PooledTexture* item = Free.back();
+		Free.pop_back();
+		MarkInUse(item);
+		m_Stats.Hits++;
+		texture = item->Texture;
+		surface = item->Surface;
+		return S_OK;
 	}
-	m_mutex.unlock();
 
 	// If not found, create it
 	// Note: CreateOffscreenPlainSurface fails for L8 format on NVidia cards but CreateTexture works.
@@ -35,7 +48,7 @@ HRESULT MemoryPool::AllocateInternal(CComPtr<IDirect3DDevice9Ex> device, bool gp
 
 	// Add to memory pool.
 	PooledTexture* NewObj = new PooledTexture();
-	NewObj->Available = false;
+	NewObj->Available = true;
 	NewObj->GpuTexture = gpuTexture;
 	NewObj->Width = width;
 	NewObj->Height = height;
@@ -43,13 +56,21 @@ HRESULT MemoryPool::AllocateInternal(CComPtr<IDirect3DDevice9Ex> device, bool gp
 	NewObj->Format = format;
 	NewObj->Texture = texture ? texture : nullptr;
 	NewObj->Surface = surface ? surface : nullptr;
-	m_mutex.lock();
 	m_Pool.push_back(NewObj);
-	m_mutex.unlock();
+	m_Surfaces[NewObj->Surface] = NewObj;
+	m_Stats.Misses++;
+	m_Stats.BytesResident += (uint64_t)width * height * GetFormatBytes(format);
+	MarkInUse(NewObj);
 
 	return S_OK;
 }
 
+void MemoryPool::MarkInUse(PooledTexture* item) {
+	item->Available = false;
+	m_Stats.BytesInUse += (uint64_t)item->Width * item->Height * GetFormatBytes(item->Format);
+	m_Stats.PeakSum = std::max(m_Stats.PeakSum, m_Stats.BytesInUse);
+}
+
 HRESULT MemoryPool::AllocateTexture(CComPtr<IDirect3DDevice9Ex> device, int width, int height, bool renderTarget, D3DFORMAT format, CComPtr<IDirect3DTexture9> &texture, CComPtr<IDirect3DSurface9> &surface) {
 	return AllocateInternal(device, true, width, height, renderTarget, format, texture, surface);
 }
@@ -62,14 +83,33 @@ HRESULT MemoryPool::Release(IDirect3DSurface9 *surface) {
 	if (!surface)
 		return S_OK;
 
-	std::unique_lock<std::mutex> my_lock(m_mutex);
+	auto Found = m_Surfaces.find(surface);
+	if (Found == m_Surfaces.end())
+		return E_FAIL;
 
-	for (auto const item : m_Pool) {
-		if (item->Surface == surface) {
-			item->Available = true;
-			return S_OK;
-		}
+	PooledTexture* item = Found->second;
+	if (!item->Available) {
+		item->Available = true;
+		m_Stats.BytesInUse -= (uint64_t)item->Width * item->Height * GetFormatBytes(item->Format);
+		m_Free[PoolKey{ item->GpuTexture, item->Width, item->Height, item->RenderTarget, item->Format }].push_back(item);
 	}
+	return S_OK;
+}
+
+// Marks a released texture as used again without searching by format, for memory that stays bound to a frame plan.
+HRESULT MemoryPool::Reserve(IDirect3DSurface9 *surface) {
+	if (!surface)
+		return S_OK;
+
+	auto Found = m_Surfaces.find(surface);
+	if (Found == m_Surfaces.end())
+		return E_FAIL;
 
-	return E_FAIL;
+	PooledTexture* item = Found->second;
+	if (item->Available) {
+		std::vector<PooledTexture*>& Free = m_Free[PoolKey{ item->GpuTexture, item->Width, item->Height, item->RenderTarget, item->Format }];
+		Free.erase(std::remove(Free.begin(), Free.end(), item), Free.end());
+		MarkInUse(item);
+	}
+	return S_OK;
 }
@@ -5,11 +5,14 @@
 #include "atlbase.h"
 #include "D3D9Macros.h"
 #include "PooledTexture.h"
+#include "MemoryPoolStats.h"
 #include <vector>
+#include <unordered_map>
 #include <algorithm>
-#include <mutex>
 
-/* Creates DX9 textures and surfaces on-demand and store them in a pool for re-use. */
+/* Creates DX9 textures and surfaces on-demand and store them in a pool for re-use.
+   Available textures are kept in a free list per size and format, so both allocating and releasing are O(1).
+   The pool doesn't lock: each engine owns its pool and only uses it while reserved by EngineScheduler. */
 
 class MemoryPool {
 public:
@@ -18,9 +21,30 @@ public:
 	HRESULT AllocateTexture(CComPtr<IDirect3DDevice9Ex> device, int width, int height, bool renderTarget, D3DFORMAT format, CComPtr<IDirect3DTexture9> &texture, CComPtr<IDirect3DSurface9> &surface);
 	HRESULT AllocatePlainSurface(CComPtr<IDirect3DDevice9Ex> device, int width, int height, D3DFORMAT format, CComPtr<IDirect3DSurface9> &surface);
 	HRESULT Release(IDirect3DSurface9 *surface);
+	HRESULT Reserve(IDirect3DSurface9 *surface);
+	const MemoryPoolStats& GetStats() const { return m_Stats; }
 private:
+	// Textures are interchangeable when all of these match.
+	struct PoolKey {
+		bool GpuTexture;
+		int Width;
+		int Height;
+		bool RenderTarget;
+		D3DFORMAT Format;
+		bool operator==(const PoolKey& other) const {
+			return GpuTexture == other.GpuTexture && Width == other.Width && Height == other.Height && RenderTarget == other.RenderTarget && Format == other.Format;
+		}
+	};
+	struct PoolKeyHash {
+		size_t operator()(const PoolKey& key) const {
+			return ((size_t)key.Width * 73856093u) ^ ((size_t)key.Height * 19349663u) ^ ((size_t)key.Format * 83492791u) ^ (key.GpuTexture ? 1 : 0) ^ (key.RenderTarget ? 2 : 0);
+		}
+	};
+
 	HRESULT AllocateInternal(CComPtr<IDirect3DDevice9Ex> device, bool gpuTexture, int width, int height, bool renderTarget, D3DFORMAT format, CComPtr<IDirect3DTexture9> &texture, CComPtr<IDirect3DSurface9> &surface);
+	void MarkInUse(PooledTexture* item);
 	std::vector<PooledTexture*> m_Pool;
-	//CComPtr<IDirect3DDevice9Ex> m_pDevice;
-	std::mutex m_mutex;
-};
\ No newline at end of file
+	std::unordered_map<PoolKey, std::vector<PooledTexture*>, PoolKeyHash> m_Free;
+	std::unordered_map<IDirect3DSurface9*, PooledTexture*> m_Surfaces;
+	MemoryPoolStats m_Stats = {};
+};
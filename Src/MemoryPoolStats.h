@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+// Usage counters of MemoryPool and CpuMemoryPool, for tuning the memory footprint of command chains.
+struct MemoryPoolStats {
+	uint64_t Hits;			// Allocations served from a free list
+	uint64_t Misses;		// Allocations that created a new texture
+	uint64_t BytesResident;	// Memory held by the pool, available or not
+	uint64_t BytesInUse;	// Memory currently allocated from the pool
+	uint64_t PeakSum;		// Peak of BytesInUse; for stats added from several pools, the sum of their peaks. Pools peak
+							// at different times, so this is more than the memory they ever used together.
+
+	void Add(const MemoryPoolStats& other) {
+		Hits += other.Hits;
+		Misses += other.Misses;
+		BytesResident += other.BytesResident;
+		BytesInUse += other.BytesInUse;
+		PeakSum += other.PeakSum;
+	}
+};
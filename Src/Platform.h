@@ -0,0 +1,53 @@
+#pragma once
+
+// MSVC keywords and Windows types used by the conversion kernels, the filters and the CPU engine of ExecuteShader, for
+// GCC and Clang builds on Linux. The Direct3D engine remains Windows-only.
+
+#ifndef _MSC_VER
+#ifndef __forceinline
+#define __forceinline inline __attribute__((always_inline))
+#endif
+#endif
+
+#ifndef _WIN32
+#ifndef __stdcall
+#define __stdcall
+#endif
+#ifndef __cdecl
+#define __cdecl
+#endif
+
+#include <cstdint>
+#include <cstdlib>
+
+typedef int32_t HRESULT;
+typedef uint32_t DWORD;
+typedef unsigned int UINT;
+
+// E_FAIL and FAILED are defined the same way as in avs/posix.h, so that either header can come first.
+#ifndef S_OK
+#define S_OK ((HRESULT)0)
+#endif
+#define E_FAIL        (0x80004005)
+#define FAILED(hr)    ((hr) & 0x80000000)
+#ifndef E_INVALIDARG
+#define E_INVALIDARG ((HRESULT)0x80070057)
+#endif
+#ifndef E_OUTOFMEMORY
+#define E_OUTOFMEMORY ((HRESULT)0x8007000E)
+#endif
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+static inline void* _aligned_malloc(size_t size, size_t alignment)
+{
+    void* Result = nullptr;
+    return posix_memalign(&Result, alignment, size) == 0 ? Result : nullptr;
+}
+
+static inline void _aligned_free(void* p)
+{
+    free(p);
+}
+#endif
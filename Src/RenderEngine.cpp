@@ -0,0 +1,67 @@
+#include "RenderEngine.h"
+
+RenderEngine::~RenderEngine() {
+	// The memory belongs to the pool of the derived engine.
+	for (auto const& item : m_Plan) {
+		delete item.Texture;
+	}
+}
+
+HRESULT RenderEngine::AcquireTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture** outTexture) {
+	if (m_PlanRecorded && !m_PlanDiverged) {
+		if (m_PlanStep < m_Plan.size()) {
+			FramePlanStep* Step = &m_Plan[m_PlanStep];
+			if (Step->ClipIndex == clipIndex && Step->Width == width && Step->Height == height && Step->Precision == shaderPrecision &&
+				Step->IsInput == isInput && Step->IsPlanar == isPlanar && Step->IsLast == isLast) {
+				m_PlanStep++;
+				*outTexture = Step->Texture;
+				return S_OK;
+			}
+		}
+		m_PlanDiverged = true;
+	}
+
+	InputTexture* NewTexture = new InputTexture();
+	HRESULT hr = CreateTexture(clipIndex, width, height, isInput, isPlanar, isLast, shaderPrecision, NewTexture);
+	if (FAILED(hr)) {
+		delete NewTexture;
+		return hr;
+	}
+
+	if (!m_PlanRecorded) {
+		NewTexture->Planned = true;
+		m_Plan.push_back(FramePlanStep{ clipIndex, width, height, shaderPrecision, isInput, isPlanar, isLast, NewTexture });
+	}
+	*outTexture = NewTexture;
+	return S_OK;
+}
+
+HRESULT RenderEngine::DiscardTexture(std::vector<InputTexture*>* textureList, InputTexture* item) {
+	textureList->erase(std::remove(textureList->begin(), textureList->end(), item), textureList->end());
+	if (!item->Planned) {
+		HR(ReleaseTextureMemory(item));
+		delete item;
+	}
+	else if (!m_PlanRecorded) {
+		// While recording, memory goes back to the pool so that later steps share it like they would without a plan.
+		HR(ReleaseTextureMemory(item));
+	}
+	return S_OK;
+}
+
+HRESULT RenderEngine::ClearTextures(std::vector<InputTexture*>* textureList) {
+	while (!textureList->empty()) {
+		HR(DiscardTexture(textureList, textureList->back()));
+	}
+
+	if (!m_PlanRecorded) {
+		// Steps whose lifetimes didn't overlap got the same memory from the pool; they keep sharing it.
+		for (auto const& item : m_Plan) {
+			HR(ReserveTextureMemory(item.Texture));
+		}
+		m_PlanRecorded = true;
+	}
+	m_PlanStep = 0;
+	m_PlanDiverged = false;
+	return S_OK;
+}
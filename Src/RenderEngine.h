@@ -0,0 +1,75 @@
+#pragma once
+#include "avisynth.h"
+#include "D3D9Macros.h"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "CommandStruct.h"
+#include "InputTexture.h"
+#include "MemoryPoolStats.h"
+
+// Interface of the engines executing the command chain for ExecuteShader.
+// D3D9RenderImpl runs the shaders on the graphic card while CpuRenderImpl runs native ports of the bundled shaders on the CPU.
+//
+// Each engine keeps a frame plan: the first time the command chain runs (the dry-run in the ExecuteShader constructor),
+// every texture created is recorded as a step of the plan along with its memory. Following frames get the same textures
+// back in the same order without going through the memory pool. If a frame creates different textures than the recorded
+// ones, the rest of that frame falls back to the memory pool. As the textures of the plan are shared by all frames, an
+// engine processes one frame at a time; EngineScheduler hands engines to frames.
+class RenderEngine {
+public:
+	virtual ~RenderEngine();
+
+	// Allocates the memory of outTexture. On failure, what was already allocated goes back to the pool, so that the
+	// caller only has to delete outTexture.
+	virtual HRESULT CreateTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture* outTexture) = 0;
+	virtual HRESULT CopyBuffer(std::vector<InputTexture*>* textureList, InputTexture* src, CommandStruct* cmd) = 0;
+	virtual HRESULT ProcessFrame(std::vector<InputTexture*>* textureList, CommandStruct* cmd, int width, int height, bool isLast, int planeOut) = 0;
+	virtual HRESULT InitPixelShader(CommandStruct* cmd, int planeOut) = 0;
+	virtual HRESULT SetPixelShaderConstant(int index, const ParamStruct* param) = 0;
+	virtual HRESULT CopyDitherMatrix(std::vector<InputTexture*>* textureList, int outputIndex) = 0;
+	virtual HRESULT ResetSamplerState() = 0;
+
+	// Transfers between AviSynth frames and the engine textures.
+	virtual HRESULT CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) = 0;
+	virtual HRESULT CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) = 0;
+	virtual HRESULT CopyBufferToAviSynth(InputTexture* src, byte* dst, int dstPitch, int outputPrecision) = 0;
+	virtual HRESULT CopyBufferToAviSynthPlanar(InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) = 0;
+
+	// Limits the following renders, copies and transfers to rows [top, bottom) of their destination, for frames
+	// processed in tiles; bottom = -1 restores whole textures. Engines that can't render partial textures ignore it.
+	virtual void SetRowRange(int /*top*/, int /*bottom*/) {}
+
+	// Usage counters of the engine's memory pool.
+	virtual MemoryPoolStats GetPoolStats() = 0;
+
+	// Returns the texture for the next step of the frame plan, creating it if the plan isn't recorded yet.
+	HRESULT AcquireTexture(int clipIndex, int width, int height, bool isInput, bool isPlanar, bool isLast, int shaderPrecision, InputTexture** outTexture);
+	// Removes a texture from the list. Textures of the frame plan keep their memory for the next frames.
+	HRESULT DiscardTexture(std::vector<InputTexture*>* textureList, InputTexture* item);
+	// Ends the frame and clears the list. The first call completes the frame plan.
+	HRESULT ClearTextures(std::vector<InputTexture*>* textureList);
+
+	static const int maxClips = 9;
+	// Folder where InitPixelShader keeps compiled HLSL shaders between runs, or empty to only share them in memory.
+	std::string ShaderCacheFolder;
+
+protected:
+	// Returns the memory of a texture to the pool without deleting the InputTexture.
+	virtual HRESULT ReleaseTextureMemory(InputTexture* texture) = 0;
+	// Takes the memory of a texture out of the pool for good; used for the textures of the frame plan.
+	virtual HRESULT ReserveTextureMemory(InputTexture* texture) = 0;
+
+private:
+	struct FramePlanStep {
+		int ClipIndex, Width, Height, Precision;
+		bool IsInput, IsPlanar, IsLast;
+		InputTexture* Texture;
+	};
+
+	std::vector<FramePlanStep> m_Plan;
+	size_t m_PlanStep = 0;
+	bool m_PlanRecorded = false;
+	bool m_PlanDiverged = false;
+};
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "SSimDownscale.h"
+
+extern bool has_avx2() noexcept;
+
+
+// Same taps as GetDownscaleTaps in CpuShaders.cpp, with c0 = output size, c1 = 1 / output size and
+// c2 = input size, as set by ResizeShader.
+void GetSSimTaps(int inSize, int outSize, SSimTaps& taps) {
+	const float p0 = (float)outSize;
+	const float dxdy = 1.0f / outSize;
+	const float InputSize = (float)inSize;
+	const float ddxddy = 1.0f / inSize;
+	const float factor = ddxddy * p0;
+	const float Taps = 1 + factor;
+
+	taps.Start.clear();
+	taps.Index.clear();
+	taps.Weight.clear();
+	for (int i = 0; i < outSize; i++) {
+		const float tex = (i + 0.5f) * dxdy;
+		const int low = (int)std::floor((tex - 0.5f * Taps * dxdy) * InputSize + 0.5f);
+		const int high = (int)std::floor((tex + 0.5f * Taps * dxdy) * InputSize + 0.5f);
+		const int first = (int)taps.Index.size();
+		float W = 0;
+		taps.Start.push_back(first);
+		for (int k = 0; k < high - low; k++) {
+			const float pos = ddxddy * (k + low + 0.5f);
+			const float rel = (pos - tex) * p0;
+			const float w = std::min(std::max(0.5f + (0.5f - std::abs(rel)) / factor, 0.0f), 1.0f);
+			taps.Index.push_back(std::min(std::max(k + low, 0), inSize - 1));
+			taps.Weight.push_back(w);
+			W += w;
+		}
+		for (int k = first; k < (int)taps.Weight.size(); k++)
+			taps.Weight[k] /= W;
+	}
+	taps.Start.push_back((int)taps.Index.size());
+}
+
+
+// C++ kernels
+
+static void downscale_h_c(const float* src, int srcPitch, int rows, int /*srcWidth*/, const SSimTaps& taps, int width, float* mean, float* var, int dstPitch) {
+	for (int y = 0; y < rows; y++) {
+		const float* s = src + (size_t)y * srcPitch;
+		float* m = mean + (size_t)y * dstPitch;
+		float* v = var + (size_t)y * dstPitch;
+		for (int x = 0; x < width; x++) {
+			float avg = 0;
+			for (int k = taps.Start[x]; k < taps.Start[x + 1]; k++)
+				avg += taps.Weight[k] * s[taps.Index[k]];
+			float sum = 0;
+			for (int k = taps.Start[x]; k < taps.Start[x + 1]; k++) {
+				const float d = s[taps.Index[k]] - avg;
+				sum += taps.Weight[k] * d * d;
+			}
+			m[x] = avg;
+			v[x] = sum;
+		}
+	}
+}
+
+static void downscale_v_c(const float* const* mean, const float* const* var, const float* weight, int taps, int width, float* dstMean, float* dstVar) {
+	for (int x = 0; x < width; x++) {
+		float avg = 0;
+		for (int k = 0; k < taps; k++)
+			avg += weight[k] * mean[k][x];
+		float sum = 0;
+		for (int k = 0; k < taps; k++) {
+			const float d = mean[k][x] - avg;
+			sum += weight[k] * (var[k][x] + d * d);
+		}
+		dstMean[x] = avg;
+		dstVar[x] = sum;
+	}
+}
+
+// SSimConvolver.hlsl: (0.5, 1, 0.5) / 2 along each axis.
+static inline float convolve_c(const float* const* p, int x) {
+	float avg = 0;
+	for (int i = 0; i < 3; i++) {
+		const float w = i == 1 ? 0.5f : 0.25f;
+		avg += w * (0.25f * p[i][x - 1] + 0.5f * p[i][x] + 0.25f * p[i][x + 1]);
+	}
+	return avg;
+}
+
+static void mean_and_r_c(const float* const* L, const float* const* V, int width, float* M, float* R, float* RM, float* RR, bool accumulate) {
+	for (int x = 0; x < width; x++) {
+		const float mean = convolve_c(L, x);
+		const float var = convolve_c(V, x);
+		float sum = 0;
+		for (int i = 0; i < 3; i++) {
+			const float w = i == 1 ? 0.5f : 0.25f;
+			const float d0 = L[i][x - 1] - mean, d1 = L[i][x] - mean, d2 = L[i][x + 1] - mean;
+			sum += w * (0.25f * d0 * d0 + 0.5f * d1 * d1 + 0.25f * d2 * d2);
+		}
+		const float r = sum == 0 ? 0 : std::sqrt(1 + var / sum);
+		M[x] = mean;
+		R[x] = r;
+		RM[x] = r * mean;
+		RR[x] = accumulate ? RR[x] + r * r : r * r;
+	}
+}
+
+static void strength_c(const float* const* RR, int width, float strength, float* t) {
+	for (int x = 0; x < width; x++) {
+		const float d = strength + (1 - strength) * convolve_c(RR, x) / 200;
+		t[x] = d > 0 ? strength / d : 1;
+	}
+}
+
+// Sum of lerp(M, L, R) over the 3x3 taps, expanded as conv(M) + L * conv(R) - conv(R * M).
+static void blend_c(const float* const* M, const float* const* R, const float* const* RM, const float* L, const float* t, int width, float* dst) {
+	for (int x = 0; x < width; x++) {
+		const float result = convolve_c(M, x) + L[x] * convolve_c(R, x) - convolve_c(RM, x);
+		dst[x] = L[x] + t[x] * (result - L[x]);
+	}
+}
+
+SSimKernels get_ssim_kernels_c() {
+	return SSimKernels{ downscale_h_c, downscale_v_c, mean_and_r_c, strength_c, blend_c };
+}
+
+
+// Intermediate rows of one band, in the layout expected by the kernels.
+struct SSimRows {
+	void Resize(int width, int rows) {
+		Pitch = ((width + 7) & ~7) + 16;
+		const size_t size = (size_t)Pitch * rows + 16;
+		if (Data.size() < size)
+			Data.resize(size, 0.0f);
+	}
+	float* Row(int y) { return Data.data() + 8 + (size_t)y * Pitch; }
+
+	std::vector<float> Data;
+	int Pitch = 0;
+};
+
+struct SSimBuffers {
+	SSimRows HMean, HVar, V, RR, T;
+	SSimRows L[3], M[3], R[3], RM[3];
+	std::vector<const float*> TapMean, TapVar;
+};
+
+static inline void ExtendRow(float* p, int width) {
+	p[-1] = p[0];
+	p[width] = p[width - 1];
+}
+
+
+SSimDownscale::SSimDownscale(PClip _child, int width, int height, float strength, int opt, int threads, IScriptEnvironment* env) :
+	GenericVideoFilter(_child), viSrc(vi), m_Strength(strength) {
+
+	if (threads < 0)
+		env->ThrowError("SSimDownscale: threads must be 0 or greater.");
+
+	vi.width = width;
+	vi.height = height;
+	GetSSimTaps(viSrc.width, width, m_TapsX);
+	GetSSimTaps(viSrc.height, height, m_TapsY);
+	m_Kernels = opt != 0 && has_avx2() ? get_ssim_kernels_avx2() : get_ssim_kernels_c();
+
+	const bool rgb = vi.IsPlanarRGB();
+	m_Planes[0] = rgb ? PLANAR_R : PLANAR_Y;
+	m_Planes[1] = rgb ? PLANAR_G : PLANAR_U;
+	m_Planes[2] = rgb ? PLANAR_B : PLANAR_V;
+
+	// Instances using all cores share one pool instead of each starting a thread per core.
+	m_Threads = threads > 0 ? std::make_shared<ThreadPool>(threads) : ThreadPool::GetShared();
+
+	// Each band recomputes 2 rows of mean and variance on both sides, so keep bands tall enough for that to be
+	// cheap while leaving a few bands to each thread.
+	m_BandRows = std::min(std::max(height / (m_Threads->GetThreadCount() * 4), 16), 64);
+}
+
+PVideoFrame __stdcall SSimDownscale::GetFrame(int n, IScriptEnvironment* env) {
+	PVideoFrame src = child->GetFrame(n, env);
+	PVideoFrame dst = env->NewVideoFrame(vi);
+
+	const int bands = (vi.height + m_BandRows - 1) / m_BandRows;
+	m_Threads->ParallelFor(bands, 1, [&](int first, int last) {
+		SSimBuffers buffers;
+		for (int i = first; i < last; i++)
+			ProcessBand(src, dst, i * m_BandRows, std::min((i + 1) * m_BandRows, vi.height), buffers);
+	});
+	return dst;
+}
+
+// Runs the 7 passes for output rows [top, bottom). Mean and variance are needed 2 rows around the band for
+// the two 3x3 convolutions, and M and R 1 row around it.
+void SSimDownscale::ProcessBand(const PVideoFrame& src, const PVideoFrame& dst, int top, int bottom, SSimBuffers& b) {
+	const SSimKernels& k = m_Kernels;
+	const int w = vi.width, h = vi.height;
+	const int ya = std::max(top - 2, 0), yb = std::min(bottom + 2, h);
+	const int ma = std::max(top - 1, 0), mb = std::min(bottom + 1, h);
+	const int lo = m_TapsY.Index[m_TapsY.Start[ya]];
+	const int hi = m_TapsY.Index[m_TapsY.Start[yb] - 1] + 1;
+
+	b.HMean.Resize(w, hi - lo);
+	b.HVar.Resize(w, hi - lo);
+	b.V.Resize(w, yb - ya);
+	b.RR.Resize(w, yb - ya);
+	b.T.Resize(w, 1);
+	for (int c = 0; c < 3; c++) {
+		b.L[c].Resize(w, yb - ya);
+		b.M[c].Resize(w, yb - ya);
+		b.R[c].Resize(w, yb - ya);
+		b.RM[c].Resize(w, yb - ya);
+	}
+
+	for (int c = 0; c < 3; c++) {
+		// SSimDownscaler and SSimDownscaledVarI, then SSimDownscaler and SSimDownscaledVarII.
+		const int spitch = src->GetPitch(m_Planes[c]) / sizeof(float);
+		const float* srcp = reinterpret_cast<const float*>(src->GetReadPtr(m_Planes[c])) + (size_t)lo * spitch;
+		k.DownscaleH(srcp, spitch, hi - lo, viSrc.width, m_TapsX, w, b.HMean.Row(0), b.HVar.Row(0), b.HMean.Pitch);
+
+		for (int y = ya; y < yb; y++) {
+			const int first = m_TapsY.Start[y];
+			const int count = m_TapsY.Start[y + 1] - first;
+			b.TapMean.resize(count);
+			b.TapVar.resize(count);
+			for (int i = 0; i < count; i++) {
+				b.TapMean[i] = b.HMean.Row(m_TapsY.Index[first + i] - lo);
+				b.TapVar[i] = b.HVar.Row(m_TapsY.Index[first + i] - lo);
+			}
+			float* L = b.L[c].Row(y - ya);
+			float* V = b.V.Row(y - ya);
+			k.DownscaleV(b.TapMean.data(), b.TapVar.data(), &m_TapsY.Weight[first], count, w, L, V);
+			ExtendRow(L, w);
+			ExtendRow(V, w);
+		}
+
+		// SSimSingleConvolver and SSimCalcR
+		for (int y = ma; y < mb; y++) {
+			const int up = std::max(y - 1, 0) - ya, mid = y - ya, down = std::min(y + 1, h - 1) - ya;
+			const float* L[3] = { b.L[c].Row(up), b.L[c].Row(mid), b.L[c].Row(down) };
+			const float* V[3] = { b.V.Row(up), b.V.Row(mid), b.V.Row(down) };
+			k.MeanAndR(L, V, w, b.M[c].Row(mid), b.R[c].Row(mid), b.RM[c].Row(mid), b.RR.Row(mid), c > 0);
+			ExtendRow(b.M[c].Row(mid), w);
+			ExtendRow(b.R[c].Row(mid), w);
+			ExtendRow(b.RM[c].Row(mid), w);
+			if (c == 2)
+				ExtendRow(b.RR.Row(mid), w);
+		}
+	}
+
+	// SSimCalc
+	for (int y = top; y < bottom; y++) {
+		const int up = std::max(y - 1, 0) - ya, mid = y - ya, down = std::min(y + 1, h - 1) - ya;
+		const float* RR[3] = { b.RR.Row(up), b.RR.Row(mid), b.RR.Row(down) };
+		k.Strength(RR, w, m_Strength, b.T.Row(0));
+		for (int c = 0; c < 3; c++) {
+			const float* M[3] = { b.M[c].Row(up), b.M[c].Row(mid), b.M[c].Row(down) };
+			const float* R[3] = { b.R[c].Row(up), b.R[c].Row(mid), b.R[c].Row(down) };
+			const float* RM[3] = { b.RM[c].Row(up), b.RM[c].Row(mid), b.RM[c].Row(down) };
+			float* dstp = reinterpret_cast<float*>(dst->GetWritePtr(m_Planes[c]) + (size_t)y * dst->GetPitch(m_Planes[c]));
+			k.Blend(M, R, RM, b.L[c].Row(mid), b.T.Row(0), w, dstp);
+		}
+	}
+}
+
+int __stdcall SSimDownscale::SetCacheHints(int cachehints, int frame_range) {
+	return cachehints == CachePolicyHint::CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+#include "Platform.h"
+#include "avisynth.h"
+#include "ThreadPool.h"
+
+/* Native version of the 7 passes that ResizeShader runs with Kernel="SSim": SSimDownscaler (X and Y),
+   SSimDownscaledVarI, SSimDownscaledVarII, SSimSingleConvolver, SSimCalcR and SSimCalc.
+   Works on planar 32-bit float clips, one band of output rows per thread; each band runs all the passes
+   while its rows are in the cache, so the intermediate textures never exist at full size.
+   Mean and variance are computed together, and the 3x3 convolutions of SSimCalc are expanded so that
+   every pass is separable. */
+
+// Taps of SSimDownscaler.hlsl along one axis.
+struct SSimTaps {
+	std::vector<int> Start;		// Index of the first tap of each output coordinate, plus the end of the last one
+	std::vector<int> Index;		// Input pixel of each tap, clamped to the image
+	std::vector<float> Weight;	// Weight of each tap, normalized so that the taps of each output coordinate sum to 1
+};
+
+void GetSSimTaps(int inSize, int outSize, SSimTaps& taps);
+
+// Row kernels. Rows of the intermediate buffers start 8 floats into their allocation and end with at least
+// 8 floats of padding, and their pixel at -1 and at width repeat the edge so that the 3x3 kernels can read
+// one pixel past each side. Pitches are in floats.
+struct SSimKernels {
+	// Downscales rows of src horizontally, and returns both the mean and the variance of the taps around it.
+	void(*DownscaleH)(const float* src, int srcPitch, int rows, int srcWidth, const SSimTaps& taps, int width, float* mean, float* var, int dstPitch);
+	// Downscales vertically the results of DownscaleH. mean[k] and var[k] are the rows of tap k.
+	void(*DownscaleV)(const float* const* mean, const float* const* var, const float* weight, int taps, int width, float* dstMean, float* dstVar);
+	// L and V hold the rows above, at and below. Returns the convolved mean M, the ratio R of SSimCalcR and R * M,
+	// and adds R * R to RR when accumulate is set.
+	void(*MeanAndR)(const float* const* L, const float* const* V, int width, float* M, float* R, float* RM, float* RR, bool accumulate);
+	// Returns the blending factor of SSimCalc from the rows above, at and below of the sum of R * R over the channels.
+	void(*Strength)(const float* const* RR, int width, float strength, float* t);
+	// Writes the final row of one channel.
+	void(*Blend)(const float* const* M, const float* const* R, const float* const* RM, const float* L, const float* t, int width, float* dst);
+};
+
+SSimKernels get_ssim_kernels_c();
+SSimKernels get_ssim_kernels_avx2();
+
+struct SSimBuffers;
+
+
+class SSimDownscale : public GenericVideoFilter {
+public:
+	SSimDownscale(PClip _child, int width, int height, float strength, int opt, int threads, IScriptEnvironment* env);
+	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
+	int __stdcall SetCacheHints(int cachehints, int frame_range);
+
+private:
+	void ProcessBand(const PVideoFrame& src, const PVideoFrame& dst, int top, int bottom, SSimBuffers& buffers);
+
+	VideoInfo viSrc;
+	SSimTaps m_TapsX;
+	SSimTaps m_TapsY;
+	SSimKernels m_Kernels;
+	float m_Strength;
+	int m_BandRows;
+	int m_Planes[3];
+	std::shared_ptr<ThreadPool> m_Threads;
+};
@@ -7,7 +7,7 @@ Shader::Shader(PClip _child, const char* _path, const char* _entryPoint, const c
 	GenericVideoFilter(_child), path(_path), entryPoint(_entryPoint), shaderModel(_shaderModel),
 	param1(_param0), param2(_param1), param3(_param2), param4(_param3), param5(_param4), param6(_param5), param7(_param6), param8(_param7), param9(_param8) {
 
-	ZeroMemory(&cmd, sizeof(CommandStruct));
+	memset(&cmd, 0, sizeof(CommandStruct));
 	cmd.Path = _path;
 	cmd.EntryPoint = _entryPoint;
 	cmd.ShaderModel = _shaderModel;
@@ -59,15 +59,8 @@ Shader::Shader(PClip _child, const char* _path, const char* _entryPoint, const c
 		for (int i = 0; i < 9; i++) {
 			ParamStruct* param = &cmd.Param[i];
 			if (param->String && param->String[0] != '\0') {
-				if (!ParseParam(param)) {
-					char* ErrorText = "Shader invalid parameter: Param%d = %s";
-					char* FullText;
-					int FullTextLength = strlen(ErrorText) - 3 + strlen(param->String) + 1;
-					FullText = (char*)malloc(FullTextLength);
-					sprintf_s(FullText, FullTextLength, ErrorText, i + 1, param->String);
-					env->ThrowError(FullText);
-					free(FullText);
-				}
+				if (!ParseParam(param))
+					env->ThrowError("Shader invalid parameter: Param%d = %s", i + 1, param->String);
 			}
 		}
 	}
@@ -191,7 +184,8 @@ D3DXMACRO* Shader::ParseDefines(const char* defines, IScriptEnvironment* env) {
 		strcpy((char*)Result[i].Definition, StrValue[1].c_str());
 		++i;
 	}
-	*(int*)&Result[i] = NULL;
+	Result[i].Name = NULL;
+	Result[i].Definition = NULL;
 	return Result;
 }
 
@@ -1,10 +1,8 @@
 #pragma once
-#include <windows.h>
-#include <d3d9.h>
-#include <d3dx9.h>
 #include <cstdio>		//needed by OutputDebugString()
+#include <cstring>
 #include "avisynth.h"
-#include "D3D9RenderImpl.h"
+#include "CommandStruct.h"
 #include <string>
 #include <sstream>
 #include <iterator>
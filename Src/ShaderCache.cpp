@@ -0,0 +1,229 @@
+#include "ShaderCache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include "D3D9Include.h"
+
+// FNV-1a
+static const uint64_t HASH_SEED = 14695981039346656037ULL;
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t length) {
+	const unsigned char* Bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ Bytes[i]) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+// Strings are hashed with their null terminator so that consecutive strings can't be confused.
+static uint64_t HashString(uint64_t hash, const char* text) {
+	return text ? HashBytes(hash, text, strlen(text) + 1) : HashBytes(hash, "", 1);
+}
+
+struct IncludedFile {
+	std::string Name;
+	uint64_t Hash;
+};
+
+struct CacheEntry {
+	ShaderCode Code;
+	std::vector<IncludedFile> Includes;
+};
+
+static const uint32_t CACHE_FILE_MAGIC = 0x43535341;	// "ASSC"
+static const uint32_t CACHE_FILE_VERSION = 1;
+
+static std::unordered_map<uint64_t, CacheEntry> s_Cache;
+static std::mutex s_Mutex;
+
+static bool ReadFileBytes(FILE* file, void* data, size_t length) {
+	return fread(data, 1, length, file) == length;
+}
+
+// Returns whether the files included when compiling the shader are still the same.
+static bool IncludesUnchanged(const std::vector<IncludedFile>& includes) {
+	for (auto const& item : includes) {
+		D3D9Include Include;
+		UINT Length = 0;
+		LPCVOID Data = Include.GetResource(item.Name, &Length, false);
+		uint64_t Hash = Data ? HashBytes(HASH_SEED, Data, Length) : 0;
+		Include.Close(Data);
+		if (Hash != item.Hash)
+			return false;
+	}
+	return true;
+}
+
+static std::string GetCacheFilePath(const char* cacheFolder, uint64_t key) {
+	char Name[32];
+	sprintf_s(Name, "%016llx.bin", (unsigned long long)key);
+	std::string Result = cacheFolder;
+	if (Result.back() != '\\' && Result.back() != '/')
+		Result += '\\';
+	return Result + Name;
+}
+
+// Reads a shader compiled by a previous run. Files that are truncated or from another version are ignored.
+static bool LoadCacheFile(const char* cacheFolder, uint64_t key, CacheEntry* outEntry) {
+	FILE* File = fopen(GetCacheFilePath(cacheFolder, key).c_str(), "rb");
+	if (!File)
+		return false;
+
+	bool Valid = false;
+	uint32_t Header[3];
+	if (ReadFileBytes(File, Header, sizeof(Header)) && Header[0] == CACHE_FILE_MAGIC && Header[1] == CACHE_FILE_VERSION) {
+		Valid = true;
+		for (uint32_t i = 0; i < Header[2] && Valid; i++) {
+			uint32_t Length = 0;
+			IncludedFile Item;
+			Valid = ReadFileBytes(File, &Length, sizeof(Length)) && Length < MAX_PATH;
+			if (Valid) {
+				Item.Name.resize(Length);
+				Valid = ReadFileBytes(File, &Item.Name[0], Length) && ReadFileBytes(File, &Item.Hash, sizeof(Item.Hash));
+				outEntry->Includes.push_back(Item);
+			}
+		}
+		uint32_t Words = 0;
+		Valid = Valid && ReadFileBytes(File, &Words, sizeof(Words)) && Words > 0 && Words < (1 << 20);
+		if (Valid) {
+			std::vector<DWORD> Code(Words);
+			Valid = ReadFileBytes(File, Code.data(), Words * sizeof(DWORD));
+			outEntry->Code = std::make_shared<const std::vector<DWORD>>(std::move(Code));
+		}
+	}
+	fclose(File);
+	return Valid;
+}
+
+// Failing to save only means that the next run compiles the shader again.
+static void SaveCacheFile(const char* cacheFolder, uint64_t key, const CacheEntry& entry) {
+	FILE* File = fopen(GetCacheFilePath(cacheFolder, key).c_str(), "wb");
+	if (!File)
+		return;
+	uint32_t Header[3] = { CACHE_FILE_MAGIC, CACHE_FILE_VERSION, (uint32_t)entry.Includes.size() };
+	fwrite(Header, sizeof(Header), 1, File);
+	for (auto const& item : entry.Includes) {
+		uint32_t Length = (uint32_t)item.Name.size();
+		fwrite(&Length, sizeof(Length), 1, File);
+		fwrite(item.Name.data(), 1, Length, File);
+		fwrite(&item.Hash, sizeof(item.Hash), 1, File);
+	}
+	uint32_t Words = (uint32_t)entry.Code->size();
+	fwrite(&Words, sizeof(Words), 1, File);
+	fwrite(entry.Code->data(), sizeof(DWORD), Words, File);
+	fclose(File);
+}
+
+HRESULT GetShaderCode(const CommandStruct* cmd, bool resource, const char* cacheFolder, ShaderCode* outCode) {
+	D3D9Include Include;
+	UINT SourceLength = 0;
+	LPCVOID Source = Include.GetResource(cmd->Path, &SourceLength, resource);
+	if (Source == nullptr)
+		return E_FAIL;
+
+	size_t PathLength = strlen(cmd->Path);
+	if (PathLength < 5 || strcmp(cmd->Path + PathLength - 5, ".hlsl") != 0) {
+		// Precompiled shader
+		*outCode = std::make_shared<const std::vector<DWORD>>((const DWORD*)Source, (const DWORD*)Source + SourceLength / sizeof(DWORD));
+		Include.Close(Source);
+		return S_OK;
+	}
+
+	uint64_t Key = HashBytes(HASH_SEED, Source, SourceLength);
+	if (cmd->Defines) {
+		for (const D3DXMACRO* item = cmd->Defines; item->Name; item++) {
+			Key = HashString(HashString(Key, item->Name), item->Definition);
+		}
+	}
+	Key = HashString(HashString(HashBytes(Key, "", 1), cmd->EntryPoint), cmd->ShaderModel);
+
+	// Compiling under the lock keeps engines asking for the same shader from compiling it each.
+	std::unique_lock<std::mutex> my_lock(s_Mutex);
+	auto Cached = s_Cache.find(Key);
+	if (Cached != s_Cache.end() && IncludesUnchanged(Cached->second.Includes)) {
+		*outCode = Cached->second.Code;
+		Include.Close(Source);
+		return S_OK;
+	}
+
+	CacheEntry Entry;
+	bool HasFolder = cacheFolder && cacheFolder[0] != '\0';
+	if (HasFolder && LoadCacheFile(cacheFolder, Key, &Entry) && IncludesUnchanged(Entry.Includes)) {
+		*outCode = Entry.Code;
+		s_Cache[Key] = Entry;
+		Include.Close(Source);
+		return S_OK;
+	}
+
+	CComPtr<ID3DXBuffer> Code;
+	HRESULT hr = D3DXCompileShader((LPCSTR)Source, SourceLength, cmd->Defines, &Include, cmd->EntryPoint, cmd->ShaderModel, 0, &Code, nullptr, nullptr);
+	Include.Close(Source);
+	if (FAILED(hr))
+		return hr;
+
+	const DWORD* Words = (const DWORD*)Code->GetBufferPointer();
+	Entry.Code = std::make_shared<const std::vector<DWORD>>(Words, Words + Code->GetBufferSize() / sizeof(DWORD));
+	Entry.Includes.clear();
+	for (auto const& item : Include.GetIncludedFiles()) {
+		D3D9Include Reader;
+		UINT Length = 0;
+		LPCVOID Data = Reader.GetResource(item, &Length, false);
+		Entry.Includes.push_back(IncludedFile{ item, Data ? HashBytes(HASH_SEED, Data, Length) : 0 });
+		Reader.Close(Data);
+	}
+	if (HasFolder)
+		SaveCacheFile(cacheFolder, Key, Entry);
+	*outCode = Entry.Code;
+	s_Cache[Key] = Entry;
+	return S_OK;
+}
+#else
+#include <sys/stat.h>
+
+// Precompiled shader read from a file, reused while the file keeps the same size and modification time.
+struct LoadedFile {
+	ShaderCode Code;
+	off_t Size;
+	time_t Modified;
+};
+
+static std::unordered_map<std::string, LoadedFile> s_Files;
+static std::mutex s_Mutex;
+
+// Without Direct3D, HLSL files can't be compiled; commands must point to precompiled shaders, read from their path.
+// There are no resources nor compiled shaders to cache.
+HRESULT GetShaderCode(const CommandStruct* cmd, bool /*resource*/, const char* /*cacheFolder*/, ShaderCode* outCode) {
+	size_t PathLength = strlen(cmd->Path);
+	if (PathLength >= 5 && strcmp(cmd->Path + PathLength - 5, ".hlsl") == 0)
+		return E_FAIL;
+
+	struct stat Info;
+	if (stat(cmd->Path, &Info) != 0)
+		return E_FAIL;
+
+	// Engines asking for the same shader read it once.
+	std::unique_lock<std::mutex> my_lock(s_Mutex);
+	auto Loaded = s_Files.find(cmd->Path);
+	if (Loaded != s_Files.end() && Loaded->second.Size == Info.st_size && Loaded->second.Modified == Info.st_mtime) {
+		*outCode = Loaded->second.Code;
+		return S_OK;
+	}
+
+	FILE* File = fopen(cmd->Path, "rb");
+	if (!File)
+		return E_FAIL;
+	std::vector<DWORD> Code(Info.st_size > 0 ? Info.st_size / sizeof(DWORD) : 0);
+	bool Valid = !Code.empty() && fread(Code.data(), sizeof(DWORD), Code.size(), File) == Code.size();
+	fclose(File);
+	if (!Valid)
+		return E_FAIL;
+	*outCode = std::make_shared<const std::vector<DWORD>>(std::move(Code));
+	s_Files[cmd->Path] = LoadedFile{ *outCode, Info.st_size, Info.st_mtime };
+	return S_OK;
+}
+#endif
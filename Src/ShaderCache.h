@@ -0,0 +1,17 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "CommandStruct.h"
+
+/* Compiled pixel shaders shared by all the engines and ExecuteShader instances of the process, so that each HLSL file
+   is compiled once no matter how many engines, filters and commands use it. Shaders are found by a hash of their
+   source code, Defines, EntryPoint and ShaderModel; files they include are checked for changes before reusing them.
+   Compiled shaders can also be kept in a folder so that following runs skip compiling. */
+
+// Bytecode of a pixel shader.
+typedef std::shared_ptr<const std::vector<DWORD>> ShaderCode;
+
+// Gets the bytecode of the shader of a command: .cso files as they are, HLSL files compiled with the Defines,
+// EntryPoint and ShaderModel of the command. resource: whether to only look in the DLL resources.
+// cacheFolder: Folder keeping compiled shaders between runs, or an empty string to only keep them in memory.
+HRESULT GetShaderCode(const CommandStruct* cmd, bool resource, const char* cacheFolder, ShaderCode* outCode);
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include "SuperResCpu.h"
+#include "CpuTexture.h"
+
+
+// ColourProcessing.hlsl, computed like the CPU engine's ports of the shaders.
+
+static const SuperResMatrix Rec709 = { 0.0722f, 0.2126f, true };
+
+static bool GetMatrix(const char* name, SuperResMatrix& m) {
+	std::string s(name);
+	std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (s == "rec709")
+		m = Rec709;
+	else if (s == "rec601")
+		m = SuperResMatrix{ 0.114f, 0.299f, true };
+	else if (s == "pc709")
+		m = SuperResMatrix{ 0.0722f, 0.2126f, false };
+	else if (s == "pc601")
+		m = SuperResMatrix{ 0.114f, 0.299f, false };
+	else
+		return false;
+	return true;
+}
+
+// Rec709 gamma curve
+static inline float Gamma(float x) { return x < 0.018f ? x * 4.506198600878514f : 1.099f * std::pow(x, 0.45f) - 0.099f; }
+static inline float GammaInv(float x) { return x < 0.018f * 4.506198600878514f ? x / 4.506198600878514f : std::pow((x + 0.099f) / 1.099f, 1 / 0.45f); }
+
+static inline float Dot(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static inline float Luma(const SuperResMatrix& m, const float* rgb) {
+	const float k[3] = { m.Kr, 1 - m.Kr - m.Kb, m.Kb };
+	return Dot(k, rgb);
+}
+
+static inline void ConvertToYUV(const SuperResMatrix& m, float* c) {
+	const float Kb = m.Kb, Kr = m.Kr;
+	const float midpoint = 0.5f + 0.5f / 255.0f;
+	const float y[3] = { Kr, 1 - Kr - Kb, Kb };
+	const float u[3] = { -Kr / (2 * (1 - Kb)), (Kr + Kb - 1) / (2 * (1 - Kb)), (1 - Kb) / (2 * (1 - Kb)) };
+	const float v[3] = { (1 - Kr) / (2 * (1 - Kr)), (Kr + Kb - 1) / (2 * (1 - Kr)), -Kb / (2 * (1 - Kr)) };
+	float yuv[3] = { Dot(y, c), Dot(u, c), Dot(v, c) };
+	if (!m.LimitedRange) {
+		c[0] = yuv[0];
+		c[1] = yuv[1] + midpoint;
+		c[2] = yuv[2] + midpoint;
+	}
+	else {
+		c[0] = yuv[0] * 219.0f / 255.0f + 16.0f / 255.0f;
+		c[1] = yuv[1] * 224.0f / 255.0f + midpoint;
+		c[2] = yuv[2] * 224.0f / 255.0f + midpoint;
+	}
+}
+
+static inline void ConvertToRGB(const SuperResMatrix& m, float* c) {
+	const float Kb = m.Kb, Kr = m.Kr;
+	const float midpoint = 0.5f + 0.5f / 255.0f;
+	float yuv[3];
+	if (!m.LimitedRange) {
+		yuv[0] = c[0];
+		yuv[1] = c[1] - midpoint;
+		yuv[2] = c[2] - midpoint;
+	}
+	else {
+		yuv[0] = (c[0] - 16.0f / 255.0f) * (255.0f / 219.0f);
+		yuv[1] = (c[1] - midpoint) * (255.0f / 224.0f);
+		yuv[2] = (c[2] - midpoint) * (255.0f / 224.0f);
+	}
+	const float r[3] = { 1, 0, 2 * (1 - Kr) };
+	const float g[3] = { (Kb + Kr - 1) / (Kb + Kr - 1), 2 * (1 - Kb) * Kb / (Kb + Kr - 1), 2 * Kr * (1 - Kr) / (Kb + Kr - 1) };
+	const float b[3] = { 1, 2 * (1 - Kb), 0 };
+	c[0] = Dot(r, yuv);
+	c[1] = Dot(g, yuv);
+	c[2] = Dot(b, yuv);
+}
+
+
+// Taps of SuperRes.hlsl along one axis, for an output of outSize pixels and an original of originalSize pixels.
+static void GetSuperResTaps(int outSize, int originalSize, std::vector<SuperResTaps>& taps) {
+	const float pi = std::acos(-1.0f);
+	const int Taps = 4;
+	const float dxdy = 1.0f / outSize;
+	const float ddxddy = 1.0f / originalSize;
+	// Offset of the softening taps: sqrt(ddxddy/dxdy)*dxdy
+	const float Soft = std::sqrt(ddxddy / dxdy) * dxdy;
+	auto texel = [](float u, int size) {
+		return std::min(std::max(CpuSampler::ToTexel(u, size), 0), size - 1);
+	};
+
+	taps.resize(outSize);
+	for (int i = 0; i < outSize; i++) {
+		const float tex = (i + 0.5f) * dxdy;
+		float pos = tex * originalSize - 0.5f;
+		const float offset = pos - std::floor(pos);
+		pos -= offset;
+		for (int X = -1; X <= 2; X++) {
+			taps[i].Kernel[X + 1] = std::cos(pi * (X - offset) / Taps);
+			taps[i].Diff[X + 1] = texel(ddxddy * (pos + X + 0.5f), originalSize);
+		}
+		for (int X = -1; X <= 1; X++)
+			taps[i].Soft[X + 1] = texel(tex + Soft * X, outSize);
+	}
+}
+
+
+struct SuperResBuffers {
+	std::vector<float> Downscaled[3];	// Output of SSimDownscalerX
+	std::vector<float> Diff[4];			// Output of SuperResDownscaleAndDiff
+};
+
+
+SuperResCpu::SuperResCpu(PClip _child, PClip original, float strength, float softness, bool finalPass, const char* matrixIn, const char* matrixOut, int threads, IScriptEnvironment* env) :
+	GenericVideoFilter(_child), m_Original(original), viSrc(vi), viOriginal(original->GetVideoInfo()),
+	m_Strength(strength), m_Softness(softness), m_FinalPass(finalPass) {
+
+	if (threads < 0)
+		env->ThrowError("SuperResCpu: threads must be 0 or greater.");
+
+	m_ConvertIn = matrixIn[0] != 0;
+	m_ConvertOut = finalPass && matrixOut[0] != 0;
+	if (m_ConvertIn && !GetMatrix(matrixIn, m_MatrixIn))
+		env->ThrowError("SuperResCpu: MatrixIn must be Rec601, Rec709, Pc601 or Pc709");
+	if (m_ConvertOut && !GetMatrix(matrixOut, m_MatrixOut))
+		env->ThrowError("SuperResCpu: MatrixOut must be Rec601, Rec709, Pc601 or Pc709");
+	// Like the compiled shaders: SuperResDownscaleAndDiff takes the luma of MatrixIn, and SuperRes the luma of
+	// MatrixOut in the final pass only.
+	m_LumaIn = m_ConvertIn ? m_MatrixIn : Rec709;
+	m_LumaOut = m_ConvertOut ? m_MatrixOut : Rec709;
+
+	const int planesRGB[3] = { PLANAR_R, PLANAR_G, PLANAR_B };
+	const int planesYUV[3] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+	for (int c = 0; c < 3; c++) {
+		m_OriginalPlanes[c] = m_ConvertIn ? planesYUV[c] : planesRGB[c];
+		m_DstPlanes[c] = m_ConvertOut ? planesYUV[c] : planesRGB[c];
+	}
+	if (m_ConvertOut)
+		vi.pixel_type = VideoInfo::CS_YUV444PS;
+
+	GetSSimTaps(viSrc.width, viOriginal.width, m_DownscaleX);
+	GetSSimTaps(viSrc.height, viOriginal.height, m_DownscaleY);
+	GetSuperResTaps(vi.width, viOriginal.width, m_TapsX);
+	GetSuperResTaps(vi.height, viOriginal.height, m_TapsY);
+
+	// Instances using all cores share one pool instead of each starting a thread per core.
+	m_Threads = threads > 0 ? std::make_shared<ThreadPool>(threads) : ThreadPool::GetShared();
+
+	// Each band recomputes the rows of the difference image that its 4x4 windows share with the next band,
+	// so keep bands tall enough for that to be cheap while leaving a few bands to each thread.
+	m_BandRows = std::min(std::max(vi.height / (m_Threads->GetThreadCount() * 4), 16), 64);
+}
+
+PVideoFrame __stdcall SuperResCpu::GetFrame(int n, IScriptEnvironment* env) {
+	PVideoFrame src = child->GetFrame(n, env);
+	PVideoFrame original = m_Original->GetFrame(n, env);
+	PVideoFrame dst = env->NewVideoFrame(vi);
+
+	const int bands = (vi.height + m_BandRows - 1) / m_BandRows;
+	m_Threads->ParallelFor(bands, 1, [&](int first, int last) {
+		SuperResBuffers buffers;
+		for (int i = first; i < last; i++)
+			ProcessBand(src, original, dst, i * m_BandRows, std::min((i + 1) * m_BandRows, vi.height), buffers);
+	});
+	return dst;
+}
+
+// Runs SuperResPass for output rows [top, bottom), computing only the rows of the downscaled and difference
+// images that their 4x4 windows read.
+void SuperResCpu::ProcessBand(const PVideoFrame& src, const PVideoFrame& original, const PVideoFrame& dst, int top, int bottom, SuperResBuffers& b) {
+	const int width = vi.width, w = viOriginal.width;
+	const int srcPlanes[3] = { PLANAR_R, PLANAR_G, PLANAR_B };
+	const float* srcp[3];
+	int spitch[3];
+	for (int c = 0; c < 3; c++) {
+		srcp[c] = reinterpret_cast<const float*>(src->GetReadPtr(srcPlanes[c]));
+		spitch[c] = src->GetPitch(srcPlanes[c]) / sizeof(float);
+	}
+
+	int dTop = viOriginal.height, dBottom = 0;
+	for (int y = top; y < bottom; y++) {
+		for (int i = 0; i < 4; i++) {
+			dTop = std::min(dTop, m_TapsY[y].Diff[i]);
+			dBottom = std::max(dBottom, m_TapsY[y].Diff[i] + 1);
+		}
+	}
+	int aTop = viSrc.height, aBottom = 0;
+	for (int k = m_DownscaleY.Start[dTop]; k < m_DownscaleY.Start[dBottom]; k++) {
+		aTop = std::min(aTop, m_DownscaleY.Index[k]);
+		aBottom = std::max(aBottom, m_DownscaleY.Index[k] + 1);
+	}
+
+	// SSimDownscalerX
+	for (int c = 0; c < 3; c++) {
+		b.Downscaled[c].resize((size_t)w * (aBottom - aTop));
+		for (int y = aTop; y < aBottom; y++) {
+			const float* s = srcp[c] + (size_t)y * spitch[c];
+			float* d = b.Downscaled[c].data() + (size_t)(y - aTop) * w;
+			for (int x = 0; x < w; x++) {
+				float avg = 0;
+				for (int k = m_DownscaleX.Start[x]; k < m_DownscaleX.Start[x + 1]; k++)
+					avg += m_DownscaleX.Weight[k] * s[m_DownscaleX.Index[k]];
+				d[x] = avg;
+			}
+		}
+	}
+
+	// SuperResDownscaleAndDiff: difference with the original in gamma light, and luma of the downscaled image.
+	for (int c = 0; c < 4; c++)
+		b.Diff[c].resize((size_t)w * (dBottom - dTop));
+	for (int y = dTop; y < dBottom; y++) {
+		const int first = m_DownscaleY.Start[y], last = m_DownscaleY.Start[y + 1];
+		const float* o[3];
+		float* d[4];
+		for (int c = 0; c < 3; c++)
+			o[c] = reinterpret_cast<const float*>(original->GetReadPtr(m_OriginalPlanes[c]) + (size_t)y * original->GetPitch(m_OriginalPlanes[c]));
+		for (int c = 0; c < 4; c++)
+			d[c] = b.Diff[c].data() + (size_t)(y - dTop) * w;
+
+		for (int x = 0; x < w; x++) {
+			float g[3], rgb[3];
+			for (int c = 0; c < 3; c++) {
+				float avg = 0;
+				for (int k = first; k < last; k++)
+					avg += m_DownscaleY.Weight[k] * b.Downscaled[c][(size_t)(m_DownscaleY.Index[k] - aTop) * w + x];
+				g[c] = Gamma(avg);
+				rgb[c] = o[c][x];
+			}
+			if (m_ConvertIn)
+				ConvertToRGB(m_MatrixIn, rgb);
+			for (int c = 0; c < 3; c++)
+				d[c][x] = g[c] - rgb[c];
+			d[3][x] = Luma(m_LumaIn, g);
+		}
+	}
+
+	// SuperRes
+	const float acuity = 6.0f;
+	const float softAcuity = 6.0f;
+	const float radius = 0.5f;
+	const bool soften = !m_FinalPass && m_Softness != 0;
+	for (int y = top; y < bottom; y++) {
+		const SuperResTaps& ty = m_TapsY[y];
+		const float* diffRow[4][4];
+		const float* softRow[3][3];
+		float* out[3];
+		for (int c = 0; c < 4; c++) {
+			for (int Y = 0; Y < 4; Y++)
+				diffRow[c][Y] = b.Diff[c].data() + (size_t)(ty.Diff[Y] - dTop) * w;
+		}
+		for (int c = 0; c < 3; c++) {
+			for (int Y = 0; Y < 3; Y++)
+				softRow[c][Y] = srcp[c] + (size_t)ty.Soft[Y] * spitch[c];
+			out[c] = reinterpret_cast<float*>(dst->GetWritePtr(m_DstPlanes[c]) + (size_t)y * dst->GetPitch(m_DstPlanes[c]));
+		}
+
+		for (int x = 0; x < width; x++) {
+			const SuperResTaps& tx = m_TapsX[x];
+			float Lin[3], c0[3];
+			for (int c = 0; c < 3; c++) {
+				Lin[c] = srcp[c][(size_t)y * spitch[c] + x];
+				c0[c] = Gamma(Lin[c]);
+			}
+
+			// Calculate faithfulness force
+			float weightSum = 0;
+			float diff[3] = { 0, 0, 0 };
+			const float luma = Luma(m_LumaOut, c0);
+			for (int X = 0; X < 4; X++) {
+				const int dx = tx.Diff[X];
+				for (int Y = 0; Y < 4; Y++) {
+					const float dI = acuity * (luma - diffRow[3][Y][dx]);
+					const float dI2 = dI * dI;
+					const float weight = tx.Kernel[X] * ty.Kernel[Y] / (1 + dI2);
+					for (int c = 0; c < 3; c++)
+						diff[c] = diff[c] + weight * diffRow[c][Y][dx];
+					weightSum += weight;
+				}
+			}
+			for (int c = 0; c < 3; c++)
+				c0[c] = c0[c] - m_Strength * (diff[c] / weightSum);
+
+			if (!m_FinalPass) {
+				// Convert back to linear light
+				for (int c = 0; c < 3; c++)
+					c0[c] = GammaInv(c0[c]);
+
+				if (soften) {
+					weightSum = 0;
+					float soft[3] = { 0, 0, 0 };
+					for (int X = -1; X <= 1; X++) {
+						for (int Y = -1; Y <= 1; Y++) {
+							if (X != 0 || Y != 0) {
+								const int sx = tx.Soft[X + 1];
+								float dI[3];
+								for (int c = 0; c < 3; c++)
+									dI[c] = softRow[c][Y + 1][sx] - Lin[c];
+								const float dI2 = softAcuity * softAcuity * Dot(dI, dI);
+								const float dXY2 = (X * X + Y * Y) / (radius * radius);
+								const float r = 1 / std::sqrt(dXY2 + dI2);
+								const float weight = r * r * r; // Fundamental solution to the 5d Laplace equation
+
+								for (int c = 0; c < 3; c++)
+									soft[c] = soft[c] + weight * dI[c];
+								weightSum += weight;
+							}
+						}
+					}
+					for (int c = 0; c < 3; c++)
+						c0[c] = c0[c] + m_Softness * (soft[c] / weightSum);
+				}
+			}
+			else if (m_ConvertOut) {
+				// Tweak: Convert back to YUV.
+				ConvertToYUV(m_MatrixOut, c0);
+			}
+
+			for (int c = 0; c < 3; c++)
+				out[c][x] = c0[c];
+		}
+	}
+}
+
+int __stdcall SuperResCpu::SetCacheHints(int cachehints, int frame_range) {
+	return cachehints == CachePolicyHint::CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include "Platform.h"
+#include "avisynth.h"
+#include "ThreadPool.h"
+#include "SSimDownscale.h"
+
+/* Native version of one SuperResPass of Shader.avsi: SSimDownscalerX, SuperResDownscaleAndDiff and SuperRes.
+   Works on planar 32-bit float clips, one band of output rows per thread. Each band downscales the rows of the
+   current image it needs, computes the rows of the difference with the original it needs, and corrects its
+   rows, so the current image is read once and the downscaled and difference images never exist at full size. */
+
+// Colour matrix of ColourProcessing.hlsl.
+struct SuperResMatrix {
+	float Kb, Kr;
+	bool LimitedRange;
+};
+
+// Pixels of the difference image read by the 4x4 window of SuperRes.hlsl around one output coordinate, with
+// the Hann kernel of each tap, and the pixels of the current image read by the softening.
+struct SuperResTaps {
+	int Diff[4];
+	float Kernel[4];
+	int Soft[3];
+};
+
+struct SuperResBuffers;
+
+
+class SuperResCpu : public GenericVideoFilter {
+public:
+	SuperResCpu(PClip _child, PClip original, float strength, float softness, bool finalPass, const char* matrixIn, const char* matrixOut, int threads, IScriptEnvironment* env);
+	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
+	int __stdcall SetCacheHints(int cachehints, int frame_range);
+
+private:
+	void ProcessBand(const PVideoFrame& src, const PVideoFrame& original, const PVideoFrame& dst, int top, int bottom, SuperResBuffers& b);
+
+	PClip m_Original;
+	VideoInfo viSrc;
+	VideoInfo viOriginal;
+	SSimTaps m_DownscaleX;
+	SSimTaps m_DownscaleY;
+	std::vector<SuperResTaps> m_TapsX;
+	std::vector<SuperResTaps> m_TapsY;
+	SuperResMatrix m_LumaIn;	// Luma of the difference image
+	SuperResMatrix m_LumaOut;	// Luma compared with it in SuperRes.hlsl
+	SuperResMatrix m_MatrixIn;
+	SuperResMatrix m_MatrixOut;
+	bool m_ConvertIn;
+	bool m_ConvertOut;
+	float m_Strength;
+	float m_Softness;
+	bool m_FinalPass;
+	int m_BandRows;
+	int m_OriginalPlanes[3];
+	int m_DstPlanes[3];
+	std::shared_ptr<ThreadPool> m_Threads;
+};
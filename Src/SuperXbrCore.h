@@ -0,0 +1,94 @@
+#pragma once
+#include <cmath>
+#include "Platform.h"
+
+/* Math of SuperXbr.hlsl for one pixel, shared by the C++ and AVX2 kernels of SuperXbrCpu.
+   V is float for the C++ kernels and a vector of 8 floats for the AVX2 kernels; it needs +, -, * with both V
+   and float operands, V / float and the xbr_* functions below. Terms whose weight is 0 in a pass are skipped,
+   which doesn't change the result for finite samples. */
+
+static inline float xbr_abs(float x) { return std::abs(x); }
+static inline float xbr_min(float a, float b) { return a < b ? a : b; }
+static inline float xbr_max(float a, float b) { return a > b ? a : b; }
+static inline float xbr_step0(float x) { return x >= 0.0f ? 1.0f : 0.0f; }
+static inline float xbr_saturate(float x) { return xbr_min(xbr_max(x, 0.0f), 1.0f); }
+
+template <typename V>
+static __forceinline V xbr_lerp(const V& a, const V& b, const V& t) {
+	return a + t * (b - a);
+}
+
+// get(x, y, c) returns channel c of Get(x, y) in SuperXbr.hlsl. Writes the 3 channels of the pixel to out,
+// clamped to [0, 1] like the 16-bit textures of the shader version.
+template <int Pass, typename V, typename Get>
+static __forceinline void super_xbr_pixel(Get get, float edgeStrength, float xbrWeight, V* out) {
+	const float wp1 = 1.0f;
+	const float wp4 = Pass == 0 ? 2.0f : Pass == 1 ? 4.0f : 0.0f;
+	const float wp5 = Pass == 1 ? 0.0f : -1.0f;
+	const float weight1 = Pass == 1 ? xbrWeight * 1.75068f / 10.0f : xbrWeight * 1.29633f / 10.0f;
+	const float weight2 = Pass == 1 ? xbrWeight * 1.29633f / 10.0f / 2.0f : xbrWeight * 1.75068f / 10.0f / 2.0f;
+
+	enum { P0, P1, P2, P3, B, C, D, E, F, G, H, I, F4, I4, H5, I5 };
+	static const int offsets[16][2] = {
+		{ -1, -1 }, { 2, -1 }, { -1, 2 }, { 2, 2 },
+		{ 0, -1 }, { 1, -1 }, { -1, 0 }, { 0, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 },
+		{ 2, 0 }, { 2, 1 }, { 0, 2 }, { 1, 2 } };
+
+	V s[16][3];
+	V y[16];
+	for (int k = 0; k < 16; k++) {
+		for (int c = 0; c < 3; c++)
+			s[k][c] = get(offsets[k][0], offsets[k][1], c);
+		y[k] = .2126f * s[k][0] + .7152f * s[k][1] + .0722f * s[k][2];
+	}
+
+	// Calc edgeness in diagonal directions: d_wd(d, b, g, e, c, p2, h, f, p1, h5, i, f4, i5, i4) - d_wd(c, f4, b, f, i4, p0, e, i, p3, d, h, i5, g, h5)
+	V d1 = wp1 * (xbr_abs(y[E] - y[C]) + xbr_abs(y[E] - y[G]) + xbr_abs(y[I] - y[H5]) + xbr_abs(y[I] - y[F4]));
+	V d2 = wp1 * (xbr_abs(y[F] - y[I4]) + xbr_abs(y[F] - y[B]) + xbr_abs(y[H] - y[D]) + xbr_abs(y[H] - y[I5]));
+	if (wp4 != 0) {
+		d1 = d1 + wp4 * xbr_abs(y[H] - y[F]);
+		d2 = d2 + wp4 * xbr_abs(y[E] - y[I]);
+	}
+	if (wp5 != 0) {
+		d1 = d1 + wp5 * (xbr_abs(y[G] - y[C]) + xbr_abs(y[H5] - y[F4]));
+		d2 = d2 + wp5 * (xbr_abs(y[B] - y[I4]) + xbr_abs(y[D] - y[I5]));
+	}
+	const V d_edge = d1 - d2;
+
+	// Calc edgeness in horizontal/vertical directions: hv_wd(f, i, e, h, c, i5, b, h5) - hv_wd(e, f, h, i, d, f4, g, i4)
+	V h1 = wp1 * (xbr_abs(y[F] - y[C]) + xbr_abs(y[I] - y[I5]) + xbr_abs(y[E] - y[B]) + xbr_abs(y[H] - y[H5]));
+	V h2 = wp1 * (xbr_abs(y[E] - y[D]) + xbr_abs(y[F] - y[F4]) + xbr_abs(y[H] - y[G]) + xbr_abs(y[I] - y[I4]));
+	if (wp4 != 0) {
+		h1 = wp4 * (xbr_abs(y[F] - y[I]) + xbr_abs(y[E] - y[H])) + h1;
+		h2 = wp4 * (xbr_abs(y[E] - y[F]) + xbr_abs(y[H] - y[I])) + h2;
+	}
+	const V hv_edge = h1 - h2;
+
+	const float w1a = -weight1, w1b = weight1 + 0.5f;
+	const float w2a = -weight2, w2b = weight2 + 0.25f;
+	const float limits = edgeStrength + 0.000001f;
+	const V t = xbr_saturate(xbr_abs(d_edge) / limits);
+	const V edge = t * t * (3.0f - 2.0f * t);
+	const V sd = xbr_step0(d_edge);
+	const V sh = xbr_step0(hv_edge);
+	const V blend = 1.0f - edge;
+
+	for (int c = 0; c < 3; c++) {
+		// Filtering and normalization in four direction generating four colors.
+		const V c1 = w1a * s[P2][c] + w1b * s[H][c] + w1b * s[F][c] + w1a * s[P1][c];
+		const V c2 = w1a * s[P0][c] + w1b * s[E][c] + w1b * s[I][c] + w1a * s[P3][c];
+		const V c3 = (w2a * s[D][c] + w2b * s[E][c] + w2b * s[F][c] + w2a * s[F4][c]) + (w2a * s[G][c] + w2b * s[H][c] + w2b * s[I][c] + w2a * s[I4][c]);
+		const V c4 = (w2a * s[C][c] + w2b * s[F][c] + w2b * s[I][c] + w2a * s[I5][c]) + (w2a * s[B][c] + w2b * s[E][c] + w2b * s[H][c] + w2a * s[H5][c]);
+
+		// Smoothly blends the two strongest directions (one in diagonal and the other in vert/horiz direction).
+		V color = xbr_lerp(xbr_lerp(c1, c2, sd), xbr_lerp(c3, c4, sh), blend);
+
+		// Anti-ringing code.
+		const V ring = xbr_lerp((s[P2][c] - s[H][c]) * (s[F][c] - s[P1][c]), (s[P0][c] - s[E][c]) * (s[I][c] - s[P3][c]), sd);
+		const V lo = xbr_min(s[E][c], xbr_min(s[F][c], xbr_min(s[H][c], s[I][c]))) + ring;
+		const V hi = xbr_max(s[E][c], xbr_max(s[F][c], xbr_max(s[H][c], s[I][c]))) - ring;
+		color = xbr_min(xbr_max(color, lo), hi);
+
+		out[c] = xbr_saturate(color);
+	}
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include "SuperXbrCpu.h"
+#include "SuperXbrCore.h"
+
+extern bool has_avx2() noexcept;
+
+// Rows of each band are sized so that the outputs of pass 0 and pass 1 of the last step stay in the L2 cache.
+const int XBR_BAND_BYTES = 2 * 1024 * 1024;
+
+
+// C++ kernels
+
+static void super_xbr_pass0_c(const SuperXbrRows& in, int width, bool odd, float edgeStrength, float weight, float* const* out) {
+	for (int x = 0; x < width; x++) {
+		float v[3];
+		if (odd)
+			super_xbr_pixel<0, float>([&](int dx, int dy, int c) { return in.Row[c][1 + dy][x + dx]; }, edgeStrength, weight, v);
+		for (int c = 0; c < 3; c++) {
+			// Skip pixels on wrong grid
+			out[c][2 * x] = in.Row[c][1][x];
+			out[c][2 * x + 1] = odd ? v[c] : in.Row[c][1][x];
+		}
+	}
+}
+
+static void super_xbr_pass1_c(const SuperXbrRows& in, int width, int y, float edgeStrength, float weight, float* const* out) {
+	for (int x = 0; x < width; x++) {
+		if (((x + y) & 1) == 0) {
+			for (int c = 0; c < 3; c++)
+				out[c][x] = in.Row[c][3][x];
+			continue;
+		}
+		float v[3];
+		super_xbr_pixel<1, float>([&](int dx, int dy, int c) { return in.Row[c][3 + dy - dx][x + dx + dy - 1]; }, edgeStrength, weight, v);
+		for (int c = 0; c < 3; c++)
+			out[c][x] = v[c];
+	}
+}
+
+static void super_xbr_pass2_c(const SuperXbrRows& in, int width, float edgeStrength, float weight, float* const* out) {
+	for (int x = 0; x < width; x++) {
+		float v[3];
+		super_xbr_pixel<2, float>([&](int dx, int dy, int c) { return in.Row[c][2 - dy][x - dx]; }, edgeStrength, weight, v);
+		for (int c = 0; c < 3; c++)
+			out[c][x] = v[c];
+	}
+}
+
+SuperXbrKernels get_super_xbr_kernels_c() {
+	return SuperXbrKernels{ super_xbr_pass0_c, super_xbr_pass1_c, super_xbr_pass2_c };
+}
+
+
+// Rows [Top, Top + rows) of the 3 planes of one image, with 16 floats of margin on each side.
+struct SuperXbrImage {
+	void Resize(int width, int top, int rows) {
+		Width = width;
+		Top = top;
+		Pitch = ((width + 15) & ~15) + 32;
+		PlaneSize = (size_t)Pitch * rows;
+		if (Data.size() < PlaneSize * 3)
+			Data.resize(PlaneSize * 3, 0.0f);
+	}
+	float* Row(int plane, int y) { return Data.data() + plane * PlaneSize + 16 + (size_t)(y - Top) * Pitch; }
+
+	// Repeats the edge pixels into the margin read by the kernels.
+	void ExtendRow(int y) {
+		for (int c = 0; c < 3; c++) {
+			float* p = Row(c, y);
+			for (int k = 1; k <= 3; k++) {
+				p[-k] = p[0];
+				p[Width - 1 + k] = p[Width - 1];
+			}
+		}
+	}
+
+	std::vector<float> Data;
+	size_t PlaneSize = 0;
+	int Width = 0;
+	int Top = 0;
+	int Pitch = 0;
+};
+
+struct SuperXbrBuffers {
+	struct Level {
+		SuperXbrImage In, P0, P1;
+	};
+	std::vector<Level> Levels;
+};
+
+static const int SuperXbrPlanes[3] = { PLANAR_R, PLANAR_G, PLANAR_B };
+
+
+SuperXbrCpu::SuperXbrCpu(PClip _child, float edgeStrength, float weight, int factor, int opt, int threads, IScriptEnvironment* env) :
+	GenericVideoFilter(_child), viSrc(vi), m_EdgeStrength(edgeStrength), m_Weight(weight), m_Steps(0) {
+
+	if (threads < 0)
+		env->ThrowError("SuperXbrCpu: threads must be 0 or greater.");
+
+	while ((2 << m_Steps) <= factor)
+		m_Steps++;
+	vi.width = viSrc.width * factor;
+	vi.height = viSrc.height * factor;
+	m_Kernels = opt != 0 && has_avx2() ? get_super_xbr_kernels_avx2() : get_super_xbr_kernels_c();
+	// Instances using all cores share one pool instead of each starting a thread per core.
+	m_Threads = threads > 0 ? std::make_shared<ThreadPool>(threads) : ThreadPool::GetShared();
+
+	const int rowBytes = vi.width * 3 * sizeof(float);
+	m_BandRows = std::min(std::max(XBR_BAND_BYTES / (2 * rowBytes), 16), 64);
+}
+
+PVideoFrame __stdcall SuperXbrCpu::GetFrame(int n, IScriptEnvironment* env) {
+	PVideoFrame src = child->GetFrame(n, env);
+	PVideoFrame dst = env->NewVideoFrame(vi);
+
+	const int bands = (vi.height + m_BandRows - 1) / m_BandRows;
+	m_Threads->ParallelFor(bands, 1, [&](int first, int last) {
+		SuperXbrBuffers buffers;
+		buffers.Levels.resize(m_Steps);
+		for (int i = first; i < last; i++)
+			Step(m_Steps - 1, i * m_BandRows, std::min((i + 1) * m_BandRows, vi.height), src, dst, buffers);
+	});
+	return dst;
+}
+
+// Fills the input of step with rows [top, bottom), either from the source frame or by running the previous step.
+void SuperXbrCpu::FillInput(int step, int top, int bottom, const PVideoFrame& src, const PVideoFrame& dst, SuperXbrBuffers& b) {
+	if (step > 0) {
+		Step(step - 1, top, bottom, src, dst, b);
+		return;
+	}
+
+	// Values are clamped like when the clip is uploaded into a 16-bit texture.
+	SuperXbrImage& in = b.Levels[0].In;
+	in.Resize(viSrc.width, top, bottom - top);
+	for (int c = 0; c < 3; c++) {
+		const int pitch = src->GetPitch(SuperXbrPlanes[c]);
+		const BYTE* srcp = src->GetReadPtr(SuperXbrPlanes[c]);
+		for (int y = top; y < bottom; y++) {
+			const float* s = reinterpret_cast<const float*>(srcp + (size_t)y * pitch);
+			float* d = in.Row(c, y);
+			for (int x = 0; x < viSrc.width; x++)
+				d[x] = xbr_saturate(s[x]);
+		}
+	}
+	for (int y = top; y < bottom; y++)
+		in.ExtendRow(y);
+}
+
+// Computes rows [top, bottom) of the output of step, into the output frame for the last step and into the input
+// of the next step otherwise. Each pass needs a few rows more than the next one, clamped to the image.
+void SuperXbrCpu::Step(int step, int top, int bottom, const PVideoFrame& src, const PVideoFrame& dst, SuperXbrBuffers& b) {
+	const SuperXbrKernels& k = m_Kernels;
+	const int inWidth = viSrc.width << step, inHeight = viSrc.height << step;
+	const int width = inWidth * 2, height = inHeight * 2;
+	auto clampRow = [](int y, int size) { return std::min(std::max(y, 0), size - 1); };
+
+	const int p1Top = std::max(top - 2, 0), p1Bottom = std::min(bottom + 1, height);
+	const int p0Top = std::max(p1Top - 3, 0), p0Bottom = std::min(p1Bottom + 3, height);
+	const int inTop = std::max((p0Top >> 1) - 1, 0), inBottom = std::min(((p0Bottom - 1) >> 1) + 3, inHeight);
+
+	FillInput(step, inTop, inBottom, src, dst, b);
+	SuperXbrBuffers::Level& level = b.Levels[step];
+	level.P0.Resize(width, p0Top, p0Bottom - p0Top);
+	level.P1.Resize(width, p1Top, p1Bottom - p1Top);
+
+	SuperXbrRows rows;
+	float* out[3];
+	for (int y = p0Top; y < p0Bottom; y++) {
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 4; r++)
+				rows.Row[c][r] = level.In.Row(c, clampRow((y >> 1) - 1 + r, inHeight));
+			out[c] = level.P0.Row(c, y);
+		}
+		k.Pass0(rows, inWidth, (y & 1) != 0, m_EdgeStrength, m_Weight, out);
+		level.P0.ExtendRow(y);
+	}
+
+	for (int y = p1Top; y < p1Bottom; y++) {
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 7; r++)
+				rows.Row[c][r] = level.P0.Row(c, clampRow(y - 3 + r, height));
+			out[c] = level.P1.Row(c, y);
+		}
+		k.Pass1(rows, width, y, m_EdgeStrength, m_Weight, out);
+		level.P1.ExtendRow(y);
+	}
+
+	SuperXbrImage* next = step + 1 < m_Steps ? &b.Levels[step + 1].In : nullptr;
+	if (next)
+		next->Resize(width, top, bottom - top);
+	for (int y = top; y < bottom; y++) {
+		for (int c = 0; c < 3; c++) {
+			for (int r = 0; r < 4; r++)
+				rows.Row[c][r] = level.P1.Row(c, clampRow(y - 2 + r, height));
+			out[c] = next ? next->Row(c, y)
+				: reinterpret_cast<float*>(dst->GetWritePtr(SuperXbrPlanes[c]) + (size_t)y * dst->GetPitch(SuperXbrPlanes[c]));
+		}
+		k.Pass2(rows, width, m_EdgeStrength, m_Weight, out);
+		if (next)
+			next->ExtendRow(y);
+	}
+}
+
+int __stdcall SuperXbrCpu::SetCacheHints(int cachehints, int frame_range) {
+	return cachehints == CachePolicyHint::CACHE_GET_MTMODE ? MT_NICE_FILTER : 0;
+}
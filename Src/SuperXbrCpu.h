@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include "Platform.h"
+#include "avisynth.h"
+#include "ThreadPool.h"
+
+/* Native version of SuperXbrMulti in Shader.avsi: runs the 3 passes of SuperXbr.hlsl once per doubling of the size.
+   Works on planar 32-bit float RGB clips, one band of output rows per thread. Each band runs the 3 passes of every
+   step over the rows it needs plus a few rows of margin, so the passes of a step follow each other while their
+   rows are in the cache, and the intermediate images of Factor 4, 8 and 16 never exist at full size. */
+
+// Rows of the 3 planes around the row being computed. Row[p][k] is row y - Center + k of plane p, clamped to the image;
+// Center is 1 for pass 0 (y being the input row), 3 for pass 1 and 2 for pass 2.
+// Rows hold at least 3 pixels of margin on each side that repeat the edge pixel.
+struct SuperXbrRows {
+	const float* Row[3][7];
+};
+
+struct SuperXbrKernels {
+	// Writes a row of the output of pass 0, twice as wide as the input. odd is set for rows 2y + 1.
+	void(*Pass0)(const SuperXbrRows& in, int width, bool odd, float edgeStrength, float weight, float* const* out);
+	// Writes row y of the output of pass 1.
+	void(*Pass1)(const SuperXbrRows& in, int width, int y, float edgeStrength, float weight, float* const* out);
+	// Writes a row of the output of pass 2. out may be a row of the output frame, which has no margin.
+	void(*Pass2)(const SuperXbrRows& in, int width, float edgeStrength, float weight, float* const* out);
+};
+
+SuperXbrKernels get_super_xbr_kernels_c();
+SuperXbrKernels get_super_xbr_kernels_avx2();
+
+struct SuperXbrBuffers;
+
+
+class SuperXbrCpu : public GenericVideoFilter {
+public:
+	SuperXbrCpu(PClip _child, float edgeStrength, float weight, int factor, int opt, int threads, IScriptEnvironment* env);
+	PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env);
+	int __stdcall SetCacheHints(int cachehints, int frame_range);
+
+private:
+	void FillInput(int step, int top, int bottom, const PVideoFrame& src, const PVideoFrame& dst, SuperXbrBuffers& b);
+	void Step(int step, int top, int bottom, const PVideoFrame& src, const PVideoFrame& dst, SuperXbrBuffers& b);
+
+	VideoInfo viSrc;
+	SuperXbrKernels m_Kernels;
+	float m_EdgeStrength;
+	float m_Weight;
+	int m_Steps;
+	int m_BandRows;
+	std::shared_ptr<ThreadPool> m_Threads;
+};
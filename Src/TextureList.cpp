@@ -1,4 +1,3 @@
-#pragma once
 #include "TextureList.h"
 
 // Only one texture per ClipIndex should be kept in the list.
@@ -10,28 +9,22 @@ InputTexture* __stdcall FindTexture(std::vector<InputTexture*>* textureList, int
 	return nullptr;
 }
 
-HRESULT __stdcall ReleaseTexture(InputTexture* obj) {
+#ifdef _WIN32
+HRESULT __stdcall ReleaseTextureMemory(InputTexture* obj) {
 	HR(obj->Pool->Release(obj->Surface));
 	HR(obj->Pool->Release(obj->Memory));
 	HR(obj->Pool->Release(obj->SurfaceY));
 	HR(obj->Pool->Release(obj->SurfaceU));
 	HR(obj->Pool->Release(obj->SurfaceV));
-	delete obj;
 	return S_OK;
 }
 
-HRESULT __stdcall RemoveTexture(std::vector<InputTexture*>* textureList, InputTexture* item) {
-	textureList->erase(std::remove(textureList->begin(), textureList->end(), item), textureList->end());
-	HR(ReleaseTexture(item));
-	return S_OK;
-}
-
-HRESULT __stdcall ClearTextures(MemoryPool* pool, std::vector<InputTexture*>* textureList) {
-	for (auto const& item : *textureList) {
-		if (item->Pool == pool)
-			HR(ReleaseTexture(item));
-	}
-	textureList->clear();
+HRESULT __stdcall ReserveTextureMemory(InputTexture* obj) {
+	HR(obj->Pool->Reserve(obj->Surface));
+	HR(obj->Pool->Reserve(obj->Memory));
+	HR(obj->Pool->Reserve(obj->SurfaceY));
+	HR(obj->Pool->Reserve(obj->SurfaceU));
+	HR(obj->Pool->Reserve(obj->SurfaceV));
 	return S_OK;
 }
 
@@ -58,6 +51,7 @@ D3DFORMAT __stdcall GetD3DFormat(int precision, bool planar) {
 	else
 		return D3DFMT_UNKNOWN;
 }
+#endif
 
 int __stdcall GetD3DFormatSize(int precision, bool planar) {
 	if (precision == 0)
@@ -98,7 +92,8 @@ int __stdcall AdjustPrecision(IScriptEnvironment* env, int precision) {
 	return 0;
 }
 
-HRESULT __stdcall CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst, IScriptEnvironment* env) {
+#ifdef _WIN32
+HRESULT __stdcall CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) {
 	// Copies source frame into main surface buffer, or into additional input textures
 	RECT SrcRect;
 	SrcRect.top = 0;
@@ -109,7 +104,7 @@ HRESULT __stdcall CopyAviSynthToBuffer(const byte* src, int srcPitch, int clipPr
 	return S_OK;
 }
 
-HRESULT __stdcall CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst, IScriptEnvironment* env) {
+HRESULT __stdcall CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU, const byte* srcV, int srcPitch, int clipPrecision, int width, int height, InputTexture* dst) {
 	// Copies source frame into main surface buffer, or into additional input textures
 	RECT SrcRect;
 	SrcRect.top = 0;
@@ -123,25 +118,29 @@ HRESULT __stdcall CopyAviSynthToPlanarBuffer(const byte* srcY, const byte* srcU,
 	return S_OK;
 }
 
-HRESULT __stdcall CopyBufferToAviSynthInternal(IDirect3DSurface9* surface, byte* dst, int dstPitch, int rowSize, int height, IScriptEnvironment* env) {
+HRESULT __stdcall CopyBufferToAviSynthInternal(IDirect3DSurface9* surface, byte* dst, int dstPitch, int rowSize, int height) {
 	D3DLOCKED_RECT srcRect;
 	HR(surface->LockRect(&srcRect, nullptr, D3DLOCK_NO_DIRTY_UPDATE | D3DLOCK_NOSYSLOCK | D3DLOCK_READONLY));
 	BYTE* srcPict = (BYTE*)srcRect.pBits;
-	env->BitBlt(dst, dstPitch, srcPict, srcRect.Pitch, rowSize, height);
+	// Copied row by row rather than with env->BitBlt, as frames may be read back on background threads.
+	for (int y = 0; y < height; y++) {
+		memcpy(dst + y * dstPitch, srcPict + y * srcRect.Pitch, rowSize);
+	}
 	HR(surface->UnlockRect());
 	return S_OK;
 }
 
-HRESULT __stdcall CopyBufferToAviSynth(int commandIndex, InputTexture* src, byte* dst, int dstPitch, int outputPrecision, IScriptEnvironment* env) {
+HRESULT __stdcall CopyBufferToAviSynth(int commandIndex, InputTexture* src, byte* dst, int dstPitch, int outputPrecision) {
 	int Width = src->Width * GetD3DFormatSize(outputPrecision, false);
-	HR(CopyBufferToAviSynthInternal(src->Memory, dst, dstPitch, Width, src->Height, env));
+	HR(CopyBufferToAviSynthInternal(src->Memory, dst, dstPitch, Width, src->Height));
 	return S_OK;
 }
 
-HRESULT __stdcall CopyBufferToAviSynthPlanar(int commandIndex, InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision, IScriptEnvironment* env) {
+HRESULT __stdcall CopyBufferToAviSynthPlanar(int commandIndex, InputTexture* src, byte* dstY, byte* dstU, byte* dstV, int dstPitch, int outputPrecision) {
 	int Width = src->Width * GetD3DFormatSize(outputPrecision, true);
-	HR(CopyBufferToAviSynthInternal(src->SurfaceY, dstY, dstPitch, Width, src->Height, env));
-	HR(CopyBufferToAviSynthInternal(src->SurfaceU, dstU, dstPitch, Width, src->Height, env));
-	HR(CopyBufferToAviSynthInternal(src->SurfaceV, dstV, dstPitch, Width, src->Height, env));
+	HR(CopyBufferToAviSynthInternal(src->SurfaceY, dstY, dstPitch, Width, src->Height));
+	HR(CopyBufferToAviSynthInternal(src->SurfaceU, dstU, dstPitch, Width, src->Height));
+	HR(CopyBufferToAviSynthInternal(src->SurfaceV, dstV, dstPitch, Width, src->Height));
 	return S_OK;
-}
\ No newline at end of file
+}
+#endif
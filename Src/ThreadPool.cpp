@@ -0,0 +1,226 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) {
+	m_ThreadCount = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	if (m_ThreadCount < 1)
+		m_ThreadCount = 1;
+	// The calling thread uses slot 0.
+	for (int i = 1; i < m_ThreadCount; i++) {
+		m_Workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+		m_Stop = true;
+	}
+	m_Wake.notify_all();
+	for (auto& item : m_Workers) {
+		item.join();
+	}
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::GetShared() {
+	static std::mutex SharedMutex;
+	static std::weak_ptr<ThreadPool> Shared;
+	std::unique_lock<std::mutex> my_lock(SharedMutex);
+	std::shared_ptr<ThreadPool> Result = Shared.lock();
+	if (!Result) {
+		Result = std::make_shared<ThreadPool>(0);
+		Shared = Result;
+	}
+	return Result;
+}
+
+void ThreadPool::ParallelFor(int count, int minBand, const std::function<void(int, int)>& func) {
+	if (count <= 0)
+		return;
+	if (minBand < 1)
+		minBand = 1;
+
+	// Use a few bands per thread so that uneven rows still balance out.
+	int Band = (count + m_ThreadCount * 4 - 1) / (m_ThreadCount * 4);
+	if (Band < minBand)
+		Band = minBand;
+	int Bands = (count + Band - 1) / Band;
+	if (Bands <= 1 || m_Workers.empty()) {
+		func(0, count);
+		return;
+	}
+
+	BandJob job;
+	job.Func = &func;
+	job.Count = count;
+	job.Band = Band;
+	job.Bands = Bands;
+
+	Submit(&job);
+	job.Run(0);
+	Withdraw(&job);
+	std::unique_lock<std::mutex> job_lock(job.Mutex);
+	job.Done.wait(job_lock, [&job] { return job.Finished == job.Bands && job.Users == 0; });
+}
+
+void ThreadPool::RunGraph(const std::vector<GraphTask>& tasks) {
+	if (tasks.empty())
+		return;
+
+	GraphJob job;
+	job.Pool = this;
+	job.Tasks = &tasks;
+	job.Remaining.reset(new std::atomic<int>[tasks.size()]);
+	job.Queues = std::vector<GraphJob::Queue>(m_ThreadCount);
+	for (size_t i = 0; i < tasks.size(); i++) {
+		job.Remaining[i] = tasks[i].Dependencies;
+		if (tasks[i].Dependencies == 0)
+			job.Push(0, (int)i);
+	}
+
+	Submit(&job);
+	while (true) {
+		job.Run(0);
+		// Wait until a worker makes tasks ready or the last one finishes.
+		std::unique_lock<std::mutex> job_lock(job.Mutex);
+		job.Done.wait(job_lock, [&job] { return job.Ready > 0 || job.IsExhausted(); });
+		if (job.IsExhausted())
+			break;
+	}
+	Withdraw(&job);
+	std::unique_lock<std::mutex> job_lock(job.Mutex);
+	job.Done.wait(job_lock, [&job] { return job.Users == 0; });
+}
+
+void ThreadPool::Submit(Job* job) {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+		m_Jobs.push_back(job);
+	}
+	m_Wake.notify_all();
+}
+
+// Workers can no longer pick up the job once it leaves the queue; the caller then waits for those still running it.
+void ThreadPool::Withdraw(Job* job) {
+	std::unique_lock<std::mutex> my_lock(m_mutex);
+	auto it = std::find(m_Jobs.begin(), m_Jobs.end(), job);
+	if (it != m_Jobs.end())
+		m_Jobs.erase(it);
+}
+
+// Taking the lock orders the wake-up after the new work is visible to workers checking for it.
+void ThreadPool::WakeWorkers() {
+	{
+		std::unique_lock<std::mutex> my_lock(m_mutex);
+	}
+	m_Wake.notify_all();
+}
+
+void ThreadPool::BandJob::Run(int) {
+	int Processed = 0;
+	int i;
+	while ((i = Next++) < Bands) {
+		int Start = i * Band;
+		int End = Start + Band < Count ? Start + Band : Count;
+		(*Func)(Start, End);
+		Processed++;
+	}
+	if (Processed > 0) {
+		std::unique_lock<std::mutex> job_lock(Mutex);
+		Finished += Processed;
+		if (Finished == Bands)
+			Done.notify_all();
+	}
+}
+
+void ThreadPool::GraphJob::Push(int slot, int task) {
+	Queue& Own = Queues[slot];
+	std::unique_lock<std::mutex> queue_lock(Own.Mutex);
+	Own.Tasks.push_back(task);
+	Ready++;
+}
+
+// Takes the newest task of the thread's own queue, whose inputs are likely still in its cache,
+// or else the oldest task of another thread.
+bool ThreadPool::GraphJob::Pop(int slot, int* task) {
+	const int Count = (int)Queues.size();
+	for (int i = 0; i < Count; i++) {
+		Queue& Victim = Queues[(slot + i) % Count];
+		std::unique_lock<std::mutex> queue_lock(Victim.Mutex);
+		if (!Victim.Tasks.empty()) {
+			if (i == 0) {
+				*task = Victim.Tasks.back();
+				Victim.Tasks.pop_back();
+			}
+			else {
+				*task = Victim.Tasks.front();
+				Victim.Tasks.pop_front();
+			}
+			Ready--;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::GraphJob::Run(int slot) {
+	int Task;
+	while (Pop(slot, &Task)) {
+		const GraphTask& Item = (*Tasks)[Task];
+		Item.Func();
+
+		int NewlyReady = 0;
+		for (auto const next : Item.Next) {
+			if (--Remaining[next] == 0) {
+				Push(slot, next);
+				NewlyReady++;
+			}
+		}
+		bool Last = ++Finished == (int)Tasks->size();
+
+		// This thread takes one of the new tasks itself; others are offered to idle threads.
+		if (NewlyReady > 1 || Last) {
+			{
+				std::unique_lock<std::mutex> job_lock(Mutex);
+			}
+			Done.notify_all();
+			if (NewlyReady > 1)
+				Pool->WakeWorkers();
+		}
+	}
+}
+
+void ThreadPool::WorkerLoop(int slot) {
+	while (true) {
+		Job* job = nullptr;
+		{
+			std::unique_lock<std::mutex> my_lock(m_mutex);
+			m_Wake.wait(my_lock, [this, &job] {
+				if (m_Stop)
+					return true;
+				// Jobs that will never have work again stop being offered.
+				for (auto it = m_Jobs.begin(); it != m_Jobs.end();) {
+					if ((*it)->IsExhausted()) {
+						it = m_Jobs.erase(it);
+						continue;
+					}
+					if ((*it)->HasWork()) {
+						job = *it;
+						return true;
+					}
+					++it;
+				}
+				return false;
+			});
+			if (m_Stop)
+				return;
+			job->Users++;
+		}
+
+		job->Run(slot);
+
+		std::unique_lock<std::mutex> job_lock(job->Mutex);
+		job->Users--;
+		if (job->Users == 0)
+			job->Done.notify_all();
+	}
+}
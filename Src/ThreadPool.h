@@ -0,0 +1,102 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Runs bands of rows on a fixed set of worker threads. Several filters and frames can share the same pool;
+   the thread calling ParallelFor processes bands as well, so nested or concurrent calls never wait on an idle pool.
+
+   RunGraph runs tasks with dependencies instead, without waiting for all threads between steps: each thread keeps
+   the tasks it made ready in its own queue and takes from the others' when it runs out. */
+
+// A task of RunGraph. It starts once the tasks listing it in Next are finished.
+struct GraphTask {
+	std::function<void()> Func;
+	std::vector<int> Next;	// Tasks waiting for this one
+	int Dependencies = 0;	// Number of tasks this one waits for
+};
+
+class ThreadPool {
+public:
+	// threads: Total number of threads processing each job, including the calling thread. 0 uses all logical cores.
+	ThreadPool(int threads);
+	~ThreadPool();
+	int GetThreadCount() { return m_ThreadCount; }
+	// Returns the pool using all logical cores shared by the filters of the process. It is created on first use and
+	// deleted with its last user, so that separate filters don't each start a thread per core.
+	static std::shared_ptr<ThreadPool> GetShared();
+
+	// Splits [0, count) into bands of at least minBand items and calls func(start, end) for each of them in parallel.
+	// Returns once all bands are processed.
+	void ParallelFor(int count, int minBand, const std::function<void(int, int)>& func);
+
+	// Runs all tasks, each after the ones it depends on. The graph must not have cycles. Returns once all tasks are processed.
+	void RunGraph(const std::vector<GraphTask>& tasks);
+
+private:
+	// Work offered to the pool by a ParallelFor or RunGraph call.
+	struct Job {
+		virtual ~Job() {}
+		// Whether a thread joining the job now would find something to run.
+		virtual bool HasWork() = 0;
+		// Whether the job will never have work again; it then leaves the queue.
+		virtual bool IsExhausted() = 0;
+		// Runs work on the thread of specified slot until there is none available.
+		virtual void Run(int slot) = 0;
+
+		std::atomic<int> Users{ 0 };
+		std::mutex Mutex;
+		std::condition_variable Done;
+	};
+
+	struct BandJob : Job {
+		bool HasWork() override { return Next < Bands; }
+		bool IsExhausted() override { return Next >= Bands; }
+		void Run(int slot) override;
+
+		const std::function<void(int, int)>* Func;
+		int Count;
+		int Band;
+		int Bands;
+		std::atomic<int> Next{ 0 };
+		int Finished = 0;
+	};
+
+	struct GraphJob : Job {
+		bool HasWork() override { return Ready > 0; }
+		bool IsExhausted() override { return Finished == (int)Tasks->size(); }
+		void Run(int slot) override;
+		bool Pop(int slot, int* task);
+		void Push(int slot, int task);
+
+		struct Queue {
+			std::mutex Mutex;
+			std::deque<int> Tasks;
+		};
+
+		ThreadPool* Pool;
+		const std::vector<GraphTask>* Tasks;
+		std::unique_ptr<std::atomic<int>[]> Remaining;	// Dependencies not finished yet
+		std::vector<Queue> Queues;		// Ready tasks, one queue per thread
+		std::atomic<int> Ready{ 0 };
+		std::atomic<int> Finished{ 0 };
+	};
+
+	void WorkerLoop(int slot);
+	void Submit(Job* job);
+	void Withdraw(Job* job);
+	void WakeWorkers();
+
+	int m_ThreadCount;
+	std::vector<std::thread> m_Workers;
+	std::deque<Job*> m_Jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_Wake;
+	bool m_Stop = false;
+};
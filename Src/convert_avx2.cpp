@@ -0,0 +1,1251 @@
+#if !defined(__AVX2__)
+#error /arch:avx2 is not set.
+#else
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+#include "Platform.h"
+
+#pragma warning(disable:4556)
+
+
+/*
+AVX2 versions of the kernels in convert_*_shader.cpp.
+
+All kernels process 16 pixels per iteration with unaligned loads and stores and finish
+each row with a scalar loop, so the width doesn't need to be mod16.
+Half-float samples are converted in registers, the LUT passed in the last argument is
+not used.
+*/
+
+
+static __forceinline __m128i loadu(const uint8_t* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+
+static __forceinline __m256i loadu256(const uint8_t* p)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+
+// Frames are aligned, so these stores bypass the cache like the SSE2 kernels do; they only fall back to unaligned
+// stores for unaligned frames. Regular stores first read each line they write, which halves the throughput once
+// frames no longer fit in the cache.
+static __forceinline void storeu(uint8_t* p, const __m128i& x)
+{
+    if ((reinterpret_cast<uintptr_t>(p) & 15) == 0) {
+        _mm_stream_si128(reinterpret_cast<__m128i*>(p), x);
+    } else {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x);
+    }
+}
+
+
+static __forceinline void storeu256(uint8_t* p, const __m256i& x)
+{
+    if ((reinterpret_cast<uintptr_t>(p) & 31) == 0) {
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(p), x);
+    } else {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x);
+    }
+}
+
+
+// 16 x uint8_t -> 16 x uint16_t
+static __forceinline __m256i widen(const __m128i& x)
+{
+    return _mm256_cvtepu8_epi16(x);
+}
+
+
+// 16 x int16_t -> 16 x uint8_t with unsigned saturation
+static __forceinline __m128i narrow(const __m256i& x)
+{
+    return _mm_packus_epi16(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+}
+
+
+template <bool STACK16>
+static __forceinline __m256i load_stacked(const uint8_t* msb, const uint8_t* lsb)
+{
+    __m256i w = _mm256_slli_epi16(widen(loadu(msb)), 8);
+    if (STACK16) {
+        w = _mm256_or_si256(w, widen(loadu(lsb)));
+    }
+    return w;
+}
+
+
+// uint16_t -> uint8_t, same rounding as min((lsb >> 7) + msb, 255)
+static __forceinline __m256i round_msb(const __m256i& x)
+{
+    const __m256i one = _mm256_set1_epi16(1);
+    return _mm256_add_epi16(_mm256_srli_epi16(x, 8), _mm256_and_si256(_mm256_srli_epi16(x, 7), one));
+}
+
+
+static __forceinline int round_msb(int x)
+{
+    return std::min((x >> 8) + ((x >> 7) & 1), 255);
+}
+
+
+static __forceinline uint16_t to_half(int x, float rcp)
+{
+    return _cvtss_sh(x * rcp, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+
+static __forceinline int from_half(uint16_t x, float coef, int maximum)
+{
+    int i = _mm_cvtss_si32(_mm_set_ss(_cvtsh_ss(x) * coef));
+    return std::min(std::max(i, 0), maximum);
+}
+
+
+// 16 x uint16_t -> 16 half-floats
+static __forceinline void store_half(uint8_t* p, const __m256i& x, const __m256& rcp)
+{
+    __m256 f0 = _mm256_mul_ps(rcp, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(x))));
+    __m256 f1 = _mm256_mul_ps(rcp, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1))));
+    storeu(p + 0, _mm256_cvtps_ph(f0, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+    storeu(p + 16, _mm256_cvtps_ph(f1, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+}
+
+
+// 16 half-floats -> 16 x int16_t (0 - 255) or uint16_t (0 - 65535)
+template <bool STACK16>
+static __forceinline __m256i load_half(const uint8_t* p, const __m256& coef)
+{
+    __m256i i0 = _mm256_cvtps_epi32(_mm256_mul_ps(coef, _mm256_cvtph_ps(loadu(p + 0))));
+    __m256i i1 = _mm256_cvtps_epi32(_mm256_mul_ps(coef, _mm256_cvtph_ps(loadu(p + 16))));
+    __m256i w = STACK16 ? _mm256_packus_epi32(i0, i1) : _mm256_packs_epi32(i0, i1);
+    return _mm256_permute4x64_epi64(w, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+
+// 4 x BGRA per 128bit lane -> B0-3,G0-3,R0-3,A0-3 per lane -> B0-15,R0-15 / G0-15,A0-15
+static __forceinline void
+deinterleave_bgra(__m256i t0, __m256i t1, __m128i& b, __m128i& g, __m128i& r, __m128i& a)
+{
+    const __m256i order = _mm256_setr_epi8(
+        0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+        0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    t0 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t0, order), perm); // B0-7,G0-7,R0-7,A0-7
+    t1 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t1, order), perm); // B8-15,G8-15,R8-15,A8-15
+    __m256i br = _mm256_unpacklo_epi64(t0, t1);
+    __m256i ga = _mm256_unpackhi_epi64(t0, t1);
+    b = _mm256_castsi256_si128(br);
+    r = _mm256_extracti128_si256(br, 1);
+    g = _mm256_castsi256_si128(ga);
+    a = _mm256_extracti128_si256(ga, 1);
+}
+
+
+// 16 pixels of BGRA
+static __forceinline void
+load_bgra(const uint8_t* p, __m128i& b, __m128i& g, __m128i& r, __m128i& a)
+{
+    deinterleave_bgra(loadu256(p), loadu256(p + 32), b, g, r, a);
+}
+
+
+// 16 pixels of BGR. Each lane receives 12 bytes from its own 16 bytes load so nothing is read past the 48 bytes.
+static __forceinline void
+load_bgr(const uint8_t* p, __m128i& b, __m128i& g, __m128i& r)
+{
+    const __m256i expand = _mm256_setr_epi8(
+        0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+        4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15, -1);
+    __m256i t0 = _mm256_inserti128_si256(_mm256_castsi128_si256(loadu(p + 0)), loadu(p + 8), 1);
+    __m256i t1 = _mm256_inserti128_si256(_mm256_castsi128_si256(loadu(p + 24)), loadu(p + 32), 1);
+    __m128i a;
+    deinterleave_bgra(_mm256_shuffle_epi8(t0, expand), _mm256_shuffle_epi8(t1, expand), b, g, r, a);
+}
+
+
+template <bool IS_RGB32>
+static __forceinline void
+load_rgb(const uint8_t* p, __m128i& b, __m128i& g, __m128i& r, __m128i& a)
+{
+    if (IS_RGB32) {
+        load_bgra(p, b, g, r, a);
+    } else {
+        load_bgr(p, b, g, r);
+    }
+}
+
+
+// B0-15,G0-15,R0-15,A0-15 -> BGRA0-7 / BGRA8-15
+static __forceinline void
+interleave_bgra(const __m128i& b, const __m128i& g, const __m128i& r, const __m128i& a, __m256i& t0, __m256i& t1)
+{
+    // B0-7 in the low lane, B8-15 in the high lane.
+    __m256i bx = _mm256_permute4x64_epi64(_mm256_castsi128_si256(b), _MM_SHUFFLE(1, 1, 0, 0));
+    __m256i gx = _mm256_permute4x64_epi64(_mm256_castsi128_si256(g), _MM_SHUFFLE(1, 1, 0, 0));
+    __m256i rx = _mm256_permute4x64_epi64(_mm256_castsi128_si256(r), _MM_SHUFFLE(1, 1, 0, 0));
+    __m256i ax = _mm256_permute4x64_epi64(_mm256_castsi128_si256(a), _MM_SHUFFLE(1, 1, 0, 0));
+    __m256i bg = _mm256_unpacklo_epi8(bx, gx);
+    __m256i ra = _mm256_unpacklo_epi8(rx, ax);
+    __m256i lo = _mm256_unpacklo_epi16(bg, ra); // BGRA0-3, BGRA8-11
+    __m256i hi = _mm256_unpackhi_epi16(bg, ra); // BGRA4-7, BGRA12-15
+    t0 = _mm256_permute2x128_si256(lo, hi, 0x20);
+    t1 = _mm256_permute2x128_si256(lo, hi, 0x31);
+}
+
+
+static __forceinline void
+store_bgra(uint8_t* p, const __m128i& b, const __m128i& g, const __m128i& r, const __m128i& a)
+{
+    __m256i t0, t1;
+    interleave_bgra(b, g, r, a, t0, t1);
+    storeu256(p + 0, t0);
+    storeu256(p + 32, t1);
+}
+
+
+static __forceinline void
+store_bgr(uint8_t* p, const __m128i& b, const __m128i& g, const __m128i& r)
+{
+    const __m256i compress = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    __m256i t0, t1;
+    interleave_bgra(b, g, r, _mm_setzero_si128(), t0, t1);
+    t0 = _mm256_shuffle_epi8(t0, compress); // BGR0-3, BGR4-7
+    t1 = _mm256_shuffle_epi8(t1, compress); // BGR8-11, BGR12-15
+    __m128i c0 = _mm256_castsi256_si128(t0);
+    __m128i c1 = _mm256_extracti128_si256(t0, 1);
+    __m128i c2 = _mm256_castsi256_si128(t1);
+    __m128i c3 = _mm256_extracti128_si256(t1, 1);
+    storeu(p + 0, _mm_or_si128(c0, _mm_slli_si128(c1, 12)));
+    storeu(p + 16, _mm_or_si128(_mm_srli_si128(c1, 4), _mm_slli_si128(c2, 8)));
+    storeu(p + 32, _mm_or_si128(_mm_srli_si128(c2, 8), _mm_slli_si128(c3, 4)));
+}
+
+
+template <bool IS_RGB32>
+static __forceinline void
+store_rgb(uint8_t* p, const __m128i& b, const __m128i& g, const __m128i& r, const __m128i& a)
+{
+    if (IS_RGB32) {
+        store_bgra(p, b, g, r, a);
+    } else {
+        store_bgr(p, b, g, r);
+    }
+}
+
+
+// RGBA0-3 / RGBA4-7 / RGBA8-11 / RGBA12-15 (uint16_t) -> R0-15, G0-15, B0-15, A0-15
+static __forceinline void
+deinterleave_rgba16(const __m256i* t, __m256i& r, __m256i& g, __m256i& b, __m256i& a)
+{
+    const __m256i order = _mm256_setr_epi8(
+        0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15,
+        0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15);
+    const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    __m256i t0 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t[0], order), perm); // R0-3,G0-3,B0-3,A0-3
+    __m256i t1 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t[1], order), perm);
+    __m256i t2 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t[2], order), perm);
+    __m256i t3 = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(t[3], order), perm);
+    __m256i rb0 = _mm256_unpacklo_epi64(t0, t1); // R0-7, B0-7
+    __m256i ga0 = _mm256_unpackhi_epi64(t0, t1); // G0-7, A0-7
+    __m256i rb1 = _mm256_unpacklo_epi64(t2, t3); // R8-15, B8-15
+    __m256i ga1 = _mm256_unpackhi_epi64(t2, t3); // G8-15, A8-15
+    r = _mm256_permute2x128_si256(rb0, rb1, 0x20);
+    b = _mm256_permute2x128_si256(rb0, rb1, 0x31);
+    g = _mm256_permute2x128_si256(ga0, ga1, 0x20);
+    a = _mm256_permute2x128_si256(ga0, ga1, 0x31);
+}
+
+
+// R0-15, G0-15, B0-15, A0-15 (uint16_t) -> RGBA0-3 / RGBA4-7 / RGBA8-11 / RGBA12-15
+static __forceinline void
+interleave_rgba16(const __m256i& r, const __m256i& g, const __m256i& b, const __m256i& a, __m256i* t)
+{
+    __m256i rg0 = _mm256_unpacklo_epi16(r, g); // RG0-3, RG8-11
+    __m256i rg1 = _mm256_unpackhi_epi16(r, g); // RG4-7, RG12-15
+    __m256i ba0 = _mm256_unpacklo_epi16(b, a);
+    __m256i ba1 = _mm256_unpackhi_epi16(b, a);
+    __m256i p0 = _mm256_unpacklo_epi32(rg0, ba0); // RGBA0-1, RGBA8-9
+    __m256i p1 = _mm256_unpackhi_epi32(rg0, ba0); // RGBA2-3, RGBA10-11
+    __m256i p2 = _mm256_unpacklo_epi32(rg1, ba1); // RGBA4-5, RGBA12-13
+    __m256i p3 = _mm256_unpackhi_epi32(rg1, ba1); // RGBA6-7, RGBA14-15
+    t[0] = _mm256_permute2x128_si256(p0, p1, 0x20);
+    t[1] = _mm256_permute2x128_si256(p2, p3, 0x20);
+    t[2] = _mm256_permute2x128_si256(p0, p1, 0x31);
+    t[3] = _mm256_permute2x128_si256(p2, p3, 0x31);
+}
+
+
+static __forceinline void
+load_rgba16(const uint8_t* p, __m256i& r, __m256i& g, __m256i& b, __m256i& a)
+{
+    __m256i t[4] = { loadu256(p), loadu256(p + 32), loadu256(p + 64), loadu256(p + 96) };
+    deinterleave_rgba16(t, r, g, b, a);
+}
+
+
+static __forceinline void
+store_rgba16(uint8_t* p, const __m256i& r, const __m256i& g, const __m256i& b, const __m256i& a)
+{
+    __m256i t[4];
+    interleave_rgba16(r, g, b, a, t);
+    for (int i = 0; i < 4; ++i) {
+        storeu256(p + 32 * i, t[i]);
+    }
+}
+
+
+// 16 pixels of half-float RGBA -> R0-15, G0-15, B0-15, A0-15 as int16_t (0 - 255) or uint16_t (0 - 65535)
+template <bool STACK16>
+static __forceinline void
+load_half_rgba(const uint8_t* p, const __m256& coef, __m256i& r, __m256i& g, __m256i& b, __m256i& a)
+{
+    __m256i t[4];
+    for (int i = 0; i < 4; ++i) {
+        // load_half keeps the order of the samples, so this gives RGBA16 for 4 pixels.
+        t[i] = load_half<STACK16>(p + 32 * i, coef);
+    }
+    deinterleave_rgba16(t, r, g, b, a);
+}
+
+
+static __forceinline void
+store_half_rgba(uint8_t* p, const __m256& rcp, const __m256i& r, const __m256i& g, const __m256i& b, const __m256i& a)
+{
+    __m256i t[4];
+    interleave_rgba16(r, g, b, a, t);
+    for (int i = 0; i < 4; ++i) {
+        store_half(p + 32 * i, t[i], rcp);
+    }
+}
+
+
+
+static inline void
+yuv_to_packed_shader_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y = 0; y < height; ++y) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            store_bgra(d + 4 * x, loadu(sb + x), loadu(sg + x), loadu(sr + x), zero);
+        }
+        for (; x < width; ++x) {
+            d[4 * x + 0] = sb[x];
+            d[4 * x + 1] = sg[x];
+            d[4 * x + 2] = sr[x];
+            d[4 * x + 3] = 0;
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d += dpitch;
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_packed_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const uint8_t* rlsb = srcp[3];
+    const uint8_t* glsb = srcp[4];
+    const uint8_t* blsb = srcp[5];
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* d16 = reinterpret_cast<uint16_t*>(d);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r = load_stacked<STACK16>(sr + x, rlsb + x);
+            __m256i g = load_stacked<STACK16>(sg + x, glsb + x);
+            __m256i b = load_stacked<STACK16>(sb + x, blsb + x);
+            store_rgba16(d + 8 * x, r, g, b, zero);
+        }
+        for (; x < width; ++x) {
+            d16[4 * x + 0] = (sr[x] << 8) | (STACK16 ? rlsb[x] : 0);
+            d16[4 * x + 1] = (sg[x] << 8) | (STACK16 ? glsb[x] : 0);
+            d16[4 * x + 2] = (sb[x] << 8) | (STACK16 ? blsb[x] : 0);
+            d16[4 * x + 3] = 0;
+        }
+        d += dpitch;
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        if (STACK16) {
+            rlsb += spitch;
+            glsb += spitch;
+            blsb += spitch;
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_packed_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const uint8_t* rlsb = srcp[3];
+    const uint8_t* glsb = srcp[4];
+    const uint8_t* blsb = srcp[5];
+
+    const __m256i zero = _mm256_setzero_si256();
+    const float rcp = 1.0f / (STACK16 ? 65535 : 255);
+    const __m256 rcpx = _mm256_set1_ps(rcp);
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* d16 = reinterpret_cast<uint16_t*>(d);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b;
+            if (!STACK16) {
+                r = widen(loadu(sr + x));
+                g = widen(loadu(sg + x));
+                b = widen(loadu(sb + x));
+            } else {
+                r = load_stacked<true>(sr + x, rlsb + x);
+                g = load_stacked<true>(sg + x, glsb + x);
+                b = load_stacked<true>(sb + x, blsb + x);
+            }
+            store_half_rgba(d + 8 * x, rcpx, r, g, b, zero);
+        }
+        for (; x < width; ++x) {
+            d16[4 * x + 0] = to_half(STACK16 ? (sr[x] << 8) | rlsb[x] : sr[x], rcp);
+            d16[4 * x + 1] = to_half(STACK16 ? (sg[x] << 8) | glsb[x] : sg[x], rcp);
+            d16[4 * x + 2] = to_half(STACK16 ? (sb[x] << 8) | blsb[x] : sb[x], rcp);
+            d16[4 * x + 3] = 0;
+        }
+        d += dpitch;
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        if (STACK16) {
+            rlsb += spitch;
+            glsb += spitch;
+            blsb += spitch;
+        }
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_packed_shader_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y = 0; y < height; ++y) {
+        if (IS_RGB32) {
+            memcpy(d, s, width * 4); // same as FlipVertical()
+        } else {
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i b, g, r;
+                load_bgr(s + 3 * x, b, g, r);
+                store_bgra(d + 4 * x, b, g, r, zero);
+            }
+            for (; x < width; ++x) {
+                d[4 * x + 0] = s[3 * x + 0];
+                d[4 * x + 1] = s[3 * x + 1];
+                d[4 * x + 2] = s[3 * x + 2];
+                d[4 * x + 3] = 0;
+            }
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_packed_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* d16 = reinterpret_cast<uint16_t*>(d);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a = _mm_setzero_si128();
+            load_rgb<IS_RGB32>(s + step * x, b, g, r, a);
+            store_rgba16(d + 8 * x,
+                _mm256_slli_epi16(widen(r), 8), _mm256_slli_epi16(widen(g), 8),
+                _mm256_slli_epi16(widen(b), 8), _mm256_slli_epi16(widen(a), 8));
+        }
+        for (; x < width; ++x) {
+            d16[4 * x + 0] = s[step * x + 2] << 8;
+            d16[4 * x + 1] = s[step * x + 1] << 8;
+            d16[4 * x + 2] = s[step * x + 0] << 8;
+            d16[4 * x + 3] = IS_RGB32 ? s[4 * x + 3] << 8 : 0;
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_packed_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    const float rcp = 1.0f / 255;
+    const __m256 rcpx = _mm256_set1_ps(rcp);
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* d16 = reinterpret_cast<uint16_t*>(d);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a = _mm_setzero_si128();
+            load_rgb<IS_RGB32>(s + step * x, b, g, r, a);
+            store_half_rgba(d + 8 * x, rcpx, widen(r), widen(g), widen(b), widen(a));
+        }
+        for (; x < width; ++x) {
+            d16[4 * x + 0] = to_half(s[step * x + 2], rcp);
+            d16[4 * x + 1] = to_half(s[step * x + 1], rcp);
+            d16[4 * x + 2] = to_half(s[step * x + 0], rcp);
+            d16[4 * x + 3] = IS_RGB32 ? to_half(s[4 * x + 3], rcp) : 0;
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+
+template <bool STACK16>
+static inline void
+yuv_to_planar_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        const uint8_t* lsb = srcp[p + 3];
+        uint8_t* d = dstp[p];
+
+        for (int y = 0; y < height; ++y) {
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                storeu256(d + 2 * x, load_stacked<STACK16>(s + x, lsb + x));
+            }
+            for (; x < width; ++x) {
+                d[2 * x + 0] = STACK16 ? lsb[x] : 0;
+                d[2 * x + 1] = s[x];
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += spitch;
+            }
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_planar_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const float rcp = 1.0f / (STACK16 ? 65535 : 255);
+    const __m256 rcpx = _mm256_set1_ps(rcp);
+
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        const uint8_t* lsb = srcp[p + 3];
+        uint8_t* d = dstp[p];
+
+        for (int y = 0; y < height; ++y) {
+            uint16_t* d16 = reinterpret_cast<uint16_t*>(d);
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m256i w = STACK16 ? load_stacked<true>(s + x, lsb + x) : widen(loadu(s + x));
+                store_half(d + 2 * x, w, rcpx);
+            }
+            for (; x < width; ++x) {
+                d16[x] = to_half(STACK16 ? (s[x] << 8) | lsb[x] : s[x], rcp);
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += spitch;
+            }
+        }
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_planar_shader_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a;
+            load_rgb<IS_RGB32>(s + step * x, b, g, r, a);
+            storeu(db + x, b);
+            storeu(dg + x, g);
+            storeu(dr + x, r);
+        }
+        for (; x < width; ++x) {
+            db[x] = s[step * x + 0];
+            dg[x] = s[step * x + 1];
+            dr[x] = s[step * x + 2];
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_planar_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* dr16 = reinterpret_cast<uint16_t*>(dr);
+        uint16_t* dg16 = reinterpret_cast<uint16_t*>(dg);
+        uint16_t* db16 = reinterpret_cast<uint16_t*>(db);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a;
+            load_rgb<IS_RGB32>(s + step * x, b, g, r, a);
+            storeu256(db + 2 * x, _mm256_slli_epi16(widen(b), 8));
+            storeu256(dg + 2 * x, _mm256_slli_epi16(widen(g), 8));
+            storeu256(dr + 2 * x, _mm256_slli_epi16(widen(r), 8));
+        }
+        for (; x < width; ++x) {
+            db16[x] = s[step * x + 0] << 8;
+            dg16[x] = s[step * x + 1] << 8;
+            dr16[x] = s[step * x + 2] << 8;
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+rgb_to_planar_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    const float rcp = 1.0f / 255;
+    const __m256 rcpx = _mm256_set1_ps(rcp);
+
+    for (int y = 0; y < height; ++y) {
+        uint16_t* dr16 = reinterpret_cast<uint16_t*>(dr);
+        uint16_t* dg16 = reinterpret_cast<uint16_t*>(dg);
+        uint16_t* db16 = reinterpret_cast<uint16_t*>(db);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a;
+            load_rgb<IS_RGB32>(s + step * x, b, g, r, a);
+            store_half(db + 2 * x, widen(b), rcpx);
+            store_half(dg + 2 * x, widen(g), rcpx);
+            store_half(dr + 2 * x, widen(r), rcpx);
+        }
+        for (; x < width; ++x) {
+            db16[x] = to_half(s[step * x + 0], rcp);
+            dg16[x] = to_half(s[step * x + 1], rcp);
+            dr16[x] = to_half(s[step * x + 2], rcp);
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+
+static inline void
+packed_shader_to_yuv_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b, g, r, a;
+            load_bgra(s + 4 * x, b, g, r, a);
+            storeu(db + x, b);
+            storeu(dg + x, g);
+            storeu(dr + x, r);
+        }
+        for (; x < width; ++x) {
+            db[x] = s[4 * x + 0];
+            dg[x] = s[4 * x + 1];
+            dr[x] = s[4 * x + 2];
+        }
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        s += spitch;
+    }
+}
+
+
+template <bool STACK16>
+static __forceinline void
+store_yuv(uint8_t* msb, uint8_t* lsb, const __m256i& w) noexcept
+{
+    if (!STACK16) {
+        storeu(msb, narrow(w));
+    } else {
+        const __m256i mask = _mm256_set1_epi16(0x00FF);
+        storeu(msb, narrow(_mm256_srli_epi16(w, 8)));
+        storeu(lsb, narrow(_mm256_and_si256(w, mask)));
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+packed_shader_to_yuv_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    uint8_t* lr = dstp[3];
+    uint8_t* lg = dstp[4];
+    uint8_t* lb = dstp[5];
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b, a;
+            load_rgba16(s + 8 * x, r, g, b, a);
+            if (!STACK16) {
+                r = round_msb(r);
+                g = round_msb(g);
+                b = round_msb(b);
+            }
+            store_yuv<STACK16>(dr + x, lr + x, r);
+            store_yuv<STACK16>(dg + x, lg + x, g);
+            store_yuv<STACK16>(db + x, lb + x, b);
+        }
+        for (; x < width; ++x) {
+            if (!STACK16) {
+                dr[x] = round_msb(s16[4 * x + 0]);
+                dg[x] = round_msb(s16[4 * x + 1]);
+                db[x] = round_msb(s16[4 * x + 2]);
+            } else {
+                lr[x] = s[8 * x + 0];
+                dr[x] = s[8 * x + 1];
+                lg[x] = s[8 * x + 2];
+                dg[x] = s[8 * x + 3];
+                lb[x] = s[8 * x + 4];
+                db[x] = s[8 * x + 5];
+            }
+        }
+        s += spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        if (STACK16) {
+            lr += dpitch;
+            lg += dpitch;
+            lb += dpitch;
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+packed_shader_to_yuv_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    uint8_t* lr = dstp[3];
+    uint8_t* lg = dstp[4];
+    uint8_t* lb = dstp[5];
+
+    const int maximum = STACK16 ? 65535 : 255;
+    const float coef = static_cast<float>(maximum);
+    const __m256 coefx = _mm256_set1_ps(coef);
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b, a;
+            load_half_rgba<STACK16>(s + 8 * x, coefx, r, g, b, a);
+            store_yuv<STACK16>(dr + x, lr + x, r);
+            store_yuv<STACK16>(dg + x, lg + x, g);
+            store_yuv<STACK16>(db + x, lb + x, b);
+        }
+        for (; x < width; ++x) {
+            int r = from_half(s16[4 * x + 0], coef, maximum);
+            int g = from_half(s16[4 * x + 1], coef, maximum);
+            int b = from_half(s16[4 * x + 2], coef, maximum);
+            if (!STACK16) {
+                dr[x] = r;
+                dg[x] = g;
+                db[x] = b;
+            } else {
+                dr[x] = r >> 8;
+                lr[x] = r & 0xFF;
+                dg[x] = g >> 8;
+                lg[x] = g & 0xFF;
+                db[x] = b >> 8;
+                lb[x] = b & 0xFF;
+            }
+        }
+        s += spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        if (STACK16) {
+            lr += dpitch;
+            lg += dpitch;
+            lb += dpitch;
+        }
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+packed_shader_to_rgb_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    for (int y = 0; y < height; ++y) {
+        if (IS_RGB32) {
+            memcpy(d, s, width * 4); // same as FlipVertical()
+        } else {
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i b, g, r, a;
+                load_bgra(s + 4 * x, b, g, r, a);
+                store_bgr(d + 3 * x, b, g, r);
+            }
+            for (; x < width; ++x) {
+                d[3 * x + 0] = s[4 * x + 0];
+                d[3 * x + 1] = s[4 * x + 1];
+                d[3 * x + 2] = s[4 * x + 2];
+            }
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+packed_shader_to_rgb_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b, a;
+            load_rgba16(s + 8 * x, r, g, b, a);
+            store_rgb<IS_RGB32>(d + step * x,
+                narrow(round_msb(b)), narrow(round_msb(g)), narrow(round_msb(r)), narrow(round_msb(a)));
+        }
+        for (; x < width; ++x) {
+            d[step * x + 0] = round_msb(s16[4 * x + 2]);
+            d[step * x + 1] = round_msb(s16[4 * x + 1]);
+            d[step * x + 2] = round_msb(s16[4 * x + 0]);
+            if (IS_RGB32) {
+                d[4 * x + 3] = round_msb(s16[4 * x + 3]);
+            }
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+packed_shader_to_rgb_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    const float coef = 255.0f;
+    const __m256 coefx = _mm256_set1_ps(coef);
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m256i r, g, b, a;
+            load_half_rgba<false>(s + 8 * x, coefx, r, g, b, a);
+            store_rgb<IS_RGB32>(d + step * x, narrow(b), narrow(g), narrow(r), narrow(a));
+        }
+        for (; x < width; ++x) {
+            d[step * x + 0] = from_half(s16[4 * x + 2], coef, 255);
+            d[step * x + 1] = from_half(s16[4 * x + 1], coef, 255);
+            d[step * x + 2] = from_half(s16[4 * x + 0], coef, 255);
+            if (IS_RGB32) {
+                d[4 * x + 3] = from_half(s16[4 * x + 3], coef, 255);
+            }
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+
+template <bool STACK16>
+static inline void
+planar_shader_to_yuv_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        uint8_t* d = dstp[p];
+        uint8_t* lsb = dstp[p + 3];
+
+        for (int y = 0; y < height; ++y) {
+            const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m256i w = loadu256(s + 2 * x);
+                store_yuv<STACK16>(d + x, lsb + x, STACK16 ? w : round_msb(w));
+            }
+            for (; x < width; ++x) {
+                if (!STACK16) {
+                    d[x] = round_msb(s16[x]);
+                } else {
+                    lsb[x] = s[2 * x];
+                    d[x] = s[2 * x + 1];
+                }
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += dpitch;
+            }
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+planar_shader_to_yuv_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const int maximum = STACK16 ? 65535 : 255;
+    const float coef = static_cast<float>(maximum);
+    const __m256 coefx = _mm256_set1_ps(coef);
+
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        uint8_t* d = dstp[p];
+        uint8_t* lsb = dstp[p + 3];
+
+        for (int y = 0; y < height; ++y) {
+            const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
+            int x = 0;
+            for (; x + 16 <= width; x += 16) {
+                store_yuv<STACK16>(d + x, lsb + x, load_half<STACK16>(s + 2 * x, coefx));
+            }
+            for (; x < width; ++x) {
+                int v = from_half(s16[x], coef, maximum);
+                if (!STACK16) {
+                    d[x] = v;
+                } else {
+                    lsb[x] = v & 0xFF;
+                    d[x] = v >> 8;
+                }
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += dpitch;
+            }
+        }
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+planar_shader_to_rgb_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y = 0; y < height; ++y) {
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            store_rgb<IS_RGB32>(d + step * x, loadu(sb + x), loadu(sg + x), loadu(sr + x), zero);
+        }
+        for (; x < width; ++x) {
+            d[step * x + 0] = sb[x];
+            d[step * x + 1] = sg[x];
+            d[step * x + 2] = sr[x];
+            if (IS_RGB32) {
+                d[4 * x + 3] = 0;
+            }
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+planar_shader_to_rgb_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* sr16 = reinterpret_cast<const uint16_t*>(sr);
+        const uint16_t* sg16 = reinterpret_cast<const uint16_t*>(sg);
+        const uint16_t* sb16 = reinterpret_cast<const uint16_t*>(sb);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b = narrow(round_msb(loadu256(sb + 2 * x)));
+            __m128i g = narrow(round_msb(loadu256(sg + 2 * x)));
+            __m128i r = narrow(round_msb(loadu256(sr + 2 * x)));
+            store_rgb<IS_RGB32>(d + step * x, b, g, r, zero);
+        }
+        for (; x < width; ++x) {
+            d[step * x + 0] = round_msb(sb16[x]);
+            d[step * x + 1] = round_msb(sg16[x]);
+            d[step * x + 2] = round_msb(sr16[x]);
+            if (IS_RGB32) {
+                d[4 * x + 3] = 0;
+            }
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+template <bool IS_RGB32>
+static inline void
+planar_shader_to_rgb_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    constexpr size_t step = IS_RGB32 ? 4 : 3;
+
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const float coef = 255.0f;
+    const __m256 coefx = _mm256_set1_ps(coef);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y = 0; y < height; ++y) {
+        const uint16_t* sr16 = reinterpret_cast<const uint16_t*>(sr);
+        const uint16_t* sg16 = reinterpret_cast<const uint16_t*>(sg);
+        const uint16_t* sb16 = reinterpret_cast<const uint16_t*>(sb);
+        int x = 0;
+        for (; x + 16 <= width; x += 16) {
+            __m128i b = narrow(load_half<false>(sb + 2 * x, coefx));
+            __m128i g = narrow(load_half<false>(sg + 2 * x, coefx));
+            __m128i r = narrow(load_half<false>(sr + 2 * x, coefx));
+            store_rgb<IS_RGB32>(d + step * x, b, g, r, zero);
+        }
+        for (; x < width; ++x) {
+            d[step * x + 0] = from_half(sb16[x], coef, 255);
+            d[step * x + 1] = from_half(sg16[x], coef, 255);
+            d[step * x + 2] = from_half(sr16[x], coef, 255);
+            if (IS_RGB32) {
+                d[4 * x + 3] = 0;
+            }
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+
+#define AVX2_KERNEL(name, impl) \
+void __stdcall \
+name(uint8_t** dstp, const uint8_t** srcp, const int dpitch, \
+    const int spitch, const int width, const int height, void*) noexcept \
+{ \
+    impl(dstp, srcp, dpitch, spitch, width, height); \
+}
+
+AVX2_KERNEL(yuv_to_packed_shader_1_avx2, yuv_to_packed_shader_1)
+AVX2_KERNEL(yuv_to_packed_shader_2_avx2, yuv_to_packed_shader_2<false>)
+AVX2_KERNEL(yuv_to_packed_shader_2_avx2_stacked, yuv_to_packed_shader_2<true>)
+AVX2_KERNEL(yuv_to_packed_shader_3_avx2, yuv_to_packed_shader_3<false>)
+AVX2_KERNEL(yuv_to_packed_shader_3_avx2_stacked, yuv_to_packed_shader_3<true>)
+AVX2_KERNEL(rgb24_to_packed_shader_1_avx2, rgb_to_packed_shader_1<false>)
+AVX2_KERNEL(rgb32_to_packed_shader_1_avx2, rgb_to_packed_shader_1<true>)
+AVX2_KERNEL(rgb24_to_packed_shader_2_avx2, rgb_to_packed_shader_2<false>)
+AVX2_KERNEL(rgb32_to_packed_shader_2_avx2, rgb_to_packed_shader_2<true>)
+AVX2_KERNEL(rgb24_to_packed_shader_3_avx2, rgb_to_packed_shader_3<false>)
+AVX2_KERNEL(rgb32_to_packed_shader_3_avx2, rgb_to_packed_shader_3<true>)
+
+AVX2_KERNEL(yuv_to_planar_shader_2_avx2, yuv_to_planar_shader_2<false>)
+AVX2_KERNEL(yuv_to_planar_shader_2_avx2_stacked, yuv_to_planar_shader_2<true>)
+AVX2_KERNEL(yuv_to_planar_shader_3_avx2, yuv_to_planar_shader_3<false>)
+AVX2_KERNEL(yuv_to_planar_shader_3_avx2_stacked, yuv_to_planar_shader_3<true>)
+AVX2_KERNEL(rgb24_to_planar_shader_1_avx2, rgb_to_planar_shader_1<false>)
+AVX2_KERNEL(rgb32_to_planar_shader_1_avx2, rgb_to_planar_shader_1<true>)
+AVX2_KERNEL(rgb24_to_planar_shader_2_avx2, rgb_to_planar_shader_2<false>)
+AVX2_KERNEL(rgb32_to_planar_shader_2_avx2, rgb_to_planar_shader_2<true>)
+AVX2_KERNEL(rgb24_to_planar_shader_3_avx2, rgb_to_planar_shader_3<false>)
+AVX2_KERNEL(rgb32_to_planar_shader_3_avx2, rgb_to_planar_shader_3<true>)
+
+AVX2_KERNEL(packed_shader_to_yuv_1_avx2, packed_shader_to_yuv_1)
+AVX2_KERNEL(packed_shader_to_yuv_2_avx2, packed_shader_to_yuv_2<false>)
+AVX2_KERNEL(packed_shader_to_yuv_3_avx2, packed_shader_to_yuv_3<false>)
+AVX2_KERNEL(packed_shader_to_rgb24_1_avx2, packed_shader_to_rgb_1<false>)
+AVX2_KERNEL(packed_shader_to_rgb32_1_avx2, packed_shader_to_rgb_1<true>)
+AVX2_KERNEL(packed_shader_to_rgb24_2_avx2, packed_shader_to_rgb_2<false>)
+AVX2_KERNEL(packed_shader_to_rgb32_2_avx2, packed_shader_to_rgb_2<true>)
+AVX2_KERNEL(packed_shader_to_rgb24_3_avx2, packed_shader_to_rgb_3<false>)
+AVX2_KERNEL(packed_shader_to_rgb32_3_avx2, packed_shader_to_rgb_3<true>)
+
+AVX2_KERNEL(planar_shader_to_yuv_2_avx2, planar_shader_to_yuv_2<false>)
+AVX2_KERNEL(planar_shader_to_yuv_2_avx2_stacked, planar_shader_to_yuv_2<true>)
+AVX2_KERNEL(planar_shader_to_yuv_3_avx2, planar_shader_to_yuv_3<false>)
+AVX2_KERNEL(planar_shader_to_yuv_3_avx2_stacked, planar_shader_to_yuv_3<true>)
+AVX2_KERNEL(planar_shader_to_rgb24_1_avx2, planar_shader_to_rgb_1<false>)
+AVX2_KERNEL(planar_shader_to_rgb32_1_avx2, planar_shader_to_rgb_1<true>)
+AVX2_KERNEL(planar_shader_to_rgb24_2_avx2, planar_shader_to_rgb_2<false>)
+AVX2_KERNEL(planar_shader_to_rgb32_2_avx2, planar_shader_to_rgb_2<true>)
+AVX2_KERNEL(planar_shader_to_rgb24_3_avx2, planar_shader_to_rgb_3<false>)
+AVX2_KERNEL(planar_shader_to_rgb32_3_avx2, planar_shader_to_rgb_3<true>)
+
+#undef AVX2_KERNEL
+
+
+#endif // __AVX2__
@@ -0,0 +1,941 @@
+#if !defined(__AVX512F__) || !defined(__AVX512BW__) || !defined(__AVX512VL__)
+#error /arch:avx512 is not set.
+#else
+
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+
+#include "Platform.h"
+
+#pragma warning(disable:4556)
+
+
+/*
+AVX-512 versions of the kernels in convert_*_shader.cpp.
+
+All kernels process 32 pixels per iteration. The last pixels of a row are handled by the
+same code with masked loads and stores, so nothing is read or written past the width.
+RGB24 and the RGB32 precision 1 copies are left to the AVX2 kernels.
+*/
+
+
+// Pixel mask for the n remaining pixels of a row
+static __forceinline __mmask32 pixel_mask(int n)
+{
+    return n >= 32 ? 0xFFFFFFFF : (1u << n) - 1;
+}
+
+
+// Masked stores. Whole vectors of aligned frames bypass the cache like the SSE2 kernels do, since regular
+// stores first read each line they write. Only the row ends and unaligned frames use the masked stores.
+static __forceinline bool streamable(const void* p, unsigned m, unsigned full, uintptr_t align)
+{
+    return m == full && (reinterpret_cast<uintptr_t>(p) & (align - 1)) == 0;
+}
+
+
+static __forceinline void stream256(void* p, const __m256i& x)
+{
+    _mm256_stream_si256(reinterpret_cast<__m256i*>(p), x);
+}
+
+
+static __forceinline void stream512(void* p, const __m512i& x)
+{
+    _mm512_stream_si512(reinterpret_cast<__m512i*>(p), x);
+}
+
+
+static __forceinline void store_epi8_256(void* p, __mmask32 m, const __m256i& x)
+{
+    if (streamable(p, m, 0xFFFFFFFF, 32)) stream256(p, x); else _mm256_mask_storeu_epi8(p, m, x);
+}
+
+
+static __forceinline void store_epi16_256(void* p, __mmask16 m, const __m256i& x)
+{
+    if (streamable(p, m, 0xFFFF, 32)) stream256(p, x); else _mm256_mask_storeu_epi16(p, m, x);
+}
+
+
+static __forceinline void store_epi64_256(void* p, __mmask8 m, const __m256i& x)
+{
+    if (streamable(p, m, 0xF, 32)) stream256(p, x); else _mm256_mask_storeu_epi64(p, m, x);
+}
+
+
+static __forceinline void store_epi16(void* p, __mmask32 m, const __m512i& x)
+{
+    if (streamable(p, m, 0xFFFFFFFF, 64)) stream512(p, x); else _mm512_mask_storeu_epi16(p, m, x);
+}
+
+
+static __forceinline void store_epi32(void* p, __mmask16 m, const __m512i& x)
+{
+    if (streamable(p, m, 0xFFFF, 64)) stream512(p, x); else _mm512_mask_storeu_epi32(p, m, x);
+}
+
+
+static __forceinline void store_epi64(void* p, __mmask8 m, const __m512i& x)
+{
+    if (streamable(p, m, 0xFF, 64)) stream512(p, x); else _mm512_mask_storeu_epi64(p, m, x);
+}
+
+
+static __forceinline __m512i load_index(const uint16_t* idx)
+{
+    return _mm512_loadu_si512(idx);
+}
+
+
+// 32 x uint8_t -> 32 x uint16_t
+static __forceinline __m512i load_u8(const uint8_t* p, __mmask32 m)
+{
+    return _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(m, p));
+}
+
+
+// 32 x uint16_t -> 32 x uint8_t with unsigned saturation
+static __forceinline void store_u8(uint8_t* p, __mmask32 m, const __m512i& x)
+{
+    store_epi8_256(p, m, _mm512_cvtusepi16_epi8(x));
+}
+
+
+template <bool STACK16>
+static __forceinline __m512i load_stacked(const uint8_t* msb, const uint8_t* lsb, __mmask32 m)
+{
+    __m512i w = _mm512_slli_epi16(load_u8(msb, m), 8);
+    if (STACK16) {
+        w = _mm512_or_si512(w, load_u8(lsb, m));
+    }
+    return w;
+}
+
+
+// uint16_t -> uint8_t, same rounding as min((lsb >> 7) + msb, 255)
+static __forceinline __m512i round_msb(const __m512i& x)
+{
+    const __m512i one = _mm512_set1_epi16(1);
+    return _mm512_add_epi16(_mm512_srli_epi16(x, 8), _mm512_and_si512(_mm512_srli_epi16(x, 7), one));
+}
+
+
+template <bool STACK16>
+static __forceinline void store_yuv(uint8_t* msb, uint8_t* lsb, __mmask32 m, const __m512i& w)
+{
+    if (!STACK16) {
+        store_u8(msb, m, w);
+    } else {
+        const __m512i mask = _mm512_set1_epi16(0x00FF);
+        store_u8(msb, m, _mm512_srli_epi16(w, 8));
+        store_u8(lsb, m, _mm512_and_si512(w, mask));
+    }
+}
+
+
+// 16 half-floats -> 16 x uint32_t, clamped to 0 - maximum by the caller's saturating narrow
+static __forceinline __m512i half_to_int(const __m256i& h, const __m512& coef)
+{
+    __m512i i = _mm512_cvtps_epi32(_mm512_mul_ps(coef, _mm512_cvtph_ps(h)));
+    return _mm512_max_epi32(i, _mm512_setzero_si512());
+}
+
+
+static __forceinline __m256i int_to_half(const __m256i& w, const __m512& rcp)
+{
+    __m512 f = _mm512_mul_ps(rcp, _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(w)));
+    return _mm512_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+}
+
+
+// 32 half-floats -> 32 x uint16_t (0 - 65535)
+static __forceinline __m512i load_half(const uint8_t* p, __mmask32 m, const __m512& coef)
+{
+    __m256i w0 = _mm512_cvtusepi32_epi16(half_to_int(_mm256_maskz_loadu_epi16(static_cast<__mmask16>(m), p), coef));
+    __m256i w1 = _mm512_cvtusepi32_epi16(half_to_int(_mm256_maskz_loadu_epi16(static_cast<__mmask16>(m >> 16), p + 32), coef));
+    return _mm512_inserti64x4(_mm512_castsi256_si512(w0), w1, 1);
+}
+
+
+// 32 x uint16_t -> 32 half-floats
+static __forceinline void store_half(uint8_t* p, __mmask32 m, const __m512i& x, const __m512& rcp)
+{
+    store_epi16_256(p, static_cast<__mmask16>(m), int_to_half(_mm512_castsi512_si256(x), rcp));
+    store_epi16_256(p + 32, static_cast<__mmask16>(m >> 16), int_to_half(_mm512_extracti64x4_epi64(x, 1), rcp));
+}
+
+
+// Transposes the 4x4 bytes of each 32bit lane group: BGRA0-3 <-> B0-3,G0-3,R0-3,A0-3
+static __forceinline __m512i transpose_bgra(const __m512i& x)
+{
+    const __m512i order = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15));
+    return _mm512_shuffle_epi8(x, order);
+}
+
+
+// 32 pixels of BGRA -> 32 bytes of each channel
+static __forceinline void
+load_bgra(const uint8_t* p, __mmask32 m, __m256i& b, __m256i& g, __m256i& r, __m256i& a)
+{
+    alignas(64) static const uint32_t bg_idx[16] = { 0, 4, 8, 12, 16, 20, 24, 28, 1, 5, 9, 13, 17, 21, 25, 29 };
+    alignas(64) static const uint32_t ra_idx[16] = { 2, 6, 10, 14, 18, 22, 26, 30, 3, 7, 11, 15, 19, 23, 27, 31 };
+
+    __m512i t0 = transpose_bgra(_mm512_maskz_loadu_epi32(static_cast<__mmask16>(m), p));
+    __m512i t1 = transpose_bgra(_mm512_maskz_loadu_epi32(static_cast<__mmask16>(m >> 16), p + 64));
+    __m512i bg = _mm512_permutex2var_epi32(t0, _mm512_load_si512(bg_idx), t1);
+    __m512i ra = _mm512_permutex2var_epi32(t0, _mm512_load_si512(ra_idx), t1);
+    b = _mm512_castsi512_si256(bg);
+    g = _mm512_extracti64x4_epi64(bg, 1);
+    r = _mm512_castsi512_si256(ra);
+    a = _mm512_extracti64x4_epi64(ra, 1);
+}
+
+
+static __forceinline void
+store_bgra(uint8_t* p, __mmask32 m, const __m256i& b, const __m256i& g, const __m256i& r, const __m256i& a)
+{
+    alignas(64) static const uint32_t idx0[16] = { 0, 8, 16, 24, 1, 9, 17, 25, 2, 10, 18, 26, 3, 11, 19, 27 };
+    alignas(64) static const uint32_t idx1[16] = { 4, 12, 20, 28, 5, 13, 21, 29, 6, 14, 22, 30, 7, 15, 23, 31 };
+
+    __m512i bg = _mm512_inserti64x4(_mm512_castsi256_si512(b), g, 1);
+    __m512i ra = _mm512_inserti64x4(_mm512_castsi256_si512(r), a, 1);
+    __m512i t0 = _mm512_permutex2var_epi32(bg, _mm512_load_si512(idx0), ra);
+    __m512i t1 = _mm512_permutex2var_epi32(bg, _mm512_load_si512(idx1), ra);
+    store_epi32(p, static_cast<__mmask16>(m), transpose_bgra(t0));
+    store_epi32(p + 64, static_cast<__mmask16>(m >> 16), transpose_bgra(t1));
+}
+
+
+// RGBA0-7 / RGBA8-15 / RGBA16-23 / RGBA24-31 (uint16_t) -> R0-31, G0-31, B0-31, A0-31
+static __forceinline void
+deinterleave_rgba16(const __m512i* t, __m512i& r, __m512i& g, __m512i& b, __m512i& a)
+{
+    alignas(64) static const uint16_t rg_idx[32] = {
+        0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60,
+        1, 5, 9, 13, 17, 21, 25, 29, 33, 37, 41, 45, 49, 53, 57, 61 };
+    alignas(64) static const uint16_t ba_idx[32] = {
+        2, 6, 10, 14, 18, 22, 26, 30, 34, 38, 42, 46, 50, 54, 58, 62,
+        3, 7, 11, 15, 19, 23, 27, 31, 35, 39, 43, 47, 51, 55, 59, 63 };
+
+    const __m512i rgx = load_index(rg_idx);
+    const __m512i bax = load_index(ba_idx);
+    __m512i rg0 = _mm512_permutex2var_epi16(t[0], rgx, t[1]); // R0-15, G0-15
+    __m512i ba0 = _mm512_permutex2var_epi16(t[0], bax, t[1]); // B0-15, A0-15
+    __m512i rg1 = _mm512_permutex2var_epi16(t[2], rgx, t[3]); // R16-31, G16-31
+    __m512i ba1 = _mm512_permutex2var_epi16(t[2], bax, t[3]); // B16-31, A16-31
+    r = _mm512_shuffle_i64x2(rg0, rg1, _MM_SHUFFLE(1, 0, 1, 0));
+    g = _mm512_shuffle_i64x2(rg0, rg1, _MM_SHUFFLE(3, 2, 3, 2));
+    b = _mm512_shuffle_i64x2(ba0, ba1, _MM_SHUFFLE(1, 0, 1, 0));
+    a = _mm512_shuffle_i64x2(ba0, ba1, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+
+// R0-31, G0-31, B0-31, A0-31 (uint16_t) -> RGBA0-7 / RGBA8-15 / RGBA16-23 / RGBA24-31
+static __forceinline void
+interleave_rgba16(const __m512i& r, const __m512i& g, const __m512i& b, const __m512i& a, __m512i* t)
+{
+    alignas(64) static const uint16_t idx0[32] = {
+        0, 16, 32, 48, 1, 17, 33, 49, 2, 18, 34, 50, 3, 19, 35, 51,
+        4, 20, 36, 52, 5, 21, 37, 53, 6, 22, 38, 54, 7, 23, 39, 55 };
+    alignas(64) static const uint16_t idx1[32] = {
+        8, 24, 40, 56, 9, 25, 41, 57, 10, 26, 42, 58, 11, 27, 43, 59,
+        12, 28, 44, 60, 13, 29, 45, 61, 14, 30, 46, 62, 15, 31, 47, 63 };
+
+    const __m512i i0 = load_index(idx0);
+    const __m512i i1 = load_index(idx1);
+    __m512i rg0 = _mm512_shuffle_i64x2(r, g, _MM_SHUFFLE(1, 0, 1, 0)); // R0-15, G0-15
+    __m512i ba0 = _mm512_shuffle_i64x2(b, a, _MM_SHUFFLE(1, 0, 1, 0));
+    __m512i rg1 = _mm512_shuffle_i64x2(r, g, _MM_SHUFFLE(3, 2, 3, 2)); // R16-31, G16-31
+    __m512i ba1 = _mm512_shuffle_i64x2(b, a, _MM_SHUFFLE(3, 2, 3, 2));
+    t[0] = _mm512_permutex2var_epi16(rg0, i0, ba0);
+    t[1] = _mm512_permutex2var_epi16(rg0, i1, ba0);
+    t[2] = _mm512_permutex2var_epi16(rg1, i0, ba1);
+    t[3] = _mm512_permutex2var_epi16(rg1, i1, ba1);
+}
+
+
+static __forceinline void
+load_rgba16(const uint8_t* p, __mmask32 m, __m512i& r, __m512i& g, __m512i& b, __m512i& a)
+{
+    __m512i t[4];
+    for (int i = 0; i < 4; ++i) {
+        t[i] = _mm512_maskz_loadu_epi64(static_cast<__mmask8>(m >> (8 * i)), p + 64 * i);
+    }
+    deinterleave_rgba16(t, r, g, b, a);
+}
+
+
+static __forceinline void
+store_rgba16(uint8_t* p, __mmask32 m, const __m512i& r, const __m512i& g, const __m512i& b, const __m512i& a)
+{
+    __m512i t[4];
+    interleave_rgba16(r, g, b, a, t);
+    for (int i = 0; i < 4; ++i) {
+        store_epi64(p + 64 * i, static_cast<__mmask8>(m >> (8 * i)), t[i]);
+    }
+}
+
+
+// 32 pixels of half-float RGBA -> R0-31, G0-31, B0-31, A0-31 as uint16_t (0 - 65535)
+static __forceinline void
+load_half_rgba(const uint8_t* p, __mmask32 m, const __m512& coef, __m512i& r, __m512i& g, __m512i& b, __m512i& a)
+{
+    __m512i t[4];
+    for (int i = 0; i < 4; ++i) {
+        // 4 pixels per 256bit load, each pixel is one 64bit element.
+        __m256i h0 = _mm256_maskz_loadu_epi64(static_cast<__mmask8>((m >> (8 * i)) & 0xF), p + 64 * i);
+        __m256i h1 = _mm256_maskz_loadu_epi64(static_cast<__mmask8>((m >> (8 * i + 4)) & 0xF), p + 64 * i + 32);
+        __m256i w0 = _mm512_cvtusepi32_epi16(half_to_int(h0, coef));
+        __m256i w1 = _mm512_cvtusepi32_epi16(half_to_int(h1, coef));
+        t[i] = _mm512_inserti64x4(_mm512_castsi256_si512(w0), w1, 1);
+    }
+    deinterleave_rgba16(t, r, g, b, a);
+}
+
+
+static __forceinline void
+store_half_rgba(uint8_t* p, __mmask32 m, const __m512& rcp, const __m512i& r, const __m512i& g, const __m512i& b, const __m512i& a)
+{
+    __m512i t[4];
+    interleave_rgba16(r, g, b, a, t);
+    for (int i = 0; i < 4; ++i) {
+        __m256i h0 = int_to_half(_mm512_castsi512_si256(t[i]), rcp);
+        __m256i h1 = int_to_half(_mm512_extracti64x4_epi64(t[i], 1), rcp);
+        store_epi64_256(p + 64 * i, static_cast<__mmask8>((m >> (8 * i)) & 0xF), h0);
+        store_epi64_256(p + 64 * i + 32, static_cast<__mmask8>((m >> (8 * i + 4)) & 0xF), h1);
+    }
+}
+
+
+
+static inline void
+yuv_to_packed_shader_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i r = _mm256_maskz_loadu_epi8(m, sr + x);
+            __m256i g = _mm256_maskz_loadu_epi8(m, sg + x);
+            __m256i b = _mm256_maskz_loadu_epi8(m, sb + x);
+            store_bgra(d + 4 * x, m, b, g, r, zero);
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d += dpitch;
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_packed_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const uint8_t* rlsb = srcp[3];
+    const uint8_t* glsb = srcp[4];
+    const uint8_t* blsb = srcp[5];
+
+    const __m512i zero = _mm512_setzero_si512();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r = load_stacked<STACK16>(sr + x, rlsb + x, m);
+            __m512i g = load_stacked<STACK16>(sg + x, glsb + x, m);
+            __m512i b = load_stacked<STACK16>(sb + x, blsb + x, m);
+            store_rgba16(d + 8 * x, m, r, g, b, zero);
+        }
+        d += dpitch;
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        if (STACK16) {
+            rlsb += spitch;
+            glsb += spitch;
+            blsb += spitch;
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_packed_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+
+    uint8_t* d = dstp[0];
+
+    const uint8_t* rlsb = srcp[3];
+    const uint8_t* glsb = srcp[4];
+    const uint8_t* blsb = srcp[5];
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512 rcp = _mm512_set1_ps(1.0f / (STACK16 ? 65535 : 255));
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r, g, b;
+            if (!STACK16) {
+                r = load_u8(sr + x, m);
+                g = load_u8(sg + x, m);
+                b = load_u8(sb + x, m);
+            } else {
+                r = load_stacked<true>(sr + x, rlsb + x, m);
+                g = load_stacked<true>(sg + x, glsb + x, m);
+                b = load_stacked<true>(sb + x, blsb + x, m);
+            }
+            store_half_rgba(d + 8 * x, m, rcp, r, g, b, zero);
+        }
+        d += dpitch;
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        if (STACK16) {
+            rlsb += spitch;
+            glsb += spitch;
+            blsb += spitch;
+        }
+    }
+}
+
+
+static inline void
+rgb32_to_packed_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_rgba16(d + 8 * x, m,
+                _mm512_slli_epi16(_mm512_cvtepu8_epi16(r), 8), _mm512_slli_epi16(_mm512_cvtepu8_epi16(g), 8),
+                _mm512_slli_epi16(_mm512_cvtepu8_epi16(b), 8), _mm512_slli_epi16(_mm512_cvtepu8_epi16(a), 8));
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+static inline void
+rgb32_to_packed_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    const __m512 rcp = _mm512_set1_ps(1.0f / 255);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_half_rgba(d + 8 * x, m, rcp,
+                _mm512_cvtepu8_epi16(r), _mm512_cvtepu8_epi16(g), _mm512_cvtepu8_epi16(b), _mm512_cvtepu8_epi16(a));
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+
+template <bool STACK16>
+static inline void
+yuv_to_planar_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        const uint8_t* lsb = srcp[p + 3];
+        uint8_t* d = dstp[p];
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; x += 32) {
+                __mmask32 m = pixel_mask(width - x);
+                store_epi16(d + 2 * x, m, load_stacked<STACK16>(s + x, lsb + x, m));
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += spitch;
+            }
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+yuv_to_planar_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const __m512 rcp = _mm512_set1_ps(1.0f / (STACK16 ? 65535 : 255));
+
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        const uint8_t* lsb = srcp[p + 3];
+        uint8_t* d = dstp[p];
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; x += 32) {
+                __mmask32 m = pixel_mask(width - x);
+                __m512i w = STACK16 ? load_stacked<true>(s + x, lsb + x, m) : load_u8(s + x, m);
+                store_half(d + 2 * x, m, w, rcp);
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += spitch;
+            }
+        }
+    }
+}
+
+
+static inline void
+rgb32_to_planar_shader_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_epi8_256(db + x, m, b);
+            store_epi8_256(dg + x, m, g);
+            store_epi8_256(dr + x, m, r);
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+static inline void
+rgb32_to_planar_shader_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_epi16(db + 2 * x, m, _mm512_slli_epi16(_mm512_cvtepu8_epi16(b), 8));
+            store_epi16(dg + 2 * x, m, _mm512_slli_epi16(_mm512_cvtepu8_epi16(g), 8));
+            store_epi16(dr + 2 * x, m, _mm512_slli_epi16(_mm512_cvtepu8_epi16(r), 8));
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+static inline void
+rgb32_to_planar_shader_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    // map r to Y, g to U, b to V
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    const __m512 rcp = _mm512_set1_ps(1.0f / 255);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_half(db + 2 * x, m, _mm512_cvtepu8_epi16(b), rcp);
+            store_half(dg + 2 * x, m, _mm512_cvtepu8_epi16(g), rcp);
+            store_half(dr + 2 * x, m, _mm512_cvtepu8_epi16(r), rcp);
+        }
+        s -= spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+    }
+}
+
+
+
+static inline void
+packed_shader_to_yuv_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b, g, r, a;
+            load_bgra(s + 4 * x, m, b, g, r, a);
+            store_epi8_256(db + x, m, b);
+            store_epi8_256(dg + x, m, g);
+            store_epi8_256(dr + x, m, r);
+        }
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        s += spitch;
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+packed_shader_to_yuv_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    uint8_t* lr = dstp[3];
+    uint8_t* lg = dstp[4];
+    uint8_t* lb = dstp[5];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r, g, b, a;
+            load_rgba16(s + 8 * x, m, r, g, b, a);
+            if (!STACK16) {
+                r = round_msb(r);
+                g = round_msb(g);
+                b = round_msb(b);
+            }
+            store_yuv<STACK16>(dr + x, lr + x, m, r);
+            store_yuv<STACK16>(dg + x, lg + x, m, g);
+            store_yuv<STACK16>(db + x, lb + x, m, b);
+        }
+        s += spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        if (STACK16) {
+            lr += dpitch;
+            lg += dpitch;
+            lb += dpitch;
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+packed_shader_to_yuv_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0];
+
+    uint8_t* dr = dstp[0];
+    uint8_t* dg = dstp[1];
+    uint8_t* db = dstp[2];
+
+    uint8_t* lr = dstp[3];
+    uint8_t* lg = dstp[4];
+    uint8_t* lb = dstp[5];
+
+    const __m512 coef = _mm512_set1_ps(STACK16 ? 65535.0f : 255.0f);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r, g, b, a;
+            load_half_rgba(s + 8 * x, m, coef, r, g, b, a);
+            store_yuv<STACK16>(dr + x, lr + x, m, r);
+            store_yuv<STACK16>(dg + x, lg + x, m, g);
+            store_yuv<STACK16>(db + x, lb + x, m, b);
+        }
+        s += spitch;
+        dr += dpitch;
+        dg += dpitch;
+        db += dpitch;
+        if (STACK16) {
+            lr += dpitch;
+            lg += dpitch;
+            lb += dpitch;
+        }
+    }
+}
+
+
+static inline void
+packed_shader_to_rgb32_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r, g, b, a;
+            load_rgba16(s + 8 * x, m, r, g, b, a);
+            store_bgra(d + 4 * x, m,
+                _mm512_cvtusepi16_epi8(round_msb(b)), _mm512_cvtusepi16_epi8(round_msb(g)),
+                _mm512_cvtusepi16_epi8(round_msb(r)), _mm512_cvtusepi16_epi8(round_msb(a)));
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+static inline void
+packed_shader_to_rgb32_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* s = srcp[0] + (height - 1) * spitch;
+    uint8_t* d = dstp[0];
+
+    const __m512 coef = _mm512_set1_ps(255.0f);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m512i r, g, b, a;
+            load_half_rgba(s + 8 * x, m, coef, r, g, b, a);
+            store_bgra(d + 4 * x, m,
+                _mm512_cvtusepi16_epi8(b), _mm512_cvtusepi16_epi8(g),
+                _mm512_cvtusepi16_epi8(r), _mm512_cvtusepi16_epi8(a));
+        }
+        d += dpitch;
+        s -= spitch;
+    }
+}
+
+
+
+template <bool STACK16>
+static inline void
+planar_shader_to_yuv_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        uint8_t* d = dstp[p];
+        uint8_t* lsb = dstp[p + 3];
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; x += 32) {
+                __mmask32 m = pixel_mask(width - x);
+                __m512i w = _mm512_maskz_loadu_epi16(m, s + 2 * x);
+                store_yuv<STACK16>(d + x, lsb + x, m, STACK16 ? w : round_msb(w));
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += dpitch;
+            }
+        }
+    }
+}
+
+
+template <bool STACK16>
+static inline void
+planar_shader_to_yuv_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const __m512 coef = _mm512_set1_ps(STACK16 ? 65535.0f : 255.0f);
+
+    for (int p = 0; p < 3; ++p) {
+        const uint8_t* s = srcp[p];
+        uint8_t* d = dstp[p];
+        uint8_t* lsb = dstp[p + 3];
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; x += 32) {
+                __mmask32 m = pixel_mask(width - x);
+                store_yuv<STACK16>(d + x, lsb + x, m, load_half(s + 2 * x, m, coef));
+            }
+            s += spitch;
+            d += dpitch;
+            if (STACK16) {
+                lsb += dpitch;
+            }
+        }
+    }
+}
+
+
+static inline void
+planar_shader_to_rgb32_1(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b = _mm256_maskz_loadu_epi8(m, sb + x);
+            __m256i g = _mm256_maskz_loadu_epi8(m, sg + x);
+            __m256i r = _mm256_maskz_loadu_epi8(m, sr + x);
+            store_bgra(d + 4 * x, m, b, g, r, zero);
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+static inline void
+planar_shader_to_rgb32_2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b = _mm512_cvtusepi16_epi8(round_msb(_mm512_maskz_loadu_epi16(m, sb + 2 * x)));
+            __m256i g = _mm512_cvtusepi16_epi8(round_msb(_mm512_maskz_loadu_epi16(m, sg + 2 * x)));
+            __m256i r = _mm512_cvtusepi16_epi8(round_msb(_mm512_maskz_loadu_epi16(m, sr + 2 * x)));
+            store_bgra(d + 4 * x, m, b, g, r, zero);
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+static inline void
+planar_shader_to_rgb32_3(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height) noexcept
+{
+    const uint8_t* sr = srcp[0];
+    const uint8_t* sg = srcp[1];
+    const uint8_t* sb = srcp[2];
+    uint8_t* d = dstp[0] + (height - 1) * dpitch;
+
+    const __m512 coef = _mm512_set1_ps(255.0f);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; x += 32) {
+            __mmask32 m = pixel_mask(width - x);
+            __m256i b = _mm512_cvtusepi16_epi8(load_half(sb + 2 * x, m, coef));
+            __m256i g = _mm512_cvtusepi16_epi8(load_half(sg + 2 * x, m, coef));
+            __m256i r = _mm512_cvtusepi16_epi8(load_half(sr + 2 * x, m, coef));
+            store_bgra(d + 4 * x, m, b, g, r, zero);
+        }
+        sr += spitch;
+        sg += spitch;
+        sb += spitch;
+        d -= dpitch;
+    }
+}
+
+
+
+#define AVX512_KERNEL(name, impl) \
+void __stdcall \
+name(uint8_t** dstp, const uint8_t** srcp, const int dpitch, \
+    const int spitch, const int width, const int height, void*) noexcept \
+{ \
+    impl(dstp, srcp, dpitch, spitch, width, height); \
+}
+
+AVX512_KERNEL(yuv_to_packed_shader_1_avx512, yuv_to_packed_shader_1)
+AVX512_KERNEL(yuv_to_packed_shader_2_avx512, yuv_to_packed_shader_2<false>)
+AVX512_KERNEL(yuv_to_packed_shader_2_avx512_stacked, yuv_to_packed_shader_2<true>)
+AVX512_KERNEL(yuv_to_packed_shader_3_avx512, yuv_to_packed_shader_3<false>)
+AVX512_KERNEL(yuv_to_packed_shader_3_avx512_stacked, yuv_to_packed_shader_3<true>)
+AVX512_KERNEL(rgb32_to_packed_shader_2_avx512, rgb32_to_packed_shader_2)
+AVX512_KERNEL(rgb32_to_packed_shader_3_avx512, rgb32_to_packed_shader_3)
+
+AVX512_KERNEL(yuv_to_planar_shader_2_avx512, yuv_to_planar_shader_2<false>)
+AVX512_KERNEL(yuv_to_planar_shader_2_avx512_stacked, yuv_to_planar_shader_2<true>)
+AVX512_KERNEL(yuv_to_planar_shader_3_avx512, yuv_to_planar_shader_3<false>)
+AVX512_KERNEL(yuv_to_planar_shader_3_avx512_stacked, yuv_to_planar_shader_3<true>)
+AVX512_KERNEL(rgb32_to_planar_shader_1_avx512, rgb32_to_planar_shader_1)
+AVX512_KERNEL(rgb32_to_planar_shader_2_avx512, rgb32_to_planar_shader_2)
+AVX512_KERNEL(rgb32_to_planar_shader_3_avx512, rgb32_to_planar_shader_3)
+
+AVX512_KERNEL(packed_shader_to_yuv_1_avx512, packed_shader_to_yuv_1)
+AVX512_KERNEL(packed_shader_to_yuv_2_avx512, packed_shader_to_yuv_2<false>)
+AVX512_KERNEL(packed_shader_to_yuv_3_avx512, packed_shader_to_yuv_3<false>)
+AVX512_KERNEL(packed_shader_to_yuv_3_avx512_stacked, packed_shader_to_yuv_3<true>)
+AVX512_KERNEL(packed_shader_to_rgb32_2_avx512, packed_shader_to_rgb32_2)
+AVX512_KERNEL(packed_shader_to_rgb32_3_avx512, packed_shader_to_rgb32_3)
+
+AVX512_KERNEL(planar_shader_to_yuv_2_avx512, planar_shader_to_yuv_2<false>)
+AVX512_KERNEL(planar_shader_to_yuv_2_avx512_stacked, planar_shader_to_yuv_2<true>)
+AVX512_KERNEL(planar_shader_to_yuv_3_avx512, planar_shader_to_yuv_3<false>)
+AVX512_KERNEL(planar_shader_to_yuv_3_avx512_stacked, planar_shader_to_yuv_3<true>)
+AVX512_KERNEL(planar_shader_to_rgb32_1_avx512, planar_shader_to_rgb32_1)
+AVX512_KERNEL(planar_shader_to_rgb32_2_avx512, planar_shader_to_rgb32_2)
+AVX512_KERNEL(planar_shader_to_rgb32_3_avx512, planar_shader_to_rgb32_3)
+
+#undef AVX512_KERNEL
+
+
+#endif // __AVX512F__
@@ -91,9 +91,9 @@ shader_to_yuv_2_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     uint8_t *lr, *lg, *lb;
     if (STACK16) {
-        lr = dr + height * dpitch;
-        lg = dg + height * dpitch;
-        lb = db + height * dpitch;
+        lr = dstp[3];
+        lg = dstp[4];
+        lb = dstp[5];
     }
 
     for (int y = 0; y < height; ++y) {
@@ -137,9 +137,9 @@ shader_to_yuv_2_sse2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     uint8_t *lr, *lg, *lb;
     if (STACK16) {
-        lr = dr + height * dpitch;
-        lg = dg + height * dpitch;
-        lb = db + height * dpitch;
+        lr = dstp[3];
+        lg = dstp[4];
+        lb = dstp[5];
     }
 
     const __m128i mask = _mm_set1_epi16(0x00FF);
@@ -209,9 +209,9 @@ shader_to_yuv_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     uint8_t *lr, *lg, *lb;
     if (STACK16) {
-        lr = dr + height * dpitch;
-        lg = dg + height * dpitch;
-        lb = db + height * dpitch;
+        lr = dstp[3];
+        lg = dstp[4];
+        lb = dstp[5];
     }
 
     for (int y = 0; y < height; ++y) {
@@ -359,17 +359,92 @@ shader_to_rgb_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
 extern void __stdcall
 packed_shader_to_yuv_3_f16c_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 packed_shader_to_yuv_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 packed_shader_to_rgb32_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb24_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb32_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb24_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb32_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb24_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb32_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_1_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb32_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_yuv_3_avx512_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+packed_shader_to_rgb32_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 convert_shader_t get_from_shader_packed(int precision, int pix_type, bool stack16, arch_t& arch)
@@ -380,7 +455,7 @@ convert_shader_t get_from_shader_packed(int precision, int pix_type, bool stack1
     constexpr int rgb32 = VideoInfo::CS_BGR32;
     constexpr int yv24 = VideoInfo::CS_YV24;
 
-    std::map<std::tuple<int, int, bool, arch_t>, convert_shader_t> func;
+    convert_shader_map_t func;
 
     func[make_tuple(1, yv24, false, NO_SIMD)] = shader_to_yuv_1_c;
     func[make_tuple(1, yv24, false, USE_SSE2)] = shader_to_yuv_1_sse2;
@@ -407,25 +482,25 @@ convert_shader_t get_from_shader_packed(int precision, int pix_type, bool stack1
     func[make_tuple(3, yv24, true, USE_F16C)] = packed_shader_to_yuv_3_f16c_stacked;
     func[make_tuple(3, rgb32, false, USE_F16C)] = packed_shader_to_rgb32_3_f16c;
 
-    if (precision != 3 && arch == USE_F16C) {
-        arch = USE_SSSE3;
-    }
-    if (pix_type == rgb24) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == rgb32 && arch < USE_SSSE3) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == rgb32 && precision == 1) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == yv24 && arch == USE_SSSE3) {
-        arch = USE_SSE2;
-    }
-    if (precision == 3 && arch != USE_F16C) {
-        arch = NO_SIMD;
-    }
-
-    return func[make_tuple(precision, pix_type, stack16, arch)];
+    // The stacked yv24 kernels write six planes at once, which is slower than SSE2/F16C with AVX2. The same goes
+    // for the AVX-512 one at precision 2.
+    func[make_tuple(1, yv24, false, USE_AVX2)] = packed_shader_to_yuv_1_avx2;
+    func[make_tuple(1, rgb24, false, USE_AVX2)] = packed_shader_to_rgb24_1_avx2;
+    func[make_tuple(1, rgb32, false, USE_AVX2)] = packed_shader_to_rgb32_1_avx2;
+    func[make_tuple(2, yv24, false, USE_AVX2)] = packed_shader_to_yuv_2_avx2;
+    func[make_tuple(2, rgb24, false, USE_AVX2)] = packed_shader_to_rgb24_2_avx2;
+    func[make_tuple(2, rgb32, false, USE_AVX2)] = packed_shader_to_rgb32_2_avx2;
+    func[make_tuple(3, yv24, false, USE_AVX2)] = packed_shader_to_yuv_3_avx2;
+    func[make_tuple(3, rgb24, false, USE_AVX2)] = packed_shader_to_rgb24_3_avx2;
+    func[make_tuple(3, rgb32, false, USE_AVX2)] = packed_shader_to_rgb32_3_avx2;
+
+    func[make_tuple(1, yv24, false, USE_AVX512)] = packed_shader_to_yuv_1_avx512;
+    func[make_tuple(2, yv24, false, USE_AVX512)] = packed_shader_to_yuv_2_avx512;
+    func[make_tuple(2, rgb32, false, USE_AVX512)] = packed_shader_to_rgb32_2_avx512;
+    func[make_tuple(3, yv24, false, USE_AVX512)] = packed_shader_to_yuv_3_avx512;
+    func[make_tuple(3, yv24, true, USE_AVX512)] = packed_shader_to_yuv_3_avx512_stacked;
+    func[make_tuple(3, rgb32, false, USE_AVX512)] = packed_shader_to_rgb32_3_avx512;
+
+    return find_convert_shader(func, precision, pix_type, stack16, arch);
 }
 
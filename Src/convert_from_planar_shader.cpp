@@ -23,7 +23,7 @@ shader_to_yuv_2_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
     for (int p = 0; p < 3; ++p) {
         const uint8_t* s = srcp[p];
         uint8_t* d = dstp[p];
-        uint8_t* lsb = d + height * dpitch;
+        uint8_t* lsb = dstp[p + 3];
 
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; ++x) {
@@ -54,13 +54,13 @@ shader_to_yuv_2_sse2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
     for (int p = 0; p < 3; ++p) {
         const uint8_t* s = srcp[p];
         uint8_t* d = dstp[p];
-        uint8_t* lsb = d + height * dpitch;
+        uint8_t* lsb = dstp[p + 3];
 
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; x += 8) {
                 __m128i sx = load(s + 2 * x);
                 if (!STACK16) {
-                    sx = _mm_adds_epu8(_mm_srli_epi16(sx, 8), _mm_srli_epi16(_mm_and_si128(sx, mask), 8));
+                    sx = _mm_adds_epu8(_mm_srli_epi16(sx, 8), _mm_srli_epi16(_mm_and_si128(sx, mask), 7));
                     storel(d + x, _mm_packus_epi16(sx, sx));
                 } else {
                     storel(d + x, _mm_packus_epi16(_mm_srli_epi16(sx, 8), sx));
@@ -87,7 +87,7 @@ shader_to_yuv_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
     for (int p = 0; p < 3; ++p) {
         const uint8_t* s = srcp[p];
         uint8_t* d = dstp[p];
-        uint8_t* lsb = d + height * dpitch;
+        uint8_t* lsb = dstp[p + 3];
 
         for (int y = 0; y < height; ++y) {
             const uint16_t* s16 = reinterpret_cast<const uint16_t*>(s);
@@ -217,11 +217,11 @@ shader_to_rgb32_2_sse2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; x += 8) {
             __m128i b = load(sb + 2 * x);
-            b = _mm_adds_epu8(_mm_srli_epi16(b, 8), _mm_srli_epi16(_mm_and_si128(b, mask), 8));
+            b = _mm_adds_epu8(_mm_srli_epi16(b, 8), _mm_srli_epi16(_mm_and_si128(b, mask), 7));
             __m128i g = load(sg + 2 * x);
-            g = _mm_adds_epu8(_mm_srli_epi16(g, 8), _mm_srli_epi16(_mm_and_si128(g, mask), 8));
+            g = _mm_adds_epu8(_mm_srli_epi16(g, 8), _mm_srli_epi16(_mm_and_si128(g, mask), 7));
             __m128i r = load(sr + 2 * x);
-            r = _mm_adds_epu8(_mm_srli_epi16(r, 8), _mm_srli_epi16(_mm_and_si128(r, mask), 8));
+            r = _mm_adds_epu8(_mm_srli_epi16(r, 8), _mm_srli_epi16(_mm_and_si128(r, mask), 7));
             __m128i b8r8 = _mm_packus_epi16(b, r);
             __m128i g8a8 = _mm_packus_epi16(g, zero);
             __m128i bg = _mm_unpacklo_epi8(b8r8, g8a8);
@@ -274,20 +274,105 @@ shader_to_rgb_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
 extern void __stdcall
 planar_shader_to_yuv_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 planar_shader_to_yuv_3_f16c_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 planar_shader_to_rgb32_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 
+extern void __stdcall
+planar_shader_to_rgb24_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_2_avx2_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb24_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_3_avx2_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb24_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_1_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_2_avx512_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_yuv_3_avx512_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+planar_shader_to_rgb32_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
 convert_shader_t get_from_shader_planar(int precision, int pix_type, bool stack16, arch_t& arch)
 {
     using std::make_tuple;
@@ -295,7 +380,7 @@ convert_shader_t get_from_shader_planar(int precision, int pix_type, bool stack1
     constexpr int rgb32 = VideoInfo::CS_BGR32;
     constexpr int yv24 = VideoInfo::CS_YV24;
 
-    std::map<std::tuple<int, int, bool, arch_t>, convert_shader_t> func;
+    convert_shader_map_t func;
 
     func[make_tuple(1, rgb24, false, NO_SIMD)] = shader_to_rgb_1_c<false>;
     func[make_tuple(1, rgb32, false, NO_SIMD)] = shader_to_rgb_1_c<true>;
@@ -320,18 +405,25 @@ convert_shader_t get_from_shader_planar(int precision, int pix_type, bool stack1
     func[make_tuple(3, yv24, true, USE_F16C)] = planar_shader_to_yuv_3_f16c_stacked;
     func[make_tuple(3, rgb32, false, USE_F16C)] = planar_shader_to_rgb32_3_f16c;
 
-    if (precision != 3 && arch > USE_SSE2) {
-        arch = USE_SSE2;
-    }
-    if (pix_type == rgb24) {
-        arch = NO_SIMD;
-    }
-    if (precision == 3 && arch < USE_F16C) {
-        arch = NO_SIMD;
-    }
-
-    return func[make_tuple(precision, pix_type, stack16, arch)];
-
-
+    func[make_tuple(1, rgb24, false, USE_AVX2)] = planar_shader_to_rgb24_1_avx2;
+    func[make_tuple(1, rgb32, false, USE_AVX2)] = planar_shader_to_rgb32_1_avx2;
+    func[make_tuple(2, yv24, false, USE_AVX2)] = planar_shader_to_yuv_2_avx2;
+    func[make_tuple(2, yv24, true, USE_AVX2)] = planar_shader_to_yuv_2_avx2_stacked;
+    func[make_tuple(2, rgb24, false, USE_AVX2)] = planar_shader_to_rgb24_2_avx2;
+    func[make_tuple(2, rgb32, false, USE_AVX2)] = planar_shader_to_rgb32_2_avx2;
+    func[make_tuple(3, yv24, false, USE_AVX2)] = planar_shader_to_yuv_3_avx2;
+    func[make_tuple(3, yv24, true, USE_AVX2)] = planar_shader_to_yuv_3_avx2_stacked;
+    func[make_tuple(3, rgb24, false, USE_AVX2)] = planar_shader_to_rgb24_3_avx2;
+    func[make_tuple(3, rgb32, false, USE_AVX2)] = planar_shader_to_rgb32_3_avx2;
+
+    func[make_tuple(1, rgb32, false, USE_AVX512)] = planar_shader_to_rgb32_1_avx512;
+    func[make_tuple(2, yv24, false, USE_AVX512)] = planar_shader_to_yuv_2_avx512;
+    func[make_tuple(2, yv24, true, USE_AVX512)] = planar_shader_to_yuv_2_avx512_stacked;
+    func[make_tuple(2, rgb32, false, USE_AVX512)] = planar_shader_to_rgb32_2_avx512;
+    func[make_tuple(3, yv24, false, USE_AVX512)] = planar_shader_to_yuv_3_avx512;
+    func[make_tuple(3, yv24, true, USE_AVX512)] = planar_shader_to_yuv_3_avx512_stacked;
+    func[make_tuple(3, rgb32, false, USE_AVX512)] = planar_shader_to_rgb32_3_avx512;
+
+    return find_convert_shader(func, precision, pix_type, stack16, arch);
 }
 
@@ -88,9 +88,9 @@ yuv_to_shader_2_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     const uint8_t *rlsb, *glsb, *blsb;
     if (STACK16) {
-        rlsb = sr + height * spitch;
-        glsb = sg + height * spitch;
-        blsb = sb + height * spitch;
+        rlsb = srcp[3];
+        glsb = srcp[4];
+        blsb = srcp[5];
     }
 
     for (int y = 0; y < height; ++y) {
@@ -139,9 +139,9 @@ yuv_to_shader_2_sse2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     const uint8_t *rlsb, *glsb, *blsb;
     if (STACK16) {
-        rlsb = sr + height * spitch;
-        glsb = sg + height * spitch;
-        blsb = sb + height * spitch;
+        rlsb = srcp[3];
+        glsb = srcp[4];
+        blsb = srcp[5];
     }
 
     const __m128i zero = _mm_setzero_si128();
@@ -195,9 +195,9 @@ yuv_to_shader_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
     const uint8_t *rlsb, *glsb, *blsb;
     if (STACK16) {
-        rlsb = sr + height * spitch;
-        glsb = sg + height * spitch;
-        blsb = sb + height * spitch;
+        rlsb = srcp[3];
+        glsb = srcp[4];
+        blsb = srcp[5];
     }
 
     for (int y = 0; y < height; ++y) {
@@ -332,17 +332,107 @@ rgb_to_shader_3_c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
 
 extern void __stdcall
 yuv_to_packed_shader_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 yuv_to_packed_shader_3_f16c_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 extern void __stdcall
 rgb32_to_packed_shader_3_f16c(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
-    const int spitch, const int width, const int height, void* _buff) noexcept;
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_2_avx2_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_3_avx2_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb24_to_packed_shader_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb32_to_packed_shader_1_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb24_to_packed_shader_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb32_to_packed_shader_2_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb24_to_packed_shader_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb32_to_packed_shader_3_avx2(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_1_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_2_avx512_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+yuv_to_packed_shader_3_avx512_stacked(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb32_to_packed_shader_2_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
+
+
+extern void __stdcall
+rgb32_to_packed_shader_3_avx512(uint8_t** dstp, const uint8_t** srcp, const int dpitch,
+    const int spitch, const int width, const int height, void* _lut) noexcept;
 
 
 convert_shader_t get_to_shader_packed(int precision, int pix_type, bool stack16, arch_t& arch)
@@ -353,7 +443,7 @@ convert_shader_t get_to_shader_packed(int precision, int pix_type, bool stack16,
     constexpr int rgb32 = VideoInfo::CS_BGR32;
     constexpr int yv24 = VideoInfo::CS_YV24;
 
-    std::map<std::tuple<int, int, bool, arch_t>, convert_shader_t> func;
+    convert_shader_map_t func;
 
     func[make_tuple(1, yv24, false, NO_SIMD)] = yuv_to_shader_1_c;
     func[make_tuple(1, yv24, false, USE_SSE2)] = yuv_to_shader_1_sse2;
@@ -380,26 +470,26 @@ convert_shader_t get_to_shader_packed(int precision, int pix_type, bool stack16,
     func[make_tuple(3, yv24, true, USE_F16C)] = yuv_to_packed_shader_3_f16c_stacked;
     func[make_tuple(3, rgb32, false, USE_F16C)] = rgb32_to_packed_shader_3_f16c;
 
-    if (precision != 3 && arch == USE_F16C) {
-        arch = USE_SSSE3;
-    }
-    if (pix_type == rgb24) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == rgb32 && arch < USE_SSSE3) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == rgb32 && precision == 1) {
-        arch = NO_SIMD;
-    }
-    if (pix_type == yv24 && arch == USE_SSSE3) {
-        arch = USE_SSE2;
-    }
-    if (precision == 3 && arch != USE_F16C) {
-        arch = NO_SIMD;
-    }
-
-
-    return func[make_tuple(precision, pix_type, stack16, arch)];
+    func[make_tuple(1, yv24, false, USE_AVX2)] = yuv_to_packed_shader_1_avx2;
+    func[make_tuple(2, yv24, false, USE_AVX2)] = yuv_to_packed_shader_2_avx2;
+    func[make_tuple(2, yv24, true, USE_AVX2)] = yuv_to_packed_shader_2_avx2_stacked;
+    func[make_tuple(3, yv24, false, USE_AVX2)] = yuv_to_packed_shader_3_avx2;
+    func[make_tuple(3, yv24, true, USE_AVX2)] = yuv_to_packed_shader_3_avx2_stacked;
+    func[make_tuple(1, rgb24, false, USE_AVX2)] = rgb24_to_packed_shader_1_avx2;
+    func[make_tuple(1, rgb32, false, USE_AVX2)] = rgb32_to_packed_shader_1_avx2;
+    func[make_tuple(2, rgb24, false, USE_AVX2)] = rgb24_to_packed_shader_2_avx2;
+    func[make_tuple(2, rgb32, false, USE_AVX2)] = rgb32_to_packed_shader_2_avx2;
+    func[make_tuple(3, rgb24, false, USE_AVX2)] = rgb24_to_packed_shader_3_avx2;
+    func[make_tuple(3, rgb32, false, USE_AVX2)] = rgb32_to_packed_shader_3_avx2;
+
+    func[make_tuple(1, yv24, false, USE_AVX512)] = yuv_to_packed_shader_1_avx512;
+    func[make_tuple(2, yv24, false, USE_AVX512)] = yuv_to_packed_shader_2_avx512;
+    func[make_tuple(2, yv24, true, USE_AVX512)] = yuv_to_packed_shader_2_avx512_stacked;
+    func[make_tuple(3, yv24, false, USE_AVX512)] = yuv_to_packed_shader_3_avx512;
+    func[make_tuple(3, yv24, true, USE_AVX512)] = yuv_to_packed_shader_3_avx512_stacked;
+    func[make_tuple(2, rgb32, false, USE_AVX512)] = rgb32_to_packed_shader_2_avx512;
+    func[make_tuple(3, rgb32, false, USE_AVX512)] = rgb32_to_packed_shader_3_avx512;
+
+    return find_convert_shader(func, precision, pix_type, stack16, arch);
 }
 
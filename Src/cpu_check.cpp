@@ -21,7 +21,11 @@
 */
 
 #include <cstdint>
+#ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
 
 
 enum {
@@ -54,12 +58,32 @@ static inline int is_bit_set(int bitfield, int bit)  noexcept
     return bitfield & (1 << bit);
 }
 
+static inline void cpuid(int regs[4], int leaf, int subleaf) noexcept
+{
+#ifdef _MSC_VER
+    __cpuidex(regs, leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static inline uint64_t xgetbv(uint32_t index) noexcept
+{
+#ifdef _MSC_VER
+    return _xgetbv(index);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
 static uint32_t get_simd_support_info(void) noexcept
 {
     uint32_t ret = 0;
     int regs[4] = {0};
 
-    __cpuid(regs, 0x00000001);
+    cpuid(regs, 0x00000001, 0);
     if (is_bit_set(regs[3], 26)) {
         ret |= CPU_SSE2_SUPPORT;
     }
@@ -75,7 +99,15 @@ static uint32_t get_simd_support_info(void) noexcept
     if (is_bit_set(regs[2], 26)) {
         ret |= CPU_SSE4_2_SUPPORT;
     }
+    // OSXSAVE: the OS must also save the YMM (and ZMM) registers on context switch.
+    bool os_avx = false;
+    bool os_avx512 = false;
     if (is_bit_set(regs[2], 27)) {
+        uint64_t xcr0 = xgetbv(0);
+        os_avx = (xcr0 & 0x06) == 0x06;
+        os_avx512 = (xcr0 & 0xE6) == 0xE6;
+    }
+    if (os_avx) {
         if (is_bit_set(regs[2], 28)) {
             ret |= CPU_AVX_SUPPORT;
         }
@@ -88,7 +120,7 @@ static uint32_t get_simd_support_info(void) noexcept
     }
 
     regs[3] = 0;
-    __cpuid(regs, 0x80000001);
+    cpuid(regs, 0x80000001, 0);
     if (is_bit_set(regs[3], 6)) {
         ret |= CPU_SSE4_A_SUPPORT;
     }
@@ -96,16 +128,16 @@ static uint32_t get_simd_support_info(void) noexcept
         ret |= CPU_FMA4_SUPPORT;
     }
 
-    __cpuid(regs, 0x00000000);
+    cpuid(regs, 0x00000000, 0);
     if (regs[0] < 7) {
         return ret;
     }
 
-    __cpuidex(regs, 0x00000007, 0);
-    if (is_bit_set(regs[1], 5)) {
+    cpuid(regs, 0x00000007, 0);
+    if (os_avx && is_bit_set(regs[1], 5)) {
         ret |= CPU_AVX2_SUPPORT;
     }
-    if (!is_bit_set(regs[1], 16)) {
+    if (!os_avx512 || !is_bit_set(regs[1], 16)) {
         return ret;
     }
 
@@ -153,3 +185,14 @@ bool has_f16c() noexcept
     return (get_simd_support_info() & CPU_F16C_SUPPORT) != 0;
 }
 
+bool has_avx2() noexcept
+{
+    return (get_simd_support_info() & CPU_AVX2_SUPPORT) != 0;
+}
+
+bool has_avx512() noexcept
+{
+    constexpr uint32_t avx512 = CPU_AVX512F_SUPPORT | CPU_AVX512BW_SUPPORT | CPU_AVX512DQ_SUPPORT
+        | CPU_AVX512CD_SUPPORT | CPU_AVX512VL_SUPPORT;
+    return (get_simd_support_info() & avx512) == avx512;
+}
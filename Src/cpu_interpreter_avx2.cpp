@@ -0,0 +1,16 @@
+#if !defined(__AVX2__)
+#error /arch:avx2 is not set.
+#else
+
+#include "CpuInterpreter.h"
+
+#pragma warning(disable:4556)
+
+/* The interpreter with 8 lanes: each register component of a group is one ymm register. */
+
+cpu_interpreter_t get_cpu_interpreter_avx2()
+{
+    return &RunCpuProgram<8>;
+}
+
+#endif
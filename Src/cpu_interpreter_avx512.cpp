@@ -0,0 +1,16 @@
+#if !defined(__AVX512F__) || !defined(__AVX512BW__) || !defined(__AVX512VL__)
+#error /arch:avx512 is not set.
+#else
+
+#include "CpuInterpreter.h"
+
+#pragma warning(disable:4556)
+
+/* The interpreter with 16 lanes: each register component of a group is one zmm register. */
+
+cpu_interpreter_t get_cpu_interpreter_avx512()
+{
+    return &RunCpuProgram<16>;
+}
+
+#endif
@@ -0,0 +1,234 @@
+#if !defined(__AVX2__)
+#error /arch:avx2 is not set.
+#else
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+
+#include "SSimDownscale.h"
+
+#pragma warning(disable:4556)
+
+
+/*
+AVX2 versions of the SSimDownscale kernels.
+
+The vertical passes process 8 pixels of a row per iteration; the intermediate rows are padded so that they
+never need a scalar tail. The horizontal downscale has different taps for each output pixel, so it
+transposes 8 source rows at a time and processes the 8 rows of each output pixel in one register.
+*/
+
+
+static __forceinline __m256 load_partial(const float* p, int count)
+{
+    alignas(32) float tmp[8] = { 0 };
+    memcpy(tmp, p, count * sizeof(float));
+    return _mm256_load_ps(tmp);
+}
+
+
+static __forceinline void store_partial(float* p, const __m256& x, int count)
+{
+    alignas(32) float tmp[8];
+    _mm256_store_ps(tmp, x);
+    memcpy(p, tmp, count * sizeof(float));
+}
+
+
+static __forceinline void transpose8(__m256* r)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    const __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    const __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    const __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    const __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+    const __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    const __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    const __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+    r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+    r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+    r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+    r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+    r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+    r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+    r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+    r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+
+// (0.5, 1, 0.5) / 2 along both axes around p[1][x..x+7].
+static __forceinline __m256 convolve(const float* const* p, int x)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256 row[3];
+    for (int i = 0; i < 3; ++i) {
+        const __m256 sides = _mm256_add_ps(_mm256_loadu_ps(p[i] + x - 1), _mm256_loadu_ps(p[i] + x + 1));
+        row[i] = _mm256_add_ps(_mm256_mul_ps(sides, quarter), _mm256_mul_ps(_mm256_loadu_ps(p[i] + x), half));
+    }
+    return _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(row[0], row[2]), quarter), _mm256_mul_ps(row[1], half));
+}
+
+
+static void downscale_h_avx2(const float* src, int srcPitch, int rows, int srcWidth, const SSimTaps& taps, int width, float* mean, float* var, int dstPitch)
+{
+    const int sw8 = (srcWidth + 7) & ~7;
+    const int w8 = (width + 7) & ~7;
+
+    // Columns of 8 rows, then the mean and the variance of each output pixel for the same 8 rows.
+    std::vector<float> buffer((size_t)(sw8 + 2 * w8) * 8);
+    float* columns = buffer.data();
+    float* cm = columns + (size_t)sw8 * 8;
+    float* cv = cm + (size_t)w8 * 8;
+
+    const int* index = taps.Index.data();
+    const float* weight = taps.Weight.data();
+
+    for (int r0 = 0; r0 < rows; r0 += 8) {
+        const float* s[8];
+        for (int i = 0; i < 8; ++i) {
+            s[i] = src + (size_t)std::min(r0 + i, rows - 1) * srcPitch;
+        }
+
+        for (int x = 0; x < sw8; x += 8) {
+            __m256 r[8];
+            for (int i = 0; i < 8; ++i) {
+                r[i] = x + 8 <= srcWidth ? _mm256_loadu_ps(s[i] + x) : load_partial(s[i] + x, srcWidth - x);
+            }
+            transpose8(r);
+            for (int i = 0; i < 8; ++i) {
+                _mm256_storeu_ps(columns + (size_t)(x + i) * 8, r[i]);
+            }
+        }
+
+        for (int x = 0; x < width; ++x) {
+            const int first = taps.Start[x], last = taps.Start[x + 1];
+            __m256 avg = _mm256_setzero_ps();
+            for (int k = first; k < last; ++k) {
+                avg = _mm256_add_ps(avg, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_loadu_ps(columns + (size_t)index[k] * 8)));
+            }
+            __m256 sum = _mm256_setzero_ps();
+            for (int k = first; k < last; ++k) {
+                const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(columns + (size_t)index[k] * 8), avg);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_mul_ps(d, d)));
+            }
+            _mm256_storeu_ps(cm + (size_t)x * 8, avg);
+            _mm256_storeu_ps(cv + (size_t)x * 8, sum);
+        }
+
+        const int count = std::min(rows - r0, 8);
+        for (int x = 0; x < w8; x += 8) {
+            __m256 m[8], v[8];
+            for (int i = 0; i < 8; ++i) {
+                m[i] = _mm256_loadu_ps(cm + (size_t)(x + i) * 8);
+                v[i] = _mm256_loadu_ps(cv + (size_t)(x + i) * 8);
+            }
+            transpose8(m);
+            transpose8(v);
+            for (int i = 0; i < count; ++i) {
+                _mm256_storeu_ps(mean + (size_t)(r0 + i) * dstPitch + x, m[i]);
+                _mm256_storeu_ps(var + (size_t)(r0 + i) * dstPitch + x, v[i]);
+            }
+        }
+    }
+}
+
+
+static void downscale_v_avx2(const float* const* mean, const float* const* var, const float* weight, int taps, int width, float* dstMean, float* dstVar)
+{
+    for (int x = 0; x < width; x += 8) {
+        __m256 avg = _mm256_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            avg = _mm256_add_ps(avg, _mm256_mul_ps(_mm256_set1_ps(weight[k]), _mm256_loadu_ps(mean[k] + x)));
+        }
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < taps; ++k) {
+            const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(mean[k] + x), avg);
+            const __m256 v = _mm256_add_ps(_mm256_loadu_ps(var[k] + x), _mm256_mul_ps(d, d));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weight[k]), v));
+        }
+        _mm256_storeu_ps(dstMean + x, avg);
+        _mm256_storeu_ps(dstVar + x, sum);
+    }
+}
+
+
+static void mean_and_r_avx2(const float* const* L, const float* const* V, int width, float* M, float* R, float* RM, float* RR, bool accumulate)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (int x = 0; x < width; x += 8) {
+        const __m256 mean = convolve(L, x);
+        const __m256 var = convolve(V, x);
+
+        __m256 row[3];
+        for (int i = 0; i < 3; ++i) {
+            const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(L[i] + x - 1), mean);
+            const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(L[i] + x), mean);
+            const __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(L[i] + x + 1), mean);
+            const __m256 sides = _mm256_add_ps(_mm256_mul_ps(d0, d0), _mm256_mul_ps(d2, d2));
+            row[i] = _mm256_add_ps(_mm256_mul_ps(sides, quarter), _mm256_mul_ps(_mm256_mul_ps(d1, d1), half));
+        }
+        const __m256 sum = _mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(row[0], row[2]), quarter), _mm256_mul_ps(row[1], half));
+
+        // Lanes where sum is 0 divide by 0 and are masked out.
+        const __m256 nonzero = _mm256_cmp_ps(sum, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+        const __m256 r = _mm256_and_ps(nonzero, _mm256_sqrt_ps(_mm256_add_ps(one, _mm256_div_ps(var, sum))));
+        const __m256 rr = _mm256_mul_ps(r, r);
+
+        _mm256_storeu_ps(M + x, mean);
+        _mm256_storeu_ps(R + x, r);
+        _mm256_storeu_ps(RM + x, _mm256_mul_ps(r, mean));
+        _mm256_storeu_ps(RR + x, accumulate ? _mm256_add_ps(_mm256_loadu_ps(RR + x), rr) : rr);
+    }
+}
+
+
+static void strength_avx2(const float* const* RR, int width, float strength, float* t)
+{
+    const __m256 str = _mm256_set1_ps(strength);
+    const __m256 scale = _mm256_set1_ps((1 - strength) / 200);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (int x = 0; x < width; x += 8) {
+        const __m256 d = _mm256_add_ps(str, _mm256_mul_ps(scale, convolve(RR, x)));
+        const __m256 positive = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GT_OQ);
+        _mm256_storeu_ps(t + x, _mm256_blendv_ps(one, _mm256_div_ps(str, d), positive));
+    }
+}
+
+
+static void blend_avx2(const float* const* M, const float* const* R, const float* const* RM, const float* L, const float* t, int width, float* dst)
+{
+    for (int x = 0; x < width; x += 8) {
+        const __m256 l = _mm256_loadu_ps(L + x);
+        const __m256 result = _mm256_sub_ps(_mm256_add_ps(convolve(M, x), _mm256_mul_ps(l, convolve(R, x))), convolve(RM, x));
+        const __m256 out = _mm256_add_ps(l, _mm256_mul_ps(_mm256_loadu_ps(t + x), _mm256_sub_ps(result, l)));
+        // dst is the output frame, which has no padding.
+        if (x + 8 <= width) {
+            _mm256_storeu_ps(dst + x, out);
+        } else {
+            store_partial(dst + x, out, width - x);
+        }
+    }
+}
+
+
+SSimKernels get_ssim_kernels_avx2()
+{
+    return SSimKernels{ downscale_h_avx2, downscale_v_avx2, mean_and_r_avx2, strength_avx2, blend_avx2 };
+}
+
+#endif
@@ -0,0 +1,129 @@
+#if !defined(__AVX2__)
+#error /arch:avx2 is not set.
+#else
+
+#include <cstring>
+#include <immintrin.h>
+
+#include "SuperXbrCpu.h"
+#include "SuperXbrCore.h"
+
+#pragma warning(disable:4556)
+
+
+/*
+AVX2 versions of the SuperXbrCpu kernels, built on the same per-pixel code as the C++ kernels.
+
+Pass 0 computes one pixel out of 2 in odd rows and pass 1 one pixel out of 2 in every row, so they
+compute 8 pixels of the right parity per iteration and interleave them with the copied pixels.
+Rows of the intermediate images have enough margin for whole vectors; only the output frame gets
+a partial store at the end of the row.
+*/
+
+
+struct Vec8 {
+    __m256 v;
+};
+
+static __forceinline Vec8 operator+(const Vec8& a, const Vec8& b) { return Vec8{ _mm256_add_ps(a.v, b.v) }; }
+static __forceinline Vec8 operator-(const Vec8& a, const Vec8& b) { return Vec8{ _mm256_sub_ps(a.v, b.v) }; }
+static __forceinline Vec8 operator*(const Vec8& a, const Vec8& b) { return Vec8{ _mm256_mul_ps(a.v, b.v) }; }
+static __forceinline Vec8 operator*(float a, const Vec8& b) { return Vec8{ _mm256_mul_ps(_mm256_set1_ps(a), b.v) }; }
+static __forceinline Vec8 operator-(float a, const Vec8& b) { return Vec8{ _mm256_sub_ps(_mm256_set1_ps(a), b.v) }; }
+static __forceinline Vec8 operator/(const Vec8& a, float b) { return Vec8{ _mm256_div_ps(a.v, _mm256_set1_ps(b)) }; }
+
+static __forceinline Vec8 xbr_abs(const Vec8& x) { return Vec8{ _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v) }; }
+static __forceinline Vec8 xbr_min(const Vec8& a, const Vec8& b) { return Vec8{ _mm256_min_ps(a.v, b.v) }; }
+static __forceinline Vec8 xbr_max(const Vec8& a, const Vec8& b) { return Vec8{ _mm256_max_ps(a.v, b.v) }; }
+static __forceinline Vec8 xbr_step0(const Vec8& x)
+{
+    return Vec8{ _mm256_and_ps(_mm256_cmp_ps(x.v, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_set1_ps(1.0f)) };
+}
+static __forceinline Vec8 xbr_saturate(const Vec8& x)
+{
+    return Vec8{ _mm256_min_ps(_mm256_max_ps(x.v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f)) };
+}
+
+
+static __forceinline Vec8 loadu(const float* p)
+{
+    return Vec8{ _mm256_loadu_ps(p) };
+}
+
+
+// p[0], p[2], ..., p[14]
+static __forceinline Vec8 load_even(const float* p)
+{
+    const __m256 s = _mm256_shuffle_ps(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _MM_SHUFFLE(2, 0, 2, 0));
+    return Vec8{ _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(s), _MM_SHUFFLE(3, 1, 2, 0))) };
+}
+
+
+// Writes a0, b0, a1, b1, ..., a7, b7.
+static __forceinline void store_interleaved(float* p, const Vec8& a, const Vec8& b)
+{
+    const __m256 lo = _mm256_unpacklo_ps(a.v, b.v);
+    const __m256 hi = _mm256_unpackhi_ps(a.v, b.v);
+    _mm256_storeu_ps(p, _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(p + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+
+static void super_xbr_pass0_avx2(const SuperXbrRows& in, int width, bool odd, float edgeStrength, float weight, float* const* out)
+{
+    for (int x = 0; x < width; x += 8) {
+        Vec8 v[3];
+        if (odd) {
+            super_xbr_pixel<0, Vec8>([&](int dx, int dy, int c) { return loadu(in.Row[c][1 + dy] + x + dx); }, edgeStrength, weight, v);
+        }
+        for (int c = 0; c < 3; ++c) {
+            const Vec8 skip = loadu(in.Row[c][1] + x);
+            store_interleaved(out[c] + 2 * x, skip, odd ? v[c] : skip);
+        }
+    }
+}
+
+
+static void super_xbr_pass1_avx2(const SuperXbrRows& in, int width, int y, float edgeStrength, float weight, float* const* out)
+{
+    // Pixels where x + y is odd are computed, the others are copied.
+    const int q = (y + 1) & 1;
+    for (int x = 0; x < width; x += 16) {
+        Vec8 v[3];
+        super_xbr_pixel<1, Vec8>([&](int dx, int dy, int c) { return load_even(in.Row[c][3 + dy - dx] + x + q + dx + dy - 1); }, edgeStrength, weight, v);
+        for (int c = 0; c < 3; ++c) {
+            const Vec8 skip = load_even(in.Row[c][3] + x + 1 - q);
+            if (q == 0) {
+                store_interleaved(out[c] + x, v[c], skip);
+            } else {
+                store_interleaved(out[c] + x, skip, v[c]);
+            }
+        }
+    }
+}
+
+
+static void super_xbr_pass2_avx2(const SuperXbrRows& in, int width, float edgeStrength, float weight, float* const* out)
+{
+    for (int x = 0; x < width; x += 8) {
+        Vec8 v[3];
+        super_xbr_pixel<2, Vec8>([&](int dx, int dy, int c) { return loadu(in.Row[c][2 - dy] + x - dx); }, edgeStrength, weight, v);
+        for (int c = 0; c < 3; ++c) {
+            if (x + 8 <= width) {
+                _mm256_storeu_ps(out[c] + x, v[c].v);
+            } else {
+                alignas(32) float tmp[8];
+                _mm256_store_ps(tmp, v[c].v);
+                memcpy(out[c] + x, tmp, (width - x) * sizeof(float));
+            }
+        }
+    }
+}
+
+
+SuperXbrKernels get_super_xbr_kernels_avx2()
+{
+    return SuperXbrKernels{ super_xbr_pass0_avx2, super_xbr_pass1_avx2, super_xbr_pass2_avx2 };
+}
+
+#endif